@@ -0,0 +1,257 @@
+#pragma once
+
+#include <zuazo/FourCC.h>
+#include <zuazo/Resolution.h>
+#include <zuazo/Math/Rational.h>
+#include <zuazo/NDI/PerfCounters.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Zuazo::Benchmarks {
+
+/*
+ * Command line arguments in the --name value form
+ */
+class Arguments {
+public:
+	Arguments(int argc, const char* argv[]) {
+		for(int i = 1; i < argc; ++i) {
+			const std::string_view arg = argv[i];
+			if(arg.substr(0, 2) != "--") {
+				throw std::invalid_argument("Unexpected argument: " + std::string(arg));
+			}
+
+			//Flags are followed by another flag or nothing
+			const auto name = std::string(arg.substr(2));
+			if(i + 1 < argc && std::string_view(argv[i + 1]).substr(0, 2) != "--") {
+				m_values[name] = argv[++i];
+			} else {
+				m_values[name] = "";
+			}
+		}
+	}
+
+	bool has(const std::string& name) const {
+		return m_values.count(name);
+	}
+
+	std::string get(const std::string& name, std::string def) const {
+		const auto ite = m_values.find(name);
+		return (ite != m_values.cend()) ? ite->second : def;
+	}
+
+	double getNumber(const std::string& name, double def) const {
+		const auto ite = m_values.find(name);
+		return (ite != m_values.cend()) ? std::stod(ite->second) : def;
+	}
+
+private:
+	std::map<std::string, std::string> m_values;
+};
+
+
+
+inline FourCC parseFourCC(std::string_view str) {
+	static const std::map<std::string_view, FourCC> fourCCs = {
+		{ "UYVY", FourCC::UYVY }, { "UYVA", FourCC::UYVA },
+		{ "P216", FourCC::P216 }, { "PA16", FourCC::PA16 },
+		{ "YV12", FourCC::YV12 }, { "I420", FourCC::I420 },
+		{ "NV12", FourCC::NV12 },
+		{ "BGRA", FourCC::BGRA }, { "BGRX", FourCC::BGRX },
+		{ "RGBA", FourCC::RGBA }, { "RGBX", FourCC::RGBX }
+	};
+
+	const auto ite = fourCCs.find(str);
+	if(ite == fourCCs.cend()) {
+		throw std::invalid_argument("Unknown FourCC: " + std::string(str));
+	}
+	return ite->second;
+}
+
+inline Resolution parseResolution(const std::string& str) {
+	//WIDTHxHEIGHT
+	const auto separator = str.find('x');
+	if(separator == std::string::npos) {
+		throw std::invalid_argument("Invalid resolution: " + str);
+	}
+	return Resolution(std::stoul(str.substr(0, separator)), std::stoul(str.substr(separator + 1)));
+}
+
+inline Math::Rational<int> parseFrameRate(const std::string& str) {
+	//NUM or NUM/DEN
+	const auto separator = str.find('/');
+	if(separator == std::string::npos) {
+		return Math::Rational<int>(std::stoi(str), 1);
+	}
+	return Math::Rational<int>(std::stoi(str.substr(0, separator)), std::stoi(str.substr(separator + 1)));
+}
+
+inline void useLavapipe() {
+	//Select Mesa's software rasterizer, unless the user has chosen a driver
+	static constexpr const char* LAVAPIPE_ICD = "/usr/share/vulkan/icd.d/lvp_icd.x86_64.json";
+	setenv("VK_ICD_FILENAMES", LAVAPIPE_ICD, 0);
+}
+
+
+
+/*
+ * Latency samples of a stage, in nanoseconds
+ */
+class Samples {
+public:
+	void add(std::chrono::steady_clock::duration duration) {
+		m_samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+		m_sorted = false;
+	}
+
+	size_t size() const noexcept {
+		return m_samples.size();
+	}
+
+	double getPercentile(double p) {
+		if(m_samples.empty()) {
+			return 0.0;
+		}
+
+		sort();
+		const auto index = std::min(
+			static_cast<size_t>(p / 100.0 * m_samples.size()),
+			m_samples.size() - 1
+		);
+		return m_samples[index];
+	}
+
+	double getMean() const {
+		if(m_samples.empty()) {
+			return 0.0;
+		}
+
+		double sum = 0.0;
+		for(const auto sample : m_samples) {
+			sum += sample;
+		}
+		return sum / m_samples.size();
+	}
+
+	void merge(const Samples& other) {
+		m_samples.insert(m_samples.end(), other.m_samples.cbegin(), other.m_samples.cend());
+		m_sorted = false;
+	}
+
+	//Writes a JSON object with the percentiles, in microseconds
+	void writeJSON(std::ostream& os) {
+		os << std::fixed << std::setprecision(3);
+		os << "{ \"count\": " << size();
+		os << ", \"mean_us\": " << getMean() / 1e3;
+		os << ", \"p50_us\": " << getPercentile(50.0) / 1e3;
+		os << ", \"p99_us\": " << getPercentile(99.0) / 1e3;
+		os << ", \"p999_us\": " << getPercentile(99.9) / 1e3;
+		os << ", \"max_us\": " << getPercentile(100.0) / 1e3;
+		os << " }";
+	}
+
+private:
+	std::vector<int64_t>	m_samples;
+	bool					m_sorted = true;
+
+	void sort() {
+		if(!m_sorted) {
+			std::sort(m_samples.begin(), m_samples.end());
+			m_sorted = true;
+		}
+	}
+};
+
+inline std::string quote(std::string_view str) {
+	std::ostringstream os;
+	os << std::quoted(str);
+	return os.str();
+}
+
+
+/*
+ * Hardware counters of the conversions, per FourCC and destination format
+ */
+inline std::string getConversionName(const NDI::PerfCounters::Key& key) {
+	return 	std::string(reinterpret_cast<const char*>(&key.source), 4) + " -> " +
+			std::string(toString(key.format)) + " " + std::string(toString(key.subsampling));
+}
+
+inline void writePerfCountersJSON(std::ostream& os, const NDI::PerfCounters::Results& results, std::string_view indent) {
+	using Counter = NDI::PerfCounters::Counter;
+
+	//Counters which could not be measured are null
+	const auto writeCounter = [&os] (const NDI::PerfCounters::Totals& totals, Counter counter) {
+		if(totals.measured[static_cast<size_t>(counter)]) {
+			os << totals.getPerCall(counter);
+		} else {
+			os << "null";
+		}
+	};
+
+	os << std::fixed << std::setprecision(3);
+	os << "[";
+	for(size_t i = 0; i < results.size(); ++i) {
+		const auto& key = results[i].first;
+		const auto& totals = results[i].second;
+		const auto calls = std::max(totals.calls, uint64_t(1));
+		const auto hasCycles = totals.measured[static_cast<size_t>(Counter::CYCLES)] > 0;
+
+		os << (i ? "," : "") << "\n" << indent << "\t{ ";
+		os << "\"conversion\": " << quote(getConversionName(key));
+		os << ", \"calls\": " << totals.calls;
+		os << ", \"bytes_per_call\": " << totals.bytes / calls;
+		os << ", \"time_per_call_us\": " << totals.time / 1e3 / calls;
+		os << ", \"bandwidth_gbps\": " << (totals.time ? static_cast<double>(totals.bytes) / totals.time : 0.0);
+		os << ", \"cycles_per_call\": "; writeCounter(totals, Counter::CYCLES);
+		os << ", \"instructions_per_call\": "; writeCounter(totals, Counter::INSTRUCTIONS);
+		os << ", \"llc_misses_per_call\": "; writeCounter(totals, Counter::CACHE_MISSES);
+		os << ", \"ipc\": "; if(hasCycles) os << totals.getInstructionsPerCycle(); else os << "null";
+		os << ", \"bytes_per_cycle\": "; if(hasCycles) os << totals.getBytesPerCycle(); else os << "null";
+		os << " }";
+	}
+	os << (results.empty() ? "" : "\n") << (results.empty() ? "" : indent) << "]";
+}
+
+inline void writePerfCountersText(std::ostream& os, const NDI::PerfCounters::Results& results) {
+	using Counter = NDI::PerfCounters::Counter;
+
+	if(results.empty()) {
+		return;
+	}
+
+	os << std::fixed << std::setprecision(2);
+	os << "conversion                        calls   MiB/call     GB/s  Mcycles/call  IPC  LLC miss/call  bytes/cycle\n";
+	for(const auto& result : results) {
+		const auto& totals = result.second;
+		const auto calls = std::max(totals.calls, uint64_t(1));
+		const auto hasCycles = totals.measured[static_cast<size_t>(Counter::CYCLES)] > 0;
+
+		os << std::setw(30) << std::left << getConversionName(result.first) << std::right;
+		os << std::setw(9) << totals.calls;
+		os << std::setw(11) << totals.bytes / (1024.0 * 1024.0) / calls;
+		os << std::setw(9) << (totals.time ? static_cast<double>(totals.bytes) / totals.time : 0.0);
+		if(hasCycles) {
+			os << std::setw(14) << totals.getPerCall(Counter::CYCLES) / 1e6;
+			os << std::setw(5) << totals.getInstructionsPerCycle();
+			os << std::setw(15) << totals.getPerCall(Counter::CACHE_MISSES);
+			os << std::setw(13) << totals.getBytesPerCycle();
+		} else {
+			os << "  (hardware counters are not available)";
+		}
+		os << "\n";
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,481 @@
+/*
+ * This benchmark measures how Sources::NDI scales with the amount of
+ * concurrent inputs. As the instance does, a single update loop pulls and
+ * uploads every source once per period. The amount of sources is swept and,
+ * for each step, the aggregate frame rate, the update loop duration, the time
+ * spent on each stage, dropped and repeated frames, CPU and memory usage are
+ * reported. It runs against the loopback backend, so that no NDI sender
+ * nor runtime is required
+ *
+ * Usage:
+ * zuazo-ndi-source-scaling 	[--format UYVY] [--resolution 1920x1080] [--rate 60]
+ * 								[--sweep 1,2,4,8,16,32,48,64] [--duration 5] [--warmup 1]
+ * 								[--lavapipe] [--perf] [--json FILE|-]
+ *
+ * --perf measures the conversions with the hardware performance counters
+ * (see NDI::PerfCounters), reporting bytes per cycle for each step
+ */
+
+#include "Common.h"
+
+#include <Sources/NDIReceiver.h>
+
+#include <zuazo/Instance.h>
+#include <zuazo/Modules/NDI.h>
+#include <zuazo/NDI/Loopback.h>
+#include <zuazo/NDI/Conversions.h>
+#include <zuazo/NDI/PerfCounters.h>
+#include <zuazo/Graphics/StagedFrame.h>
+
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace Zuazo;
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+	FourCC									fourCC;
+	Resolution								resolution;
+	Math::Rational<int>						frameRate;
+	std::vector<size_t>						sweep;
+	double									duration;
+	double									warmup;
+	bool									perf;
+	std::string								json;
+};
+
+/*
+ * Jiffies spent by a CPU, as reported by /proc/stat
+ */
+struct CPUTimes {
+	uint64_t								busy = 0;
+	uint64_t								total = 0;
+};
+
+struct Step {
+	size_t									sourceCount = 0;
+	Benchmarks::Samples						loop;
+	Benchmarks::Samples						capture;
+	Benchmarks::Samples						acquire;
+	Benchmarks::Samples						copy;
+	Benchmarks::Samples						flush;
+	size_t									ticks = 0;
+	size_t									overruns = 0;
+	size_t									frames = 0;
+	size_t									repeated = 0;
+	size_t									dropped = 0;
+	double									processCPU = 0.0;	//In cores
+	std::vector<double>						coreUsage;			//In [0, 1]
+	size_t									rss = 0;			//In bytes
+	size_t									rssDelta = 0;		//In bytes
+	NDI::PerfCounters::Results				perf;
+};
+
+
+
+static std::vector<size_t> parseSweep(const std::string& str) {
+	//Comma separated list of source counts
+	std::vector<size_t> result;
+	std::istringstream is(str);
+	std::string item;
+	while(std::getline(is, item, ',')) {
+		const auto count = std::stoul(item);
+		if(count == 0) {
+			throw std::invalid_argument("Invalid source count: " + item);
+		}
+		result.push_back(count);
+	}
+
+	if(result.empty()) {
+		throw std::invalid_argument("Empty sweep");
+	}
+	return result;
+}
+
+static Graphics::Frame::Descriptor getDescriptor(const Graphics::Vulkan& vulkan, const Config& config) {
+	//Same as Sources::NDI would advertise for the first supported target
+	const auto colorimetry = NDI::getColorimetry(config.resolution);
+	const auto formatCompatibility = Graphics::StagedFrame::getSupportedFormats(vulkan);
+
+	for(const auto& target : NDI::getConversionTargets(config.fourCC)) {
+		const auto isRGB = target.first == ColorFormat::R8G8B8A8 || target.first == ColorFormat::B8G8R8A8;
+		const VideoMode videoMode(
+			Utils::MustBe<Rate>(Rate(config.frameRate.getNumerator(), config.frameRate.getDenominator())),
+			Utils::MustBe<Resolution>(config.resolution),
+			Utils::MustBe<AspectRatio>(AspectRatio(1, 1)),
+			Utils::MustBe<ColorPrimaries>(colorimetry.primaries),
+			Utils::MustBe<ColorModel>(isRGB ? ColorModel::rgb : colorimetry.model),
+			Utils::MustBe<ColorTransferFunction>(ColorTransferFunction::bt1886),
+			Utils::MustBe<ColorSubsampling>(target.second),
+			Utils::MustBe<ColorRange>(isRGB ? ColorRange::full : colorimetry.range),
+			formatCompatibility.intersect(Utils::MustBe<ColorFormat>(target.first))
+		);
+
+		if(static_cast<bool>(videoMode)) {
+			return videoMode.getFrameDescriptor();
+		}
+	}
+
+	throw std::runtime_error("FourCC is not supported by the GPU");
+}
+
+static std::string getSenderName(size_t index) {
+	return "SCALING (" + std::to_string(index) + ")";
+}
+
+
+
+static std::vector<CPUTimes> readCPUTimes() {
+	//Per core lines are in the form "cpuN user nice system idle iowait irq softirq steal ..."
+	std::vector<CPUTimes> result;
+	std::ifstream file("/proc/stat");
+	std::string line;
+	while(std::getline(file, line)) {
+		if(line.compare(0, 3, "cpu") != 0 || line.size() < 4 || !std::isdigit(line[3])) {
+			continue; //Not a per core line
+		}
+
+		std::istringstream is(line.substr(line.find(' ')));
+		uint64_t values[8] = {};
+		for(auto& value : values) {
+			is >> value;
+		}
+
+		CPUTimes times;
+		for(const auto value : values) {
+			times.total += value;
+		}
+		times.busy = times.total - values[3] - values[4]; //Without idle and iowait
+		result.push_back(times);
+	}
+
+	return result;
+}
+
+static double getProcessCPUTime() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return	usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+			usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6 ;
+}
+
+static size_t getResidentSetSize() {
+	//Second field of statm, in pages
+	std::ifstream file("/proc/self/statm");
+	size_t size = 0, resident = 0;
+	file >> size >> resident;
+	return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+
+
+static void runStep(const Graphics::Vulkan& vulkan,
+					const Graphics::Frame::Descriptor& descriptor,
+					const Config& config,
+					Step& step )
+{
+	struct Input {
+		std::shared_ptr<Sources::NDIReceiver>			receiver;
+		Sources::NDIReceiver::Handle					handle;
+		std::shared_ptr<Sources::NDIReceiver::Upload>	upload;
+		int64_t											lastTimestamp = std::numeric_limits<int64_t>::min();
+		int64_t											lastTimecode = 0;
+		bool											started = false;
+	};
+
+	const auto rssBefore = getResidentSetSize();
+
+	std::vector<Input> inputs(step.sourceCount);
+	for(size_t i = 0; i < inputs.size(); ++i) {
+		auto& input = inputs[i];
+		input.receiver = Sources::NDIReceiver::get(Sources::NDI::Source(getSenderName(i), ""), "benchmark");
+		input.handle = input.receiver->subscribe(
+			false, false,
+			Sources::NDIReceiver::Bandwidth::HIGHEST,
+			false
+		);
+		input.upload = input.receiver->getUpload(
+			vulkan,
+			descriptor,
+			config.fourCC,
+			Sources::NDIReceiver::Region{},
+			Sources::NDIReceiver::Deinterlacing::NONE,
+			false,
+			Sources::NDIReceiver::Timebase::NEAREST,
+			0
+		);
+	}
+
+	//Sender timecodes advance one period per frame, so gaps reveal dropped frames
+	const auto period = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>(1.0 / static_cast<double>(config.frameRate))
+	);
+	const auto timecodePeriod = 1e7 / static_cast<double>(config.frameRate);
+
+	const auto start = Clock::now();
+	const auto measureStart = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.warmup));
+	const auto end = measureStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.duration));
+
+	std::vector<CPUTimes> cpuBefore;
+	double processBefore = 0.0;
+	bool measuring = false;
+
+	auto tick = start;
+	while(tick < end) {
+		tick += period;
+		std::this_thread::sleep_until(tick);
+
+		const auto t0 = Clock::now();
+		if(!measuring && t0 >= measureStart) {
+			measuring = true;
+			cpuBefore = readCPUTimes();
+			processBefore = getProcessCPUTime();
+			Modules::NDI::get().getPerfCounters().reset();
+		}
+
+		//Update all the sources in a row, as the instance's loop does
+		for(auto& input : inputs) {
+			const auto c0 = Clock::now();
+			const auto frame = input.receiver->pull(input.handle);
+			const auto c1 = Clock::now();
+			auto video = input.receiver->upload(*input.upload, Sources::NDIReceiver::Field::FIELD0);
+
+			//Frame-syncs repeat the last frame when no new one has arrived.
+			//Tell them apart by their NDI timestamp
+			const bool isNew = video && frame.getData() && frame.getTimestamp() != input.lastTimestamp;
+			if(measuring) {
+				step.capture.add(c1 - c0);
+
+				if(isNew) {
+					step.acquire.add(input.upload->timings.acquire);
+					step.copy.add(input.upload->timings.copy);
+					step.flush.add(input.upload->timings.flush);
+					++step.frames;
+
+					if(input.started) {
+						const auto elapsed = std::lround((frame.getTimecode() - input.lastTimecode) / timecodePeriod);
+						step.dropped += static_cast<size_t>(std::max(elapsed - 1, 0L));
+					}
+				} else {
+					++step.repeated;
+				}
+			}
+
+			if(isNew) {
+				input.lastTimestamp = frame.getTimestamp();
+				input.lastTimecode = frame.getTimecode();
+				input.started = true;
+			}
+		}
+
+		const auto t1 = Clock::now();
+		if(measuring) {
+			step.loop.add(t1 - t0);
+			++step.ticks;
+
+			//The loop could not keep up with the frame rate
+			if(t1 - t0 > period) {
+				++step.overruns;
+			}
+		}
+	}
+
+	//Memory is measured while all the sources are alive
+	const auto processAfter = getProcessCPUTime();
+	const auto cpuAfter = readCPUTimes();
+	const auto elapsed = std::chrono::duration<double>(Clock::now() - measureStart).count();
+	step.rss = getResidentSetSize();
+	step.rssDelta = (step.rss > rssBefore) ? step.rss - rssBefore : 0;
+	step.perf = Modules::NDI::get().getPerfCounters().getResults();
+	step.processCPU = (processAfter - processBefore) / elapsed;
+	for(size_t i = 0; i < std::min(cpuBefore.size(), cpuAfter.size()); ++i) {
+		const auto busy = cpuAfter[i].busy - cpuBefore[i].busy;
+		const auto total = cpuAfter[i].total - cpuBefore[i].total;
+		step.coreUsage.push_back(total ? static_cast<double>(busy) / total : 0.0);
+	}
+
+	for(auto& input : inputs) {
+		input.receiver->unsubscribe(input.handle);
+	}
+}
+
+
+
+static void writeJSON(std::ostream& os, const Config& config, std::vector<Step>& steps) {
+	const auto periodUs = 1e6 / static_cast<double>(config.frameRate);
+
+	os << "{\n";
+	os << "\t\"benchmark\": \"source-scaling\",\n";
+	os << "\t\"format\": " << Benchmarks::quote(std::string(reinterpret_cast<const char*>(&config.fourCC), 4)) << ",\n";
+	os << "\t\"resolution\": [" << config.resolution.x << ", " << config.resolution.y << "],\n";
+	os << "\t\"rate\": " << static_cast<double>(config.frameRate) << ",\n";
+	os << "\t\"duration_s\": " << config.duration << ",\n";
+	os << "\t\"period_us\": " << periodUs << ",\n";
+	os << "\t\"steps\": [\n";
+
+	for(size_t i = 0; i < steps.size(); ++i) {
+		auto& step = steps[i];
+
+		os << "\t\t{\n";
+		os << "\t\t\t\"sources\": " << step.sourceCount << ",\n";
+		os << "\t\t\t\"fps\": " << step.frames / config.duration << ",\n";
+		os << "\t\t\t\"fps_per_source\": " << step.frames / config.duration / step.sourceCount << ",\n";
+		os << "\t\t\t\"frames\": " << step.frames << ",\n";
+		os << "\t\t\t\"repeated\": " << step.repeated << ",\n";
+		os << "\t\t\t\"dropped\": " << step.dropped << ",\n";
+		os << "\t\t\t\"ticks\": " << step.ticks << ",\n";
+		os << "\t\t\t\"overruns\": " << step.overruns << ",\n";
+		os << "\t\t\t\"process_cpu_cores\": " << step.processCPU << ",\n";
+		os << "\t\t\t\"core_usage\": [";
+		for(size_t j = 0; j < step.coreUsage.size(); ++j) {
+			os << (j ? ", " : "") << step.coreUsage[j];
+		}
+		os << "],\n";
+		os << "\t\t\t\"rss_bytes\": " << step.rss << ",\n";
+		os << "\t\t\t\"rss_per_source_bytes\": " << step.rssDelta / step.sourceCount << ",\n";
+		os << "\t\t\t\"stages\": {\n";
+		os << "\t\t\t\t\"loop\": "; step.loop.writeJSON(os); os << ",\n";
+		os << "\t\t\t\t\"capture\": "; step.capture.writeJSON(os); os << ",\n";
+		os << "\t\t\t\t\"acquire\": "; step.acquire.writeJSON(os); os << ",\n";
+		os << "\t\t\t\t\"copy\": "; step.copy.writeJSON(os); os << ",\n";
+		os << "\t\t\t\t\"flush\": "; step.flush.writeJSON(os); os << "\n";
+		os << "\t\t\t}";
+		if(config.perf) {
+			os << ",\n\t\t\t\"perf\": "; Benchmarks::writePerfCountersJSON(os, step.perf, "\t\t\t");
+		}
+		os << "\n";
+		os << "\t\t}" << (i + 1 < steps.size() ? "," : "") << "\n";
+	}
+
+	os << "\t]\n";
+	os << "}\n";
+}
+
+static void writeText(std::ostream& os, const Config& config, std::vector<Step>& steps) {
+	const auto periodUs = 1e6 / static_cast<double>(config.frameRate);
+
+	os << std::fixed << std::setprecision(1);
+	os << "period: " << periodUs << "us\n";
+	os << "sources       fps  dropped repeated overruns  loop p50/p99 (us)  ";
+	os << "capture/acquire/copy/flush per tick (us)   cpu (cores)  rss (MiB)\n";
+
+	for(auto& step : steps) {
+		//Time spent on each stage per loop iteration, so that the bottleneck can be told apart
+		const auto ticks = std::max(step.ticks, size_t(1));
+		const auto perTick = [ticks] (const Benchmarks::Samples& samples) {
+			return samples.getMean() * samples.size() / ticks / 1e3;
+		};
+
+		os << std::setw(7) << step.sourceCount;
+		os << std::setw(10) << step.frames / config.duration;
+		os << std::setw(9) << step.dropped;
+		os << std::setw(9) << step.repeated;
+		os << std::setw(9) << step.overruns;
+		os << std::setw(10) << step.loop.getPercentile(50.0) / 1e3 << "/";
+		os << std::setw(8) << std::left << step.loop.getPercentile(99.0) / 1e3 << std::right;
+		os << std::setw(9) << perTick(step.capture) << "/";
+		os << std::setw(7) << std::left << perTick(step.acquire) << std::right << "/";
+		os << std::setw(7) << std::left << perTick(step.copy) << std::right << "/";
+		os << std::setw(7) << std::left << perTick(step.flush) << std::right;
+		os << std::setw(13) << step.processCPU;
+		os << std::setw(11) << step.rss / (1024.0 * 1024.0) << "\n";
+	}
+
+	//Busiest cores of the last step, to tell apart a saturated loop from a loaded system
+	if(!steps.empty()) {
+		auto usage = steps.back().coreUsage;
+		std::sort(usage.begin(), usage.end(), std::greater<double>());
+		usage.resize(std::min(usage.size(), size_t(8)));
+
+		os << "busiest cores at " << steps.back().sourceCount << " sources (%):";
+		for(const auto core : usage) {
+			os << " " << core * 100.0;
+		}
+		os << "\n";
+	}
+
+	//Conversion efficiency as the amount of sources grows, which reveals
+	//when they become bound by the memory bandwidth
+	if(config.perf) {
+		for(const auto& step : steps) {
+			os << "\nconversions at " << step.sourceCount << " sources:\n";
+			Benchmarks::writePerfCountersText(os, step.perf);
+		}
+	}
+}
+
+
+
+int main(int argc, const char* argv[]) {
+	const Benchmarks::Arguments args(argc, argv);
+
+	Config config;
+	config.fourCC = Benchmarks::parseFourCC(args.get("format", "UYVY"));
+	config.resolution = Benchmarks::parseResolution(args.get("resolution", "1920x1080"));
+	config.frameRate = Benchmarks::parseFrameRate(args.get("rate", "60"));
+	config.sweep = parseSweep(args.get("sweep", "1,2,4,8,16,32,48,64"));
+	config.duration = args.getNumber("duration", 5.0);
+	config.warmup = args.getNumber("warmup", 1.0);
+	config.perf = args.has("perf");
+	config.json = args.get("json", "");
+
+	if(args.has("lavapipe")) {
+		Benchmarks::useLavapipe();
+	}
+
+	//Measure the conversions with the hardware counters, if requested
+	Modules::NDI::get().getPerfCounters().setEnabled(config.perf);
+
+	//Serve the frames from in-process senders. All of them are
+	//announced beforehand, so that discovery is not measured
+	Modules::NDI::get().setBackend(Modules::NDI::Backend::LOOPBACK);
+	const auto maxSourceCount = *std::max_element(config.sweep.cbegin(), config.sweep.cend());
+	for(size_t i = 0; i < maxSourceCount; ++i) {
+		NDI::Loopback::addSender(NDI::Loopback::Sender{
+			getSenderName(i),
+			"",
+			{ NDI::Loopback::Format{ config.resolution, config.fourCC, config.frameRate, NDI::VideoFrame::Format::PROGRESSIVE } },
+			0,
+			0,
+			nullptr
+		});
+	}
+
+	Instance::ApplicationInfo appInfo(
+		"NDI source scaling benchmark",
+		Version(0, 1, 0),
+		Verbosity::GEQ_WARNING,
+		{ Modules::NDI::get() }
+	);
+	Instance instance(std::move(appInfo));
+	const auto& vulkan = instance.getVulkan();
+	const auto descriptor = getDescriptor(vulkan, config);
+
+	std::vector<Step> steps(config.sweep.size());
+	for(size_t i = 0; i < steps.size(); ++i) {
+		steps[i].sourceCount = config.sweep[i];
+		runStep(vulkan, descriptor, config, steps[i]);
+
+		if(config.json.empty()) {
+			std::cerr << "Completed " << steps[i].sourceCount << " sources" << std::endl;
+		}
+	}
+
+	//Report
+	if(config.json == "-") {
+		writeJSON(std::cout, config, steps);
+	} else if(!config.json.empty()) {
+		std::ofstream file(config.json);
+		writeJSON(file, config, steps);
+	} else {
+		writeText(std::cout, config, steps);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,381 @@
+/*
+ * This benchmark measures the frame path of Sources::NDI: capture,
+ * frame allocation, conversion, upload and hand-off to the consumer. It runs against the
+ * loopback backend, so that no NDI sender nor runtime is required
+ *
+ * Usage:
+ * zuazo-ndi-source-throughput 	[--format UYVY] [--resolution 1920x1080] [--rate 60]
+ * 								[--sources 1] [--capture progressive|weave|bob|motion-adaptive]
+ * 								[--duration 10] [--warmup 1] [--lavapipe] [--perf] [--json FILE|-]
+ *
+ * --perf measures the conversions with the hardware performance counters
+ * (see NDI::PerfCounters), reporting bytes per cycle for each conversion
+ */
+
+#include "Common.h"
+
+#include <Sources/NDIReceiver.h>
+
+#include <zuazo/Instance.h>
+#include <zuazo/Modules/NDI.h>
+#include <zuazo/NDI/Loopback.h>
+#include <zuazo/NDI/Conversions.h>
+#include <zuazo/NDI/PerfCounters.h>
+#include <zuazo/Graphics/StagedFrame.h>
+
+#include <condition_variable>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+using namespace Zuazo;
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+	FourCC									fourCC;
+	Resolution								resolution;
+	Math::Rational<int>						frameRate;
+	size_t									sourceCount;
+	Sources::NDIReceiver::Deinterlacing		deinterlacing;
+	std::string								captureMode;
+	double									duration;
+	double									warmup;
+	bool									perf;
+	std::string								json;
+};
+
+struct Result {
+	Benchmarks::Samples						capture;
+	Benchmarks::Samples						acquire;
+	Benchmarks::Samples						copy;
+	Benchmarks::Samples						flush;
+	Benchmarks::Samples						push;
+	size_t									frames = 0;
+	size_t									repeated = 0;
+};
+
+/*
+ * Single slot queue between the source and its consumer,
+ * as done by Signal::Output
+ */
+struct Mailbox {
+	std::mutex								mutex;
+	std::condition_variable					cv;
+	Video									video;
+	Clock::time_point						pushTime;
+	bool									measured = false;
+	bool									exit = false;
+};
+
+
+
+static Sources::NDIReceiver::Deinterlacing parseCaptureMode(const std::string& str) {
+	using Deinterlacing = Sources::NDIReceiver::Deinterlacing;
+	if(str == "progressive")		return Deinterlacing::NONE;
+	if(str == "weave")				return Deinterlacing::WEAVE;
+	if(str == "bob")				return Deinterlacing::BOB;
+	if(str == "motion-adaptive")	return Deinterlacing::MOTION_ADAPTIVE;
+	throw std::invalid_argument("Unknown capture mode: " + str);
+}
+
+static Graphics::Frame::Descriptor getDescriptor(const Graphics::Vulkan& vulkan, const Config& config) {
+	//Same as Sources::NDI would advertise for the first supported target
+	const auto colorimetry = NDI::getColorimetry(config.resolution);
+	const auto formatCompatibility = Graphics::StagedFrame::getSupportedFormats(vulkan);
+
+	for(const auto& target : NDI::getConversionTargets(config.fourCC)) {
+		const auto isRGB = target.first == ColorFormat::R8G8B8A8 || target.first == ColorFormat::B8G8R8A8;
+		const VideoMode videoMode(
+			Utils::MustBe<Rate>(Rate(config.frameRate.getNumerator(), config.frameRate.getDenominator())),
+			Utils::MustBe<Resolution>(config.resolution),
+			Utils::MustBe<AspectRatio>(AspectRatio(1, 1)),
+			Utils::MustBe<ColorPrimaries>(colorimetry.primaries),
+			Utils::MustBe<ColorModel>(isRGB ? ColorModel::rgb : colorimetry.model),
+			Utils::MustBe<ColorTransferFunction>(ColorTransferFunction::bt1886),
+			Utils::MustBe<ColorSubsampling>(target.second),
+			Utils::MustBe<ColorRange>(isRGB ? ColorRange::full : colorimetry.range),
+			formatCompatibility.intersect(Utils::MustBe<ColorFormat>(target.first))
+		);
+
+		if(static_cast<bool>(videoMode)) {
+			return videoMode.getFrameDescriptor();
+		}
+	}
+
+	throw std::runtime_error("FourCC is not supported by the GPU");
+}
+
+static std::string getSenderName(size_t index) {
+	return "BENCHMARK (" + std::to_string(index) + ")";
+}
+
+
+
+static void consume(Mailbox& mailbox, Result& result, Clock::time_point measureStart) {
+	std::unique_lock<std::mutex> lock(mailbox.mutex);
+
+	while(true) {
+		mailbox.cv.wait(lock, [&mailbox] { return mailbox.exit || !mailbox.measured; });
+		if(mailbox.exit) {
+			break;
+		}
+
+		const auto now = Clock::now();
+		if(mailbox.pushTime >= measureStart) {
+			result.push.add(now - mailbox.pushTime);
+		}
+		mailbox.measured = true;
+	}
+}
+
+static void runSource(	const Graphics::Vulkan& vulkan,
+						const Graphics::Frame::Descriptor& descriptor,
+						const Config& config,
+						size_t index,
+						Clock::time_point measureStart,
+						Clock::time_point end,
+						Result& result )
+{
+	using Deinterlacing = Sources::NDIReceiver::Deinterlacing;
+
+	auto receiver = Sources::NDIReceiver::get(Sources::NDI::Source(getSenderName(index), ""), "benchmark");
+	const auto handle = receiver->subscribe(
+		false, false,
+		Sources::NDIReceiver::Bandwidth::HIGHEST,
+		config.deinterlacing != Deinterlacing::NONE
+	);
+	const auto upload = receiver->getUpload(
+		vulkan,
+		descriptor,
+		config.fourCC,
+		Sources::NDIReceiver::Region{},
+		config.deinterlacing,
+		false,
+		Sources::NDIReceiver::Timebase::NEAREST,
+		0
+	);
+
+	Mailbox mailbox;
+	std::thread consumer(consume, std::ref(mailbox), std::ref(result), measureStart);
+
+	//Pull at the sender's rate, as the instance would
+	const auto period = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>(1.0 / static_cast<double>(config.frameRate))
+	);
+	auto tick = Clock::now();
+	int64_t lastTimestamp = std::numeric_limits<int64_t>::min();
+	while(tick < end) {
+		tick += period;
+		std::this_thread::sleep_until(tick);
+
+		const auto t0 = Clock::now();
+		const auto frame = receiver->pull(handle);
+		const auto t1 = Clock::now();
+		auto video = receiver->upload(*upload, Sources::NDIReceiver::Field::FIELD0);
+
+		//Frame-syncs repeat the last frame when no new one has arrived. 
+		//Tell them apart by their NDI timestamp, as the staged frame
+		//does not identify the source frame
+		const auto isNew = video && frame.getData() && frame.getTimestamp() != lastTimestamp;
+		if(frame.getData()) {
+			lastTimestamp = frame.getTimestamp();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mailbox.mutex);
+			mailbox.video = video;
+			mailbox.pushTime = Clock::now();
+			mailbox.measured = false;
+		}
+		mailbox.cv.notify_one();
+
+		if(t0 < measureStart) {
+			continue; //Warming up
+		}
+
+		//Conversion only happens when a new frame has been captured
+		result.capture.add(t1 - t0);
+		if(isNew) {
+			result.acquire.add(upload->timings.acquire);
+			result.copy.add(upload->timings.copy);
+			result.flush.add(upload->timings.flush);
+			++result.frames;
+		} else {
+			++result.repeated;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mailbox.mutex);
+		mailbox.exit = true;
+	}
+	mailbox.cv.notify_one();
+	consumer.join();
+
+	receiver->unsubscribe(handle);
+}
+
+
+
+static void writeJSON(std::ostream& os, const Config& config, std::vector<Result>& results, const NDI::PerfCounters::Results& perf) {
+	Result total;
+	for(const auto& result : results) {
+		total.capture.merge(result.capture);
+		total.acquire.merge(result.acquire);
+		total.copy.merge(result.copy);
+		total.flush.merge(result.flush);
+		total.push.merge(result.push);
+		total.frames += result.frames;
+		total.repeated += result.repeated;
+	}
+
+	os << "{\n";
+	os << "\t\"benchmark\": \"source-throughput\",\n";
+	os << "\t\"format\": " << Benchmarks::quote(std::string(reinterpret_cast<const char*>(&config.fourCC), 4)) << ",\n";
+	os << "\t\"resolution\": [" << config.resolution.x << ", " << config.resolution.y << "],\n";
+	os << "\t\"rate\": " << static_cast<double>(config.frameRate) << ",\n";
+	os << "\t\"sources\": " << config.sourceCount << ",\n";
+	os << "\t\"capture\": " << Benchmarks::quote(config.captureMode) << ",\n";
+	os << "\t\"duration_s\": " << config.duration << ",\n";
+	os << "\t\"frames\": " << total.frames << ",\n";
+	os << "\t\"repeated\": " << total.repeated << ",\n";
+	os << "\t\"fps\": " << total.frames / config.duration << ",\n";
+	os << "\t\"fps_per_source\": " << total.frames / config.duration / config.sourceCount << ",\n";
+	os << "\t\"stages\": {\n";
+	os << "\t\t\"capture\": "; total.capture.writeJSON(os); os << ",\n";
+	os << "\t\t\"acquire\": "; total.acquire.writeJSON(os); os << ",\n";
+	os << "\t\t\"copy\": "; total.copy.writeJSON(os); os << ",\n";
+	os << "\t\t\"flush\": "; total.flush.writeJSON(os); os << ",\n";
+	os << "\t\t\"push\": "; total.push.writeJSON(os); os << "\n";
+	os << "\t}";
+	if(config.perf) {
+		os << ",\n\t\"perf\": "; Benchmarks::writePerfCountersJSON(os, perf, "\t");
+	}
+	os << "\n}\n";
+}
+
+static void writeText(std::ostream& os, const Config& config, std::vector<Result>& results, const NDI::PerfCounters::Results& perf) {
+	Result total;
+	for(const auto& result : results) {
+		total.capture.merge(result.capture);
+		total.acquire.merge(result.acquire);
+		total.copy.merge(result.copy);
+		total.flush.merge(result.flush);
+		total.push.merge(result.push);
+		total.frames += result.frames;
+		total.repeated += result.repeated;
+	}
+
+	os << std::fixed << std::setprecision(1);
+	os << "fps: " << total.frames / config.duration;
+	os << " (" << total.frames / config.duration / config.sourceCount << " per source, ";
+	os << total.repeated << " repeated)\n";
+
+	const std::pair<const char*, Benchmarks::Samples*> stages[] = {
+		{ "capture", &total.capture },
+		{ "acquire", &total.acquire },
+		{ "copy", &total.copy },
+		{ "flush", &total.flush },
+		{ "push", &total.push }
+	};
+	for(const auto& stage : stages) {
+		os << std::setw(8) << stage.first << ": ";
+		os << "p50 " << stage.second->getPercentile(50.0) / 1e3 << "us, ";
+		os << "p99 " << stage.second->getPercentile(99.0) / 1e3 << "us, ";
+		os << "p99.9 " << stage.second->getPercentile(99.9) / 1e3 << "us\n";
+	}
+
+	if(config.perf) {
+		os << "\n";
+		Benchmarks::writePerfCountersText(os, perf);
+	}
+}
+
+
+
+int main(int argc, const char* argv[]) {
+	const Benchmarks::Arguments args(argc, argv);
+
+	Config config;
+	config.fourCC = Benchmarks::parseFourCC(args.get("format", "UYVY"));
+	config.resolution = Benchmarks::parseResolution(args.get("resolution", "1920x1080"));
+	config.frameRate = Benchmarks::parseFrameRate(args.get("rate", "60"));
+	config.sourceCount = std::max(static_cast<size_t>(args.getNumber("sources", 1)), size_t(1));
+	config.captureMode = args.get("capture", "progressive");
+	config.deinterlacing = parseCaptureMode(config.captureMode);
+	config.duration = args.getNumber("duration", 10.0);
+	config.warmup = args.getNumber("warmup", 1.0);
+	config.perf = args.has("perf");
+	config.json = args.get("json", "");
+
+	if(args.has("lavapipe")) {
+		Benchmarks::useLavapipe();
+	}
+
+	//Serve the frames from in-process senders
+	auto& perfCounters = Modules::NDI::get().getPerfCounters();
+	perfCounters.setEnabled(config.perf);
+	Modules::NDI::get().setBackend(Modules::NDI::Backend::LOOPBACK);
+	const auto field = (config.deinterlacing == Sources::NDIReceiver::Deinterlacing::NONE) ?
+		NDI::VideoFrame::Format::PROGRESSIVE :
+		NDI::VideoFrame::Format::INTERLEAVED ;
+	for(size_t i = 0; i < config.sourceCount; ++i) {
+		NDI::Loopback::addSender(NDI::Loopback::Sender{
+			getSenderName(i),
+			"",
+			{ NDI::Loopback::Format{ config.resolution, config.fourCC, config.frameRate, field } },
+			0,
+			0,
+			nullptr
+		});
+	}
+
+	Instance::ApplicationInfo appInfo(
+		"NDI source throughput benchmark",
+		Version(0, 1, 0),
+		Verbosity::GEQ_WARNING,
+		{ Modules::NDI::get() }
+	);
+	Instance instance(std::move(appInfo));
+	const auto& vulkan = instance.getVulkan();
+	const auto descriptor = getDescriptor(vulkan, config);
+
+	//Run all the sources concurrently
+	const auto start = Clock::now();
+	const auto measureStart = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.warmup));
+	const auto end = measureStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.duration));
+
+	std::vector<Result> results(config.sourceCount);
+	std::vector<std::thread> threads;
+	for(size_t i = 0; i < config.sourceCount; ++i) {
+		threads.emplace_back(
+			runSource,
+			std::cref(vulkan), std::cref(descriptor), std::cref(config),
+			i, measureStart, end, std::ref(results[i])
+		);
+	}
+
+	//Conversions made during the warmup are not considered
+	if(config.perf) {
+		std::this_thread::sleep_until(measureStart);
+		perfCounters.reset();
+	}
+
+	for(auto& thread : threads) {
+		thread.join();
+	}
+	const auto perf = perfCounters.getResults();
+
+	//Report
+	if(config.json == "-") {
+		writeJSON(std::cout, config, results, perf);
+	} else if(!config.json.empty()) {
+		std::ofstream file(config.json);
+		writeJSON(file, config, results, perf);
+	} else {
+		writeText(std::cout, config, results, perf);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -8,21 +8,25 @@
 #include <zuazo/Instance.h>
 #include <zuazo/Player.h>
 #include <zuazo/Modules/Window.h>
+#include <zuazo/Modules/NDI.h>
 #include <zuazo/Renderers/Window.h>
 #include <zuazo/Consumers/RendererWrapper.h>
-#include <zuazo/NDI/Finder.h>
+#include <zuazo/NDI/Discovery.h>
+#include <zuazo/NDI/SourceCache.h>
 #include <zuazo/Sources/NDI.h>
 
+#include <chrono>
 #include <mutex>
 #include <iostream>
 
 int main(int argc, const char* argv[]) {
-	//Instantiate Zuazo as usual. Note that we're loading the Window module
+	//Instantiate Zuazo as usual. Note that we're loading the Window and NDI modules.
+	//The NDI runtime is loaded in the background when the instance is created
 	Zuazo::Instance::ApplicationInfo appInfo(
 		"NDI Example 00",							//Application's name
 		Zuazo::Version(0, 1, 0),					//Application's version
 		Zuazo::Verbosity::GEQ_INFO,					//Verbosity 
-		{ Zuazo::Modules::Window::get() }			//Modules
+		{ Zuazo::Modules::Window::get(), Zuazo::Modules::NDI::get() } //Modules
 	);
 	Zuazo::Instance instance(std::move(appInfo));
 	std::unique_lock<Zuazo::Instance> lock(instance);
@@ -46,22 +50,30 @@ int main(int argc, const char* argv[]) {
 	//Open the window (now becomes visible)
 	window.asyncOpen(lock);
 
-	//Choose a NDI source
-	const Zuazo::NDI::Finder finder(true, nullptr, nullptr);
-	Zuazo::Utils::BufferView<const Zuazo::NDI::Source> sources;
+	//Show where the NDI runtime came from
+	const auto& loadInfo = Zuazo::Modules::NDI::get().getLoadInfo();
+	std::cout << "NDI runtime " << loadInfo.version << " loaded from " << loadInfo.path;
+	std::cout << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(loadInfo.duration).count() << "ms" << std::endl;
+
+	//Choose a NDI source. Discovery runs in the background. Let the
+	//source cache learn from it, so that moved sources are followed
+	Zuazo::NDI::Discovery discovery(true, nullptr, nullptr);
+	auto& sourceCache = Zuazo::Modules::NDI::get().getSourceCache();
+	sourceCache.attach(discovery);
+	auto sources = discovery.getSources();
 	while(sources.empty()) {
 		std::cout << "No sources... Retrying in 1s" << std::endl;
-		finder.waitForSources(1000);
-		sources = finder.getCurrentSources();
+		discovery.waitForChanges(1000);
+		sources = discovery.getSources();
 	}
 
-	std::cout << "Source found! name: " << sources[0].getName() << " url: " << sources[0].getURL() << std::endl;
+	std::cout << "Source found! name: " << sources[0]->getName() << " url: " << sources[0]->getURL() << std::endl;
 
 	//Create a video source
 	Zuazo::Sources::NDI ndiSource(
 		instance,
 		"NDI test input",
-		sources[0]
+		Zuazo::NDI::Source(*sources[0])
 	);
 	ndiSource.setVideoModeNegotiationCallback(
 		[] (Zuazo::VideoBase&, const std::vector<Zuazo::VideoMode>& compatibility) -> Zuazo::VideoMode {
@@ -80,4 +92,7 @@ int main(int argc, const char* argv[]) {
 
 	std::cout << "\nSource's video-mode:\n";
 	std::cout << "\t-" << ndiSource.getVideoMode() << "\n";
+
+	//The discovery is about to be destroyed
+	sourceCache.detach();
 }
\ No newline at end of file
@@ -2,16 +2,42 @@
 
 #include <zuazo/Instance.h>
 
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <string>
 
 struct NDIlib_v4;
 
+namespace Zuazo::NDI {
+class RecvPool;
+class SourceCache;
+class Tracer;
+class Sampler;
+class Exporter;
+class PerfCounters;
+class FlightRecorder;
+}
+
 namespace Zuazo::Modules {
 
 class NDI final
 	: public Instance::Module
 {
 public:
+	enum class Backend {
+		RUNTIME,			//libndi, loaded dynamically
+		LOOPBACK,			//In-process synthetic senders. See Zuazo::NDI::Loopback
+	};
+
+	struct LoadInfo {
+		std::string							path;
+		std::string							version;
+		std::chrono::nanoseconds			duration; //Including SDK's initialization
+	};
+
 	~NDI();
 
 	static constexpr std::string_view name = "NDI";
@@ -19,19 +45,53 @@ public:
 
 	static const NDI& 					get();
 
-	const NDIlib_v4&					getNDI() const noexcept;
+	virtual void						initialize(Instance& instance) const final;
+
+	bool								setBackend(Backend backend) const;
+	Backend								getBackend() const noexcept;
+
+	void								preload() const;
+	bool								isLoaded() const noexcept;
+	const LoadInfo&						getLoadInfo() const;
+
+	const NDIlib_v4&					getNDI() const;
+	const NDIlib_v4&					getLoadedNDI() const noexcept;
+	Zuazo::NDI::RecvPool&				getRecvPool() const noexcept;
+	Zuazo::NDI::SourceCache&			getSourceCache() const noexcept;
+	Zuazo::NDI::Tracer&					getTracer() const noexcept;
+	Zuazo::NDI::Sampler&				getSampler() const noexcept;
+	Zuazo::NDI::Exporter&				getExporter() const noexcept;
+	Zuazo::NDI::PerfCounters&			getPerfCounters() const noexcept;
+	Zuazo::NDI::FlightRecorder&			getFlightRecorder() const noexcept;
 
 private:
 	class DynamicLoad;
-	std::unique_ptr<DynamicLoad>		m_dynamicLoad;
-	const NDIlib_v4&					m_ndi;
+
+	//The runtime is loaded asynchronously on the first request
+	mutable std::mutex					m_loadMutex;
+	mutable std::atomic<Backend>		m_backend; //Written with m_loadMutex locked
+	mutable std::shared_future<void>	m_loadFuture;
+	mutable std::unique_ptr<DynamicLoad> m_dynamicLoad;
+	mutable std::atomic<const NDIlib_v4*> m_ndi;
+	mutable LoadInfo					m_loadInfo;
+
+	std::unique_ptr<Zuazo::NDI::RecvPool> m_recvPool;
+	std::unique_ptr<Zuazo::NDI::SourceCache> m_sourceCache;
+	std::unique_ptr<Zuazo::NDI::Tracer>	m_tracer;
+	std::unique_ptr<Zuazo::NDI::Sampler> m_sampler;
+	std::unique_ptr<Zuazo::NDI::Exporter> m_exporter;
+	std::unique_ptr<Zuazo::NDI::PerfCounters> m_perfCounters;
+	std::unique_ptr<Zuazo::NDI::FlightRecorder> m_flightRecorder;
 
 	NDI();
 	NDI(const NDI& other) = delete;
 
 	NDI& 								operator=(const NDI& other) = delete;
 
+	void								load() const;
+
 	static std::unique_ptr<NDI> 		s_singleton;
+	static std::once_flag				s_singletonFlag;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <zuazo/Resolution.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Zuazo::NDI {
+
+/*
+ * Analyzer gathers luma statistics of the frames while they are being 
+ * converted, so that they are only read once. Luma is analyzed in 8 bits
+ */
+class Analyzer {
+public:
+	enum class Layout {
+		Y8,					//Planar luma, 8 bits
+		Y16,				//Planar luma, 16 bits
+		UYVY,				//Luma on odd bytes
+		RGBA,
+		BGRA
+	};
+
+	static constexpr size_t HISTOGRAM_SIZE = 256;
+	static constexpr size_t SIGNATURE_SIZE = 8; //Signature is a SIGNATURE_SIZE x SIGNATURE_SIZE thumbnail
+
+	static constexpr uint8_t DEFAULT_BLACK_THRESHOLD = 8; //Above black level
+	static constexpr uint8_t DEFAULT_FREEZE_THRESHOLD = 1; //Mean absolute difference of the signature
+	static constexpr size_t DEFAULT_FREEZE_FRAMES = 25;
+
+	using Histogram = std::array<uint32_t, HISTOGRAM_SIZE>;
+	using Signature = std::array<uint8_t, SIGNATURE_SIZE*SIGNATURE_SIZE>;
+
+	struct Result {
+		Histogram					histogram;
+		uint8_t						minimum;
+		uint8_t						maximum;
+		float						average;
+		float						clipped;		//Ratio of samples at or above the white level
+		Signature					signature;
+		size_t						frozenFrames;	//Consecutive frames with the same signature
+		bool						black;
+		bool						frozen;
+	};
+
+	Analyzer();
+	Analyzer(const Analyzer& other) = delete;
+	Analyzer(Analyzer&& other) = default;
+	~Analyzer() = default;
+
+	Analyzer&						operator=(const Analyzer& other) = delete;
+	Analyzer&						operator=(Analyzer&& other) = default;
+
+	void							setBlackThreshold(uint8_t threshold) noexcept;
+	uint8_t							getBlackThreshold() const noexcept;
+
+	void							setFreezeThreshold(uint8_t threshold) noexcept;
+	uint8_t							getFreezeThreshold() const noexcept;
+
+	void							setFreezeFrames(size_t count) noexcept;
+	size_t							getFreezeFrames() const noexcept;
+
+	void							begin(Resolution resolution);
+	void							analyzeRow(size_t row, const std::byte* data, Layout layout) noexcept;
+	const Result&					end() noexcept;
+
+	const Result&					getResult() const noexcept;
+	void							reset() noexcept;
+
+private:
+	static constexpr size_t HISTOGRAM_COUNT = 4; //Interleaved to avoid store-to-load stalls
+
+	uint8_t							m_blackThreshold;
+	uint8_t							m_freezeThreshold;
+	size_t							m_freezeFrames;
+
+	Resolution						m_resolution;
+	uint8_t							m_blackLevel;
+	uint8_t							m_whiteLevel;
+	std::array<Histogram, HISTOGRAM_COUNT> m_histograms;
+	uint8_t							m_minimum;
+	uint8_t							m_maximum;
+	std::array<uint64_t, SIGNATURE_SIZE*SIGNATURE_SIZE> m_cells;
+	std::array<size_t, SIGNATURE_SIZE+1> m_columns;
+	std::vector<uint8_t>			m_row;
+
+	Result							m_result;
+	bool							m_hasSignature;
+
+};
+
+}
\ No newline at end of file
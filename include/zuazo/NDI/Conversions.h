@@ -1,20 +1,88 @@
 #pragma once
 
 #include "VideoFrame.h"
+#include "Analyzer.h"
 
 #include <zuazo/Graphics/StagedFrame.h>
+#include <zuazo/Resolution.h>
+#include <zuazo/Utils/BufferView.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
 
 namespace Zuazo::NDI {
 
-void copyRGBA(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept;
-void copyUYVY(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept;
-void copyP216(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept;
-void copyPA16(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept;
-void copyI420(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept;
-void copyNV12(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept;
+/*
+ * Rectangular area of a frame, in pixels
+ */
+struct Region {
+	uint32_t									x;
+	uint32_t									y;
+	Resolution									resolution;
+};
+
+bool operator==(const Region& lhs, const Region& rhs) noexcept;
+bool operator!=(const Region& lhs, const Region& rhs) noexcept;
+
+using CopyFunction = void (*)(const VideoFrame&, const Region&, Graphics::StagedFrame&, Analyzer*);
+using ConversionTarget = std::pair<ColorFormat, ColorSubsampling>;
+
+struct Colorimetry {
+	ColorModel									model;	//For YCbCr frames
+	ColorPrimaries								primaries;
+	ColorRange									range;	//For YCbCr frames
+};
+
+struct ConversionCost {
+	size_t										cpu;	//Estimated CPU work per frame, in bytes of equivalent memcpy
+	size_t										upload;	//Bytes uploaded to the GPU per frame
+};
+
+void copyRGBA(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept;
+void copyUYVY(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept;
+void copyP216(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept;
+void copyPA16(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept;
+void copyI420(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept;
+void copyNV12(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept;
+
+void copyUYVYtoNV16(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept;
+void copyUYVAtoPA8(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept;
+void copyYV12toI420(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept;
+
+void copyRGBAPremultiplied(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept;
+void copyPA16Premultiplied(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept;
+void copyUYVAtoPA8Premultiplied(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept;
+void premultiplyAlpha(Graphics::StagedFrame& frame) noexcept;
+void analyzeLuma(const VideoFrame& src, const Region& region, Analyzer& analyzer) noexcept;
+
+Region getEffectiveRegion(const Region& crop, Resolution resolution) noexcept;
+Colorimetry getColorimetry(Resolution resolution) noexcept;
+
+bool hasAlpha(FourCC src) noexcept;
+bool isPlaneCopy(CopyFunction copy) noexcept;
+CopyFunction getCopyFunction(	FourCC src, 
+								ColorFormat dstFormat, 
+								ColorSubsampling dstSubsampling,
+								bool premultiply = false ) noexcept;
+
+Utils::BufferView<const ConversionTarget> getConversionTargets(FourCC src) noexcept;
+ConversionCost estimateConversionCost(	FourCC src,
+										Resolution resolution,
+										ColorFormat dstFormat,
+										ColorSubsampling dstSubsampling ) noexcept;
 
-void copyUYVYtoNV16(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept;
-void copyUYVAtoPA8(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept;
-void copyYV12toI420(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept;
+bool canResample(FourCC src, ColorFormat dst) noexcept;
+void resample(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst) noexcept;
+void decimate(	const VideoFrame& src, 
+				const Region& region,
+				Graphics::StagedFrame* half, 
+				Graphics::StagedFrame* quarter ) noexcept;
+void blend(	const VideoFrame& a,
+			const VideoFrame& b,
+			uint32_t weight,
+			const Region& region,
+			Graphics::StagedFrame& dst,
+			Analyzer* analyzer ) noexcept;
 
 }
\ No newline at end of file
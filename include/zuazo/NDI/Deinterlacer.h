@@ -0,0 +1,67 @@
+#pragma once
+
+#include "VideoFrame.h"
+#include "Conversions.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Zuazo::NDI {
+
+/*
+ * Deinterlacer interpolates the missing field of interleaved frames. 
+ * Frames are not copied: motion adaptive deinterlacing references the 
+ * previous frame, which is kept alive by the caller. When the copy keeps
+ * the layout of the planes, frames are deinterlaced straight into the 
+ * staged frame
+ */
+class Deinterlacer {
+public:
+	enum class Mode {
+		NONE,				//Progressive frames are requested to the SDK
+		WEAVE,
+		BOB,
+		MOTION_ADAPTIVE
+	};
+
+	static constexpr uint8_t DEFAULT_MOTION_THRESHOLD = 12;
+
+	explicit Deinterlacer(Mode mode = Mode::NONE);
+	Deinterlacer(const Deinterlacer& other) = delete;
+	Deinterlacer(Deinterlacer&& other) = default;
+	~Deinterlacer() = default;
+
+	Deinterlacer&					operator=(const Deinterlacer& other) = delete;
+	Deinterlacer&					operator=(Deinterlacer&& other) = default;
+
+	void							setMode(Mode mode) noexcept;
+	Mode							getMode() const noexcept;
+
+	void							setMotionThreshold(uint8_t threshold) noexcept;
+	uint8_t							getMotionThreshold() const noexcept;
+
+	bool							isDeinterlacing(const VideoFrame& frame) const noexcept;
+	const VideoFrame&				process(const VideoFrame& frame, 
+											const VideoFrame& previous, 
+											VideoFrame::Format field );
+	void							process(const VideoFrame& frame, 
+											const VideoFrame& previous, 
+											VideoFrame::Format field,
+											const Region& region,
+											Graphics::StagedFrame& dst,
+											Analyzer* analyzer ) const noexcept;
+	void							reset() noexcept;
+
+private:
+	Mode							m_mode;
+	uint8_t							m_motionThreshold;
+
+	VideoFrame						m_output;
+	std::vector<std::byte>			m_outputData;
+
+	Mode							getMode(const VideoFrame& frame, const VideoFrame& previous) const noexcept;
+
+};
+
+}
\ No newline at end of file
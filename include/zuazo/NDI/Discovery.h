@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Finder.h"
+#include "Source.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Zuazo::NDI {
+
+/*
+ * Discovery keeps a registry of the sources in the network, updated
+ * incrementally by a background thread. Entries are immutable and 
+ * shared, so they remain valid after the source disappears
+ */
+class Discovery {
+public:
+	class Entry {
+	public:
+		Entry(std::string name, std::string url);
+		Entry(const Entry& other) = delete;
+		~Entry() = default;
+
+		Entry&							operator=(const Entry& other) = delete;
+
+		operator Source() const noexcept;
+
+		const std::string&				getName() const noexcept;
+		const std::string&				getURL() const noexcept;
+
+	private:
+		std::string						m_name;
+		std::string						m_url;
+	};
+
+	enum class Event {
+		ADDED,
+		REMOVED,
+		CHANGED				//URL has changed for the same name
+	};
+
+	using EntryRef = std::shared_ptr<const Entry>;
+	using Callback = std::function<void(Event, const EntryRef&)>;
+	using Callbacks = std::list<Callback>;
+	using Handle = Callbacks::iterator;
+
+	static constexpr uint32_t DEFAULT_POLL_TIMEOUT = 500; //ms
+
+	explicit Discovery(	bool showLocalSources = true,
+						const char* groups = nullptr,
+						const char* extraIps = nullptr );
+	Discovery(const Discovery& other) = delete;
+	~Discovery();
+
+	Discovery&							operator=(const Discovery& other) = delete;
+
+	EntryRef							findByName(std::string_view name) const;
+	EntryRef							findByURL(std::string_view url) const;
+	std::vector<EntryRef>				getSources() const;
+	size_t								size() const;
+
+	bool								waitForChanges(uint32_t timeo) const;
+
+	//Callbacks are invoked from the discovery thread, with the callback
+	//list locked. They may query the registry, but must not subscribe
+	//nor unsubscribe, as that would deadlock
+	Handle								subscribe(Callback callback);
+	void								unsubscribe(Handle handle);
+
+private:
+	struct Record {
+		EntryRef						entry;
+		uint64_t						generation;
+	};
+
+	//Keys refer to the strings held by the entries
+	using Registry = std::unordered_map<std::string_view, Record>;
+	using URLIndex = std::unordered_map<std::string_view, EntryRef>;
+
+	Finder								m_finder;
+
+	mutable std::mutex					m_mutex;
+	mutable std::condition_variable		m_changed;
+	Registry							m_registry;
+	URLIndex							m_urlIndex;
+	uint64_t							m_generation;
+	uint64_t							m_changeCount;
+
+	std::mutex							m_callbackMutex;
+	Callbacks							m_callbacks;
+
+	std::atomic<bool>					m_exit;
+	std::thread							m_thread;
+
+	void								threadFunc();
+	void								update();
+	void								indexURL(const EntryRef& entry);
+	void								notify(Event event, const EntryRef& entry);
+
+};
+
+}
\ No newline at end of file
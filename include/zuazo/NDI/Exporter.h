@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace Zuazo::NDI {
+
+/*
+ * Exporter serves the metrics of every receiver in the Prometheus text
+ * exposition format, over HTTP on a TCP port or a Unix socket. Metrics
+ * are plain atomics updated by the receivers, so serving a scrape never
+ * waits for the capture
+ */
+class Exporter {
+public:
+	struct Metrics {
+		//Counters
+		std::atomic<uint64_t>			capturedFrames{ 0 };
+		std::atomic<uint64_t>			duplicatedFrames{ 0 };	//Captured again, as no new one has arrived
+		std::atomic<uint64_t>			droppedFrames{ 0 };		//By the receiver, as reported by the SDK
+		std::atomic<uint64_t>			formatChanges{ 0 };
+		std::atomic<uint64_t>			conversions{ 0 };
+		std::atomic<uint64_t>			conversionTime{ 0 };		//In nanoseconds
+		std::atomic<uint64_t>			uploadedBytes{ 0 };
+
+		//Gauges
+		std::atomic<double>				frameRate{ 0.0 };		//Received by the SDK, as sampled
+		std::atomic<int32_t>			queueDepth{ 0 };
+		std::atomic<int32_t>			connections{ 0 };
+		std::atomic<bool>				programTally{ false };
+		std::atomic<bool>				previewTally{ false };
+	};
+
+	using MetricsRef = std::shared_ptr<Metrics>;
+
+	struct Entry {
+		std::string						source;
+		MetricsRef						metrics;
+	};
+
+	using Entries = std::list<Entry>;
+	using Handle = Entries::iterator;
+
+	static constexpr const char* DEFAULT_ADDRESS = "127.0.0.1";
+	static constexpr const char* CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+
+	Exporter();
+	Exporter(const Exporter& other) = delete;
+	~Exporter();
+
+	Exporter&							operator=(const Exporter& other) = delete;
+
+	Handle								add(std::string source, MetricsRef metrics);
+	void								remove(Handle handle);
+
+	void								listen(uint16_t port, const char* address = DEFAULT_ADDRESS);
+	void								listen(const std::string& path);
+	void								stop();
+	bool								isListening() const noexcept;
+
+	void								write(std::ostream& os) const;
+
+private:
+	mutable std::mutex					m_mutex;
+	Entries								m_entries;
+
+	int									m_socket;
+	std::string							m_socketPath;
+	std::atomic<bool>					m_exit;
+	std::thread							m_thread;
+
+	void								start(int socket);
+	void								threadFunc();
+	void								serve(int connection) const;
+
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace Zuazo::NDI {
+
+/*
+ * FlightRecorder keeps the last events of every receiver in a fixed size
+ * ring, so that glitches can be analyzed after they have happened. It is
+ * always on: recording is lock-free and allocation free, shared by all
+ * the threads. Once full, the oldest events are overwritten. Its contents
+ * can be dumped in a compact binary form on demand or when a signal is
+ * received, to be decoded by zuazo-ndi-flight-recorder
+ */
+class FlightRecorder {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	//Meaning of the arguments is given for each event
+	enum class Event : uint32_t {
+		CAPTURE,			//NDI timestamp, timecode
+		REPEAT,				//NDI timestamp. Frame-sync repeated the last frame
+		FORMAT_CHANGE,		//Width << 32 | height, FourCC << 32 | frame format
+		CONVERSION,			//Duration in nanoseconds, NDI timestamp
+		DROP,				//Frames dropped by the receiver since the last one, total
+		POOL_EXHAUSTED,		//No standby receiver was available for a pooled source
+		TALLY,				//Program, preview
+		RECONNECT,			//Source has moved to another URL
+		CONNECTIONS,		//Connection count
+
+		COUNT
+	};
+
+	//Binary layout of the events of a dump
+	struct Record {
+		uint64_t							time;		//Steady clock, in nanoseconds
+		uint32_t							source;
+		Event								event;
+		int64_t								arg0;
+		int64_t								arg1;
+	};
+
+	struct Dump {
+		int64_t								systemTime;	//Wall clock when dumped, in nanoseconds since the epoch
+		uint64_t							steadyTime;	//Steady clock when dumped, in nanoseconds
+		std::vector<std::string>			sources;
+		std::vector<Record>					records;	//Oldest first
+	};
+
+	static constexpr size_t DEFAULT_CAPACITY = 1 << 16; //Events
+	static constexpr char MAGIC[8] = { 'Z', 'N', 'D', 'I', 'F', 'L', 'R', '1' };
+
+	explicit FlightRecorder(size_t capacity = DEFAULT_CAPACITY);
+	FlightRecorder(const FlightRecorder& other) = delete;
+	~FlightRecorder();
+
+	FlightRecorder&						operator=(const FlightRecorder& other) = delete;
+
+	void								setPath(std::string path);
+	const std::string&					getPath() const noexcept;
+
+	uint32_t							getSourceId(std::string_view name);
+
+	void								record(	Event event,
+												uint32_t source,
+												int64_t arg0 = 0,
+												int64_t arg1 = 0 ) noexcept;
+	void								clear() noexcept;
+
+	void								write(std::ostream& os) const;
+	bool								dump() const;
+	bool								dump(const std::string& path) const;
+	void								dumpOnSignal(int signal);
+
+	static Dump							read(std::istream& is);
+	static std::string_view				getEventName(Event event) noexcept;
+
+private:
+	struct Slot;
+
+	uint64_t							m_originTicks;
+	uint64_t							m_originTime;
+	std::unique_ptr<Slot[]>				m_slots;
+	size_t								m_mask;
+	std::atomic<uint64_t>				m_head;
+	std::atomic<uint64_t>				m_tail;	//Events before it have been cleared
+
+	mutable std::mutex					m_mutex;
+	std::string							m_path;
+	std::vector<std::string>			m_sources;
+
+	int									m_signal;
+	int									m_signalPipe[2];
+	std::thread							m_signalThread;
+
+	void								signalThreadFunc();
+
+};
+
+}
\ No newline at end of file
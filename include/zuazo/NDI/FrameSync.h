@@ -17,8 +17,9 @@ public:
 
 	FrameSync&						operator=(const FrameSync& other) = delete;
 	FrameSync&						operator=(FrameSync&& other) noexcept;
-	
-	
+
+	explicit operator bool() const noexcept;
+
 
 	void							capture(VideoFrame& frame, VideoFrame::Format format) noexcept;
 	void							free(VideoFrame& frame) noexcept;
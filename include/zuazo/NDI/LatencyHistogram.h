@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace Zuazo::NDI {
+
+/*
+ * LatencyHistogram records durations in log-linear buckets, as HDR
+ * histograms do: each power of two is split in SUB_BUCKET_COUNT linear
+ * buckets, so that the relative error is bounded by 1/SUB_BUCKET_COUNT
+ * over the whole range. Recording is wait-free and it can be queried
+ * from any thread while it is being written
+ */
+class LatencyHistogram {
+public:
+	using Duration = std::chrono::nanoseconds;
+
+	static constexpr size_t SUB_BUCKET_BITS = 5;
+	static constexpr size_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+	static constexpr size_t MAX_BITS = 36; //~68s. Longer durations are clamped
+	static constexpr size_t BUCKET_COUNT = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+	struct Summary {
+		uint64_t						count;
+		Duration						p50;
+		Duration						p90;
+		Duration						p99;
+		Duration						max;
+	};
+
+	LatencyHistogram();
+	LatencyHistogram(const LatencyHistogram& other) = delete;
+	~LatencyHistogram() = default;
+
+	LatencyHistogram&				operator=(const LatencyHistogram& other) = delete;
+
+	void							record(Duration duration) noexcept;
+	void							reset() noexcept;
+
+	uint64_t						getCount() const noexcept;
+	Duration						getPercentile(double percentile) const noexcept;
+	Duration						getMax() const noexcept;
+	Summary							getSummary() const noexcept;
+
+private:
+	std::array<std::atomic<uint64_t>, BUCKET_COUNT> m_buckets;
+	std::atomic<uint64_t>			m_count;
+	std::atomic<uint64_t>			m_max;
+
+	static size_t					getBucketIndex(uint64_t value) noexcept;
+	static uint64_t					getBucketValue(size_t index) noexcept;
+
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "VideoFrame.h"
+#include "Recording.h"
+
+#include <zuazo/FourCC.h>
+#include <zuazo/Resolution.h>
+#include <zuazo/Math/Rational.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct NDIlib_v4;
+
+namespace Zuazo::NDI {
+
+/*
+ * Loopback is an in-process stand-in of the NDI runtime. It implements the
+ * entry points used by this library, serving synthetic or recorded frames 
+ * from virtual senders. This allows exercising Sources::NDI without the runtime or a 
+ * network sender. It gets selected with Modules::NDI::setBackend() or by
+ * setting ZUAZO_NDI_BACKEND=loopback in the environment
+ */
+class Loopback {
+public:
+	struct Format {
+		Resolution							resolution;
+		FourCC								fourCC;
+		Math::Rational<int>					frameRate;
+		VideoFrame::Format					field;	//PROGRESSIVE or INTERLEAVED
+	};
+
+	struct Sender {
+		std::string							name;
+		std::string							url;			//Generated if empty
+		std::vector<Format>					formats;		//Cycled through
+		uint32_t							formatPeriod;	//Frames before switching to the next format. 0 for never
+		int64_t								jitter;			//Maximum delivery delay, in 100ns units
+		std::shared_ptr<const Recording>	recording;		//Replayed in a loop instead of the formats if set
+	};
+
+	Loopback() = delete;
+
+	static void								addSender(Sender sender);
+	static void								removeSender(std::string_view name);
+	static void								clear();
+	static size_t							size();
+
+	static std::vector<Format>				getAllFormats(	Resolution resolution,
+															Math::Rational<int> frameRate );
+	static const NDIlib_v4&					getInterface() noexcept;
+
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <zuazo/FourCC.h>
+#include <zuazo/ColorFormat.h>
+#include <zuazo/ColorSubsampling.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace Zuazo::NDI {
+
+/*
+ * PerfCounters measures conversions with the hardware performance
+ * counters of the calling thread (perf_event_open), aggregating them per
+ * FourCC and destination format. It is meant to tell whether a conversion
+ * is bandwidth bound or stalls on cache misses. Disabled by default, as
+ * each measurement costs a couple of system calls. Counters which are not
+ * available (e.g. due to perf_event_paranoid or virtualization) are
+ * reported as unmeasured
+ */
+class PerfCounters {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	enum class Counter {
+		CYCLES,
+		INSTRUCTIONS,
+		CACHE_MISSES,		//Last level cache
+
+		COUNT
+	};
+
+	struct Key {
+		FourCC								source;
+		ColorFormat							format;
+		ColorSubsampling					subsampling;
+	};
+
+	struct Reading {
+		bool								valid;
+		Clock::time_point					time;
+		uint64_t							enabled;	//Time the group was enabled, in nanoseconds
+		uint64_t							running;	//Time the group was counting, in nanoseconds
+		std::array<uint64_t, static_cast<size_t>(Counter::COUNT)> values;
+		std::array<bool, static_cast<size_t>(Counter::COUNT)> measured;
+	};
+
+	struct Totals {
+		uint64_t							calls = 0;
+		uint64_t							bytes = 0;	//Read and written
+		uint64_t							time = 0;	//In nanoseconds
+		std::array<uint64_t, static_cast<size_t>(Counter::COUNT)> values = {};
+		std::array<uint64_t, static_cast<size_t>(Counter::COUNT)> measured = {}; //Calls where the counter was available
+
+		double								getBytesPerCycle() const noexcept;
+		double								getInstructionsPerCycle() const noexcept;
+		double								getPerCall(Counter counter) const noexcept;
+	};
+
+	using Results = std::vector<std::pair<Key, Totals>>;
+
+	PerfCounters();
+	PerfCounters(const PerfCounters& other) = delete;
+	~PerfCounters();
+
+	PerfCounters&						operator=(const PerfCounters& other) = delete;
+
+	void								setEnabled(bool enabled) noexcept;
+	bool								isEnabled() const noexcept;
+	bool								isSupported() noexcept;
+
+	Reading								begin() noexcept;
+	void								end(const Key& key, const Reading& begin, size_t bytes) noexcept;
+
+	Results								getResults() const;
+	void								reset();
+
+	static std::string_view				getCounterName(Counter counter) noexcept;
+
+private:
+	struct Group;
+
+	struct KeyCompare {
+		bool operator()(const Key& lhs, const Key& rhs) const noexcept;
+	};
+
+	uint64_t							m_id;
+	std::atomic<bool>					m_enabled;
+
+	mutable std::mutex					m_mutex;
+	std::vector<std::unique_ptr<Group>>	m_groups;
+	std::map<Key, Totals, KeyCompare>	m_totals;
+
+	Group*								getGroup() noexcept;
+	bool								read(Reading& reading) noexcept;
+
+};
+
+}
\ No newline at end of file
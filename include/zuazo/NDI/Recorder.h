@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Recv.h"
+#include "Recording.h"
+#include "Source.h"
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+namespace Zuazo::NDI {
+
+/*
+ * Recorder captures the frames of a source into a Recording
+ * on a background thread, until it gets destroyed
+ */
+class Recorder {
+public:
+	static constexpr uint32_t DEFAULT_CAPTURE_TIMEOUT = 100; //ms
+
+	Recorder(	const Source& source, 
+				const std::string& path,
+				Recv::Bandwidth bandwidth = Recv::Bandwidth::HIGHEST );
+	Recorder(const Recorder& other) = delete;
+	~Recorder();
+
+	Recorder&							operator=(const Recorder& other) = delete;
+
+	size_t								getFrameCount() const noexcept;
+
+private:
+	Recording::Writer					m_writer;
+	Recv								m_receiver;
+	std::atomic<size_t>					m_frameCount;
+
+	std::atomic<bool>					m_exit;
+	std::thread							m_thread;
+
+	void								threadFunc();
+
+};
+
+}
\ No newline at end of file
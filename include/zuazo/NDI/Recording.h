@@ -0,0 +1,60 @@
+#pragma once
+
+#include "VideoFrame.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Zuazo::NDI {
+
+/*
+ * Recording is a sequence of video frames stored on disk. Each frame is 
+ * stored as a header followed by its raw planes, both page-aligned. This 
+ * allows memory-mapping the file and using the frames without copies
+ */
+class Recording {
+public:
+	static constexpr size_t ALIGNMENT = 4096;
+	static constexpr uint32_t VERSION = 1;
+
+	class Writer {
+	public:
+		explicit Writer(const std::string& path);
+		Writer(const Writer& other) = delete;
+		~Writer() = default;
+
+		Writer&							operator=(const Writer& other) = delete;
+
+		void							write(const VideoFrame& frame);
+		void							flush();
+		size_t							size() const noexcept;
+
+	private:
+		std::ofstream					m_file;
+		size_t							m_frameCount;
+
+		void							pad();
+
+	};
+
+	explicit Recording(const std::string& path);
+	Recording(const Recording& other) = delete;
+	~Recording();
+
+	Recording&							operator=(const Recording& other) = delete;
+
+	size_t								size() const noexcept;
+	bool								empty() const noexcept;
+	const VideoFrame&					operator[](size_t index) const noexcept;
+
+private:
+	void*								m_data;
+	size_t								m_size;
+	std::vector<VideoFrame>				m_frames;
+
+};
+
+}
\ No newline at end of file
@@ -36,6 +36,19 @@ public:
 		STATUS_CHANGE 	= 100
 	};
 
+	//Frame counts of each kind
+	struct Performance {
+		int64_t						video;
+		int64_t						audio;
+		int64_t						metadata;
+	};
+
+	struct Queue {
+		int32_t						video;
+		int32_t						audio;
+		int32_t						metadata;
+	};
+
 	Recv(void* ptr) noexcept;
 	Recv(	const Source& source,
 			ColorFormat format,
@@ -48,6 +61,8 @@ public:
 
 	Recv&							operator=(const Recv& other) = delete;
 	Recv&							operator=(Recv&& other) noexcept;
+
+	explicit operator bool() const noexcept;
 	
 	
 	void							connect(const Source& source) noexcept;	
@@ -57,6 +72,10 @@ public:
 
 	bool							setTally(bool pgm, bool pvw) noexcept;
 
+	void							getPerformance(Performance* total, Performance* dropped) const noexcept;
+	Queue							getQueue() const noexcept;
+	int32_t							getConnectionCount() const noexcept;
+
 private:
 	void*							m_impl;
 
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Recv.h"
+#include "Source.h"
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <mutex>
+
+namespace Zuazo::NDI {
+
+class RecvPool {
+public:
+	using Standby = std::pair<Recv, Recv::Bandwidth>;
+
+	RecvPool();
+	RecvPool(const RecvPool& other) = delete;
+	~RecvPool();
+
+	RecvPool&						operator=(const RecvPool& other) = delete;
+
+	void							addSource(	const Source& source,
+												Recv::Bandwidth bandwidth = Recv::Bandwidth::LOWEST );
+	void							removeSource(const Source& source);
+	void							clear();
+
+	bool							isPooled(const Source& source) const;
+	size_t							size() const;
+
+	Standby							acquire(const Source& source);
+	void							release(const Source& source, Recv recv);
+
+private:
+	struct Entry {
+		Recv::Bandwidth					bandwidth;
+		Recv							standby;
+	};
+
+	using Entries = std::unordered_map<std::string, Entry>;
+
+	mutable std::mutex				m_mutex;
+	Entries							m_entries;
+
+	static std::string				getKey(const Source& source);
+
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+
+namespace Zuazo::NDI {
+
+/*
+ * Sampler periodically invokes its subscribers from a background
+ * thread, so that statistics can be gathered without interfering
+ * with the capture. The thread is only started when the first
+ * subscription is made
+ */
+class Sampler {
+public:
+	using Callback = std::function<void()>;
+	using Callbacks = std::list<Callback>;
+	using Handle = Callbacks::iterator;
+
+	static constexpr std::chrono::milliseconds DEFAULT_INTERVAL = std::chrono::seconds(1);
+
+	Sampler();
+	Sampler(const Sampler& other) = delete;
+	~Sampler();
+
+	Sampler&							operator=(const Sampler& other) = delete;
+
+	void								setInterval(std::chrono::milliseconds interval);
+	std::chrono::milliseconds			getInterval() const;
+
+	Handle								subscribe(Callback callback);
+	void								unsubscribe(Handle handle);
+
+private:
+	mutable std::mutex					m_mutex;
+	std::condition_variable				m_changed;
+	std::chrono::milliseconds			m_interval;
+	bool								m_exit;
+
+	//Held while the callbacks are invoked, so that they are
+	//not running once unsubscribed
+	std::mutex							m_callbackMutex;
+	Callbacks							m_callbacks;
+
+	std::thread							m_thread;
+
+	void								threadFunc();
+
+};
+
+}
\ No newline at end of file
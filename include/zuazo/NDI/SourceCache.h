@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Discovery.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace Zuazo::NDI {
+
+/*
+ * SourceCache remembers the last known URL of each source name, optionally
+ * persisting it on disk. This allows connecting to a source by its name
+ * right after startup, without waiting for the discovery. When attached to
+ * a Discovery, the cache is corrected as soon as a source changes its URL.
+ * Attaching is opt-in: the module does not run a Discovery on its own, so
+ * the application must attach the one it uses and detach it before it is
+ * destroyed. Subscribers are only notified when a known URL changes.
+ * Changes are written to disk at most once per SAVE_INTERVAL, as many
+ * sources may be learnt at once, and when detached or destroyed
+ */
+class SourceCache {
+public:
+	using Callback = std::function<void(const std::string&, const std::string&)>;
+	using Callbacks = std::list<Callback>;
+	using Handle = Callbacks::iterator;
+
+	static constexpr uint32_t SAVE_INTERVAL = 1000; //ms
+
+	SourceCache();
+	SourceCache(const SourceCache& other) = delete;
+	~SourceCache();
+
+	SourceCache&						operator=(const SourceCache& other) = delete;
+
+	void								setPath(std::string path);
+	const std::string&					getPath() const noexcept;
+
+	void								attach(Discovery& discovery);
+	void								detach();
+
+	std::string							lookup(std::string_view name) const;
+	void								update(std::string_view name, std::string_view url);
+	void								remove(std::string_view name);
+	void								clear();
+	size_t								size() const;
+
+	bool								load();
+	bool								save() const;
+
+	Handle								subscribe(Callback callback);
+	void								unsubscribe(Handle handle);
+
+private:
+	using Clock = std::chrono::steady_clock;
+	using Entries = std::unordered_map<std::string, std::string>;
+
+	mutable std::mutex					m_mutex;
+	std::string							m_path;
+	Entries								m_entries;
+	mutable bool						m_dirty;
+	mutable Clock::time_point			m_lastSave;
+
+	mutable std::mutex					m_saveMutex;
+
+	Discovery*							m_discovery;
+	Discovery::Handle					m_discoveryHandle;
+
+	std::mutex							m_callbackMutex;
+	Callbacks							m_callbacks;
+
+	bool								flush(bool force) const;
+	static bool							write(const std::string& path, const Entries& entries);
+	void								notify(const std::string& name, const std::string& url);
+
+};
+
+}
\ No newline at end of file
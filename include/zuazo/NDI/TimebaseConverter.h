@@ -0,0 +1,60 @@
+#pragma once
+
+#include "VideoFrame.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Zuazo::NDI {
+
+/*
+ * TimebaseConverter adapts the frames of a source to a different
+ * output rate, interpolating between the two nearest source frames
+ * according to their timestamps. Time is expressed in 100ns units.
+ * Frames are not copied: the caller keeps the previous one alive and
+ * blends both, ideally while converting them (see NDI::blend)
+ */
+class TimebaseConverter {
+public:
+	enum class Mode {
+		NEAREST,			//Frames are repeated or dropped by the FrameSync
+		BLEND
+	};
+
+	static constexpr uint32_t		FULL_WEIGHT = 1U << 16; //Q16
+
+	explicit TimebaseConverter(Mode mode = Mode::NEAREST);
+	TimebaseConverter(const TimebaseConverter& other) = delete;
+	TimebaseConverter(TimebaseConverter&& other) = default;
+	~TimebaseConverter() = default;
+
+	TimebaseConverter&				operator=(const TimebaseConverter& other) = delete;
+	TimebaseConverter&				operator=(TimebaseConverter&& other) = default;
+
+	void							setMode(Mode mode) noexcept;
+	Mode							getMode() const noexcept;
+
+	void							setOutputPeriod(int64_t period) noexcept;
+	int64_t							getOutputPeriod() const noexcept;
+
+	uint32_t						process(const VideoFrame& frame, const VideoFrame& previous);
+	const VideoFrame&				blend(const VideoFrame& frame, const VideoFrame& previous, uint32_t weight);
+	void							reset() noexcept;
+
+private:
+	Mode							m_mode;
+	int64_t							m_outputPeriod;
+
+	VideoFrame						m_output;
+	std::vector<std::byte>			m_outputData;
+
+	int64_t							m_lastTime;	//Time of the last frame processed
+	int64_t							m_time;		//Estimated current time of the source
+	bool							m_hasTime;
+
+	static int64_t					getTime(const VideoFrame& frame) noexcept;
+
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Zuazo::NDI {
+
+/*
+ * Tracer records the events of the frame pipeline into per-thread ring
+ * buffers, so that they can be inspected as a timeline. Recording is
+ * lock-free and it costs a single relaxed load when disabled. Once full,
+ * the oldest events of each thread are overwritten. Traces are written
+ * in the Chrome trace event format, which is also read by Perfetto
+ */
+class Tracer {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	enum class Event : uint32_t {
+		CAPTURE,			//FrameSync capture
+		FORMAT_CHANGE,		//Captured frame differs from the previous one
+		ACQUIRE,			//Frame pool acquire
+		COPY,				//Conversion into the staged frame
+		FLUSH,				//Staged frame flush
+		PUSH,				//Output push
+		FREE,				//FrameSync free
+
+		COUNT
+	};
+
+	static constexpr size_t DEFAULT_CAPACITY = 1 << 16; //Events per thread
+
+	explicit Tracer(size_t capacity = DEFAULT_CAPACITY);
+	Tracer(const Tracer& other) = delete;
+	~Tracer();
+
+	Tracer&								operator=(const Tracer& other) = delete;
+
+	void								setEnabled(bool enabled) noexcept;
+	bool								isEnabled() const noexcept;
+
+	void								setPath(std::string path);
+	const std::string&					getPath() const noexcept;
+
+	uint32_t							getSourceId(std::string_view name);
+
+	void								record(	Event event,
+												uint32_t source,
+												Clock::time_point begin,
+												Clock::time_point end,
+												int64_t timestamp ) noexcept;
+	void								record(	Event event,
+												uint32_t source,
+												Clock::time_point time,
+												int64_t timestamp ) noexcept;
+	void								clear() noexcept;
+
+	void								write(std::ostream& os) const;
+	bool								dump() const;
+	bool								dump(const std::string& path) const;
+
+	static std::string_view				getEventName(Event event) noexcept;
+
+private:
+	struct Ring;
+
+	uint64_t							m_id;
+	size_t								m_capacity;
+	Clock::time_point					m_origin;
+	std::atomic<bool>					m_enabled;
+	std::string							m_path;
+
+	mutable std::mutex					m_mutex;
+	std::vector<std::shared_ptr<Ring>>	m_rings;
+	std::vector<std::string>			m_sources;
+
+	Ring*								getRing() noexcept;
+
+};
+
+}
\ No newline at end of file
@@ -6,8 +6,15 @@
 #include <zuazo/Utils/Pimpl.h>
 
 #include "../NDI/Source.h"
+#include "../NDI/Recv.h"
+#include "../NDI/Conversions.h"
+#include "../NDI/Analyzer.h"
+#include "../NDI/Deinterlacer.h"
+#include "../NDI/TimebaseConverter.h"
+#include "../NDI/LatencyHistogram.h"
 
 #include <string>
+#include <string_view>
 
 namespace Zuazo::Sources {
 
@@ -20,6 +27,37 @@ class NDI
 {
 	friend NDIImpl;
 public:
+	using Deinterlacing = Zuazo::NDI::Deinterlacer::Mode;
+	using Timebase = Zuazo::NDI::TimebaseConverter::Mode;
+
+	enum class Decimation {
+		HALF,
+		QUARTER,
+
+		COUNT
+	};
+
+	enum class Stage {
+		CAPTURE,	//Pulling the frame from the receiver
+		ACQUIRE,	//Obtaining a frame from the pool
+		COPY,		//Converting it into the frame
+		FLUSH,		//Making it visible to the GPU
+		QUEUE,		//From the end of the capture until it is pushed
+
+		COUNT
+	};
+
+	//Video frame counters of the receiver, periodically sampled
+	struct Statistics {
+		int64_t							totalFrames;		//Since the receiver was connected
+		int64_t							droppedFrames;
+		int64_t							totalFramesDelta;	//Since the previous sample
+		int64_t							droppedFramesDelta;
+		double							frameRate;			//Received frames per second
+		double							dropRate;			//Dropped frames per second
+		int32_t							queueDepth;			//Frames waiting to be captured
+		int32_t							connections;
+	};
 
 	class Source {
 	public:
@@ -66,6 +104,45 @@ public:
 
 	void							setPreviewTally(bool tally);
 	bool							getPreviewTally() const noexcept;
+
+	void							setBandwidth(Zuazo::NDI::Recv::Bandwidth bandwidth);
+	Zuazo::NDI::Recv::Bandwidth		getBandwidth() const noexcept;
+
+	void							setVideoModeLocked(bool locked);
+	bool							getVideoModeLocked() const noexcept;
+
+	void							setDeinterlacing(Deinterlacing mode);
+	Deinterlacing					getDeinterlacing() const noexcept;
+
+	void							setFieldRate(bool enabled);
+	bool							getFieldRate() const noexcept;
+
+	void							setDecimatedOutputEnabled(Decimation decimation, bool enabled);
+	bool							getDecimatedOutputEnabled(Decimation decimation) const noexcept;
+	static std::string_view			getDecimatedOutputName(Decimation decimation) noexcept;
+
+	void							setCrop(const Zuazo::NDI::Region& region);
+	const Zuazo::NDI::Region&		getCrop() const noexcept;
+
+	void							setAlphaPremultiplied(bool enabled);
+	bool							getAlphaPremultiplied() const noexcept;
+
+	void							setAnalysisEnabled(bool enabled);
+	bool							getAnalysisEnabled() const noexcept;
+	Zuazo::NDI::Analyzer::Result	getAnalysis() const;
+
+	void							setTimebaseConversion(Timebase mode);
+	Timebase						getTimebaseConversion() const noexcept;
+
+	Zuazo::NDI::ConversionCost		estimateConversionCost(const VideoMode& videoMode) const;
+
+	void							setLatencyStatisticsEnabled(bool enabled);
+	bool							getLatencyStatisticsEnabled() const noexcept;
+	Zuazo::NDI::LatencyHistogram::Summary getLatency(Stage stage) const noexcept;
+	void							resetLatencyStatistics() noexcept;
+	static std::string_view			getStageName(Stage stage) noexcept;
+
+	Statistics						getStatistics() const;
 	
 };
 
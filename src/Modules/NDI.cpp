@@ -1,6 +1,19 @@
 #include <zuazo/Modules/NDI.h>
 
+#include <zuazo/NDI/RecvPool.h>
+#include <zuazo/NDI/SourceCache.h>
+#include <zuazo/NDI/Loopback.h>
+#include <zuazo/NDI/Tracer.h>
+#include <zuazo/NDI/Sampler.h>
+#include <zuazo/NDI/Exporter.h>
+#include <zuazo/NDI/PerfCounters.h>
+#include <zuazo/NDI/FlightRecorder.h>
+
 #include <cassert>
+#include <chrono>
+#include <csignal>
+#include <future>
+#include <string_view>
 
 
 #ifdef _WIN32
@@ -22,10 +35,9 @@ public:
 	DynamicLoad() 
 		: ndiDl(nullptr)
 		, ndiLib(nullptr)
+		, ndiPath()
 	{
 		//Based on SDK examples
-		std::string ndiPath;
-		
 		//Obtain the path to the .so file
 		const char* ndiRuntimeFolder = getenv(NDILIB_REDIST_FOLDER);
 		if(ndiRuntimeFolder) {
@@ -58,6 +70,13 @@ public:
 
 		//At this point it should be loaded
 		assert(ndiLib);
+
+		//Resolve the actual location of the library, as it may
+		//have been found in the default search paths
+		Dl_info info;
+		if(dladdr(reinterpret_cast<void*>(ndiLoad), &info) && info.dli_fname) {
+			ndiPath = info.dli_fname;
+		}
 	}
 
 	~DynamicLoad() {
@@ -70,41 +89,283 @@ public:
 		return *ndiLib;
 	}
 
+	const std::string& getPath() const noexcept {
+		return ndiPath;
+	}
+
 private:
 	void* ndiDl;
 	const NDIlib_v4* ndiLib;
+	std::string ndiPath;
 	
 };
 #endif
 
 std::unique_ptr<NDI> NDI::s_singleton;
+std::once_flag NDI::s_singletonFlag;
 
 NDI::NDI() 
 	: Instance::Module(std::string(name), version)
-	, m_dynamicLoad(Utils::makeUnique<DynamicLoad>())
-	, m_ndi(m_dynamicLoad->get())
+	, m_loadMutex()
+	, m_backend(Backend::RUNTIME)
+	, m_loadFuture()
+	, m_dynamicLoad()
+	, m_ndi(nullptr)
+	, m_loadInfo()
+	, m_recvPool()
+	, m_sourceCache()
+	, m_tracer()
+	, m_sampler()
+	, m_exporter()
+	, m_perfCounters()
+	, m_flightRecorder()
 {
-	//Initialize the library
-	getNDI().initialize();
+	//The backend may be overridden from the environment, so that
+	//tests and benchmarks can run without modifying the application
+	const char* backend = getenv("ZUAZO_NDI_BACKEND");
+	if(backend && std::string_view(backend) == "loopback") {
+		m_backend = Backend::LOOPBACK;
+	}
+
+	//Create the standby receiver pool. Empty by default
+	m_recvPool = Utils::makeUnique<Zuazo::NDI::RecvPool>();
+
+	//Create the source cache. Not persistent by default
+	m_sourceCache = Utils::makeUnique<Zuazo::NDI::SourceCache>();
+
+	//Create the tracer. Disabled by default, unless a
+	//path to dump the trace at exit is given
+	m_tracer = Utils::makeUnique<Zuazo::NDI::Tracer>();
+	const char* tracePath = getenv("ZUAZO_NDI_TRACE");
+	if(tracePath && *tracePath) {
+		m_tracer->setPath(tracePath);
+		m_tracer->setEnabled(true);
+	}
+
+	//Create the statistics sampler. Its thread is started on demand
+	m_sampler = Utils::makeUnique<Zuazo::NDI::Sampler>();
+
+	//Create the metrics exporter. It only listens when requested,
+	//either as "[address:]port" or "unix:path"
+	m_exporter = Utils::makeUnique<Zuazo::NDI::Exporter>();
+	const char* metrics = getenv("ZUAZO_NDI_METRICS");
+	if(metrics && *metrics) {
+		const std::string_view endpoint(metrics);
+		const auto separator = endpoint.rfind(':');
+
+		try {
+			if(endpoint.substr(0, 5) == "unix:") {
+				m_exporter->listen(std::string(endpoint.substr(5)));
+			} else if(separator == std::string_view::npos) {
+				m_exporter->listen(static_cast<uint16_t>(std::stoul(std::string(endpoint))));
+			} else {
+				m_exporter->listen(
+					static_cast<uint16_t>(std::stoul(std::string(endpoint.substr(separator + 1)))),
+					std::string(endpoint.substr(0, separator)).c_str()
+				);
+			}
+		} catch(...) {
+			//Metrics are not essential. Continue without them
+		}
+	}
+
+	//Create the hardware counters of the conversions. Disabled
+	//by default, as measuring them requires system calls
+	m_perfCounters = Utils::makeUnique<Zuazo::NDI::PerfCounters>();
+	const char* perf = getenv("ZUAZO_NDI_PERF");
+	if(perf && std::string_view(perf) == "1") {
+		m_perfCounters->setEnabled(true);
+	}
+
+	//Create the flight recorder. It is always recording. When a path
+	//is given, it is dumped there upon SIGUSR1
+	m_flightRecorder = Utils::makeUnique<Zuazo::NDI::FlightRecorder>();
+	const char* flightRecorderPath = getenv("ZUAZO_NDI_FLIGHT_RECORDER");
+	if(flightRecorderPath && *flightRecorderPath) {
+		m_flightRecorder->setPath(flightRecorderPath);
+		m_flightRecorder->dumpOnSignal(SIGUSR1);
+	}
 }
 
 NDI::~NDI() {
+	//Wait for any ongoing load
+	std::shared_future<void> loadFuture;
+	{
+		std::lock_guard<std::mutex> lock(m_loadMutex);
+		loadFuture = m_loadFuture;
+	}
+	if(loadFuture.valid()) {
+		loadFuture.wait();
+	}
+
+	//Stop sampling before the receivers are destroyed
+	m_sampler.reset();
+	m_exporter.reset();
+
+	//Standby receivers must be destroyed before the library
+	m_recvPool.reset();
+	m_sourceCache.reset();
+
+	//Write the trace, if requested
+	if(m_tracer->isEnabled() && !m_tracer->getPath().empty()) {
+		m_tracer->dump();
+	}
+	m_tracer.reset();
+
 	//Terminate the library
-	getNDI().destroy();
+	const auto* ndi = m_ndi.load();
+	if(ndi) {
+		ndi->destroy();
+	}
 }
 
 const NDI& NDI::get() {
-	if(!s_singleton) {
-		s_singleton = std::unique_ptr<NDI>(new NDI);
-	}
+	//Construction is cheap, the runtime is loaded afterwards
+	std::call_once(
+		s_singletonFlag, 
+		[] {
+			s_singleton = std::unique_ptr<NDI>(new NDI);
+		}
+	);
 
 	assert(s_singleton);
 	return *s_singleton;
 }
 
 
-const NDIlib_v4& NDI::getNDI() const noexcept {
-	return m_ndi;
+
+void NDI::initialize(Instance&) const {
+	//Load the runtime in the background, so that it is 
+	//ready by the time the first source is opened
+	preload();
+}
+
+
+bool NDI::setBackend(Backend backend) const {
+	std::lock_guard<std::mutex> lock(m_loadMutex);
+	if(m_loadFuture.valid()) {
+		return backend == m_backend; //Too late, already loading
+	}
+
+	m_backend = backend;
+	return true;
+}
+
+NDI::Backend NDI::getBackend() const noexcept {
+	return m_backend.load();
+}
+
+
+void NDI::preload() const {
+	std::lock_guard<std::mutex> lock(m_loadMutex);
+	if(!m_loadFuture.valid()) {
+		m_loadFuture = std::async(std::launch::async, &NDI::load, this).share();
+	}
+}
+
+bool NDI::isLoaded() const noexcept {
+	return m_ndi.load(std::memory_order_acquire) != nullptr;
+}
+
+const NDI::LoadInfo& NDI::getLoadInfo() const {
+	getNDI(); //Waits until loaded
+	return m_loadInfo;
+}
+
+
+const NDIlib_v4& NDI::getNDI() const {
+	//Fast path. Already loaded
+	const auto* ndi = m_ndi.load(std::memory_order_acquire);
+	if(ndi) {
+		return *ndi;
+	}
+
+	//Not preloaded or still loading. Wait for it. Throws if the load failed
+	std::shared_future<void> loadFuture;
+	preload();
+	{
+		std::lock_guard<std::mutex> lock(m_loadMutex);
+		loadFuture = m_loadFuture;
+	}
+	loadFuture.get();
+
+	ndi = m_ndi.load(std::memory_order_acquire);
+	assert(ndi);
+	return *ndi;
+}
+
+const NDIlib_v4& NDI::getLoadedNDI() const noexcept {
+	//For the instances created by the runtime, which can only
+	//exist once it has been loaded. Never waits nor throws
+	const auto* ndi = m_ndi.load(std::memory_order_acquire);
+	assert(ndi);
+	return *ndi;
+}
+
+Zuazo::NDI::RecvPool& NDI::getRecvPool() const noexcept {
+	assert(m_recvPool);
+	return *m_recvPool;
+}
+
+Zuazo::NDI::SourceCache& NDI::getSourceCache() const noexcept {
+	assert(m_sourceCache);
+	return *m_sourceCache;
+}
+
+Zuazo::NDI::Tracer& NDI::getTracer() const noexcept {
+	assert(m_tracer);
+	return *m_tracer;
+}
+
+Zuazo::NDI::Sampler& NDI::getSampler() const noexcept {
+	assert(m_sampler);
+	return *m_sampler;
+}
+
+Zuazo::NDI::Exporter& NDI::getExporter() const noexcept {
+	assert(m_exporter);
+	return *m_exporter;
+}
+
+Zuazo::NDI::PerfCounters& NDI::getPerfCounters() const noexcept {
+	assert(m_perfCounters);
+	return *m_perfCounters;
+}
+
+Zuazo::NDI::FlightRecorder& NDI::getFlightRecorder() const noexcept {
+	assert(m_flightRecorder);
+	return *m_flightRecorder;
+}
+
+
+
+void NDI::load() const {
+	const auto t0 = std::chrono::steady_clock::now();
+
+	//Load and initialize the library. Backend can not change after
+	//the load has been requested
+	std::unique_ptr<DynamicLoad> dynamicLoad;
+	const NDIlib_v4* ndiPtr;
+	if(m_backend == Backend::LOOPBACK) {
+		ndiPtr = &Zuazo::NDI::Loopback::getInterface();
+	} else {
+		dynamicLoad = Utils::makeUnique<DynamicLoad>();
+		ndiPtr = &dynamicLoad->get();
+	}
+
+	assert(ndiPtr);
+	const auto& ndi = *ndiPtr;
+	ndi.initialize();
+
+	const auto t1 = std::chrono::steady_clock::now();
+
+	//Fill the report before publishing the library
+	m_loadInfo.path = dynamicLoad ? dynamicLoad->getPath() : std::string();
+	m_loadInfo.version = ndi.version ? ndi.version() : "";
+	m_loadInfo.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0);
+	m_dynamicLoad = std::move(dynamicLoad);
+
+	m_ndi.store(&ndi, std::memory_order_release);
 }
 
 }
\ No newline at end of file
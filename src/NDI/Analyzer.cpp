@@ -0,0 +1,298 @@
+#include <zuazo/NDI/Analyzer.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+namespace Zuazo::NDI {
+
+static void extractHighBytes(const std::byte* src, uint8_t* dst, size_t count) noexcept {
+	//Takes the odd bytes. This is the luma of UYVY and the MSB of 16 bit samples
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	for(; i + 16 <= count; i += 16) {
+		const auto v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2*i));
+		const auto v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2*i + 16));
+		const auto result = _mm_packus_epi16(_mm_srli_epi16(v0, 8), _mm_srli_epi16(v1, 8));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), result);
+	}
+#endif
+
+	for(; i < count; ++i) {
+		dst[i] = std::to_integer<uint8_t>(src[2*i + 1]);
+	}
+}
+
+static void extractRGBALuma(const std::byte* src, uint8_t* dst, size_t count, bool bgra) noexcept {
+	//BT.709 weights in Q8. Full range
+	const size_t r = bgra ? 2 : 0;
+	const size_t b = bgra ? 0 : 2;
+
+	for(size_t i = 0; i < count; ++i) {
+		const auto* pixel = src + 4*i;
+		const uint32_t y = 
+			54*std::to_integer<uint32_t>(pixel[r]) +
+			183*std::to_integer<uint32_t>(pixel[1]) +
+			19*std::to_integer<uint32_t>(pixel[b]);
+		dst[i] = static_cast<uint8_t>((y + 128) >> 8);
+	}
+}
+
+static void accumulateRange(const uint8_t* data, 
+							size_t count, 
+							uint64_t& sum, 
+							uint8_t& minimum, 
+							uint8_t& maximum ) noexcept
+{
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	if(count >= 16) {
+		const auto zero = _mm_setzero_si128();
+		auto vMin = _mm_set1_epi8(-1);
+		auto vMax = zero;
+		auto vSum = zero;
+
+		for(; i + 16 <= count; i += 16) {
+			const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+			vMin = _mm_min_epu8(vMin, v);
+			vMax = _mm_max_epu8(vMax, v);
+			vSum = _mm_add_epi64(vSum, _mm_sad_epu8(v, zero));
+		}
+
+		alignas(16) uint8_t mins[16];
+		alignas(16) uint8_t maxs[16];
+		alignas(16) uint64_t sums[2];
+		_mm_store_si128(reinterpret_cast<__m128i*>(mins), vMin);
+		_mm_store_si128(reinterpret_cast<__m128i*>(maxs), vMax);
+		_mm_store_si128(reinterpret_cast<__m128i*>(sums), vSum);
+
+		sum += sums[0] + sums[1];
+		minimum = std::min(minimum, *std::min_element(mins, mins + 16));
+		maximum = std::max(maximum, *std::max_element(maxs, maxs + 16));
+	}
+#endif
+
+	for(; i < count; ++i) {
+		sum += data[i];
+		minimum = std::min(minimum, data[i]);
+		maximum = std::max(maximum, data[i]);
+	}
+}
+
+
+
+Analyzer::Analyzer()
+	: m_blackThreshold(DEFAULT_BLACK_THRESHOLD)
+	, m_freezeThreshold(DEFAULT_FREEZE_THRESHOLD)
+	, m_freezeFrames(DEFAULT_FREEZE_FRAMES)
+	, m_resolution(0, 0)
+	, m_blackLevel(0)
+	, m_whiteLevel(0xFF)
+	, m_histograms{}
+	, m_minimum(0xFF)
+	, m_maximum(0x00)
+	, m_cells{}
+	, m_columns{}
+	, m_row()
+	, m_result{}
+	, m_hasSignature(false)
+{
+}
+
+
+
+void Analyzer::setBlackThreshold(uint8_t threshold) noexcept {
+	m_blackThreshold = threshold;
+}
+
+uint8_t Analyzer::getBlackThreshold() const noexcept {
+	return m_blackThreshold;
+}
+
+
+void Analyzer::setFreezeThreshold(uint8_t threshold) noexcept {
+	m_freezeThreshold = threshold;
+}
+
+uint8_t Analyzer::getFreezeThreshold() const noexcept {
+	return m_freezeThreshold;
+}
+
+
+void Analyzer::setFreezeFrames(size_t count) noexcept {
+	m_freezeFrames = count;
+}
+
+size_t Analyzer::getFreezeFrames() const noexcept {
+	return m_freezeFrames;
+}
+
+
+
+void Analyzer::begin(Resolution resolution) {
+	m_resolution = resolution;
+	m_row.resize(resolution.x); //Allocated beforehand, as rows are analyzed from noexcept code
+
+	for(auto& histogram : m_histograms) {
+		histogram.fill(0);
+	}
+	m_minimum = 0xFF;
+	m_maximum = 0x00;
+	m_cells.fill(0);
+
+	//Split the columns evenly between the signature cells
+	for(size_t i = 0; i < m_columns.size(); ++i) {
+		m_columns[i] = i * resolution.x / SIGNATURE_SIZE;
+	}
+}
+
+void Analyzer::analyzeRow(size_t row, const std::byte* data, Layout layout) noexcept {
+	const size_t width = m_resolution.x;
+	if(row >= m_resolution.y || width == 0) {
+		return;
+	}
+
+	//Bring the luma to a contiguous 8 bit row
+	const uint8_t* luma;
+	switch(layout) {
+	case Layout::Y8:
+		luma = reinterpret_cast<const uint8_t*>(data);
+		m_blackLevel = 16;
+		m_whiteLevel = 235;
+		break;
+
+	case Layout::Y16:
+	case Layout::UYVY:
+		extractHighBytes(data, m_row.data(), width);
+		luma = m_row.data();
+		m_blackLevel = 16;
+		m_whiteLevel = 235;
+		break;
+
+	case Layout::RGBA:
+	case Layout::BGRA:
+		extractRGBALuma(data, m_row.data(), width, layout == Layout::BGRA);
+		luma = m_row.data();
+		m_blackLevel = 0;
+		m_whiteLevel = 255;
+		break;
+
+	default:
+		assert(false);
+		return;
+	}
+
+	//Histogram
+	size_t i = 0;
+	for(; i + HISTOGRAM_COUNT <= width; i += HISTOGRAM_COUNT) {
+		for(size_t j = 0; j < HISTOGRAM_COUNT; ++j) {
+			++m_histograms[j][luma[i + j]];
+		}
+	}
+	for(; i < width; ++i) {
+		++m_histograms[0][luma[i]];
+	}
+
+	//Signature, minimum and maximum
+	auto* cells = m_cells.data() + (row * SIGNATURE_SIZE / m_resolution.y) * SIGNATURE_SIZE;
+	for(size_t j = 0; j < SIGNATURE_SIZE; ++j) {
+		accumulateRange(
+			luma + m_columns[j], 
+			m_columns[j + 1] - m_columns[j], 
+			cells[j], 
+			m_minimum, m_maximum
+		);
+	}
+}
+
+const Analyzer::Result& Analyzer::end() noexcept {
+	//Merge the histograms
+	auto& histogram = m_result.histogram;
+	histogram = m_histograms[0];
+	for(size_t i = 1; i < m_histograms.size(); ++i) {
+		for(size_t j = 0; j < histogram.size(); ++j) {
+			histogram[j] += m_histograms[i][j];
+		}
+	}
+
+	uint64_t total = 0;
+	uint64_t dark = 0;
+	uint64_t bright = 0;
+	for(size_t i = 0; i < histogram.size(); ++i) {
+		total += histogram[i];
+		if(i <= static_cast<size_t>(m_blackLevel) + m_blackThreshold) {
+			dark += histogram[i];
+		}
+		if(i >= m_whiteLevel) {
+			bright += histogram[i];
+		}
+	}
+
+	if(total == 0) {
+		//Nothing was analyzed
+		return m_result;
+	}
+
+	//Statistics
+	uint64_t sum = 0;
+	for(const auto& cell : m_cells) {
+		sum += cell;
+	}
+	m_result.minimum = m_minimum;
+	m_result.maximum = m_maximum;
+	m_result.average = static_cast<float>(sum) / total;
+	m_result.clipped = static_cast<float>(bright) / total;
+	m_result.black = dark*50 >= total*49; //98% of the samples
+
+	//Average each of the cells for the signature
+	Signature signature;
+	for(size_t i = 0; i < SIGNATURE_SIZE; ++i) {
+		const auto firstRow = (i*m_resolution.y + SIGNATURE_SIZE - 1) / SIGNATURE_SIZE;
+		const auto lastRow = ((i + 1)*m_resolution.y + SIGNATURE_SIZE - 1) / SIGNATURE_SIZE;
+		const auto rows = lastRow - firstRow;
+
+		for(size_t j = 0; j < SIGNATURE_SIZE; ++j) {
+			const auto count = rows * (m_columns[j + 1] - m_columns[j]);
+			const auto index = i*SIGNATURE_SIZE + j;
+			signature[index] = count ? static_cast<uint8_t>(m_cells[index] / count) : 0;
+		}
+	}
+
+	//Compare with the previous one for freeze detection
+	if(m_hasSignature) {
+		uint32_t difference = 0;
+		for(size_t i = 0; i < signature.size(); ++i) {
+			difference += std::abs(static_cast<int>(signature[i]) - static_cast<int>(m_result.signature[i]));
+		}
+
+		if(difference <= m_freezeThreshold*signature.size()) {
+			++m_result.frozenFrames;
+		} else {
+			m_result.frozenFrames = 0;
+		}
+	}
+	m_result.signature = signature;
+	m_result.frozen = m_result.frozenFrames >= m_freezeFrames;
+	m_hasSignature = true;
+
+	return m_result;
+}
+
+
+
+const Analyzer::Result& Analyzer::getResult() const noexcept {
+	return m_result;
+}
+
+void Analyzer::reset() noexcept {
+	m_result = Result{};
+	m_hasSignature = false;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,395 @@
+#include "Channels.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Zuazo::NDI {
+
+static Resolution getChromaResolution(Resolution res, ColorSubsampling subsampling) noexcept {
+	switch(subsampling) {
+	case ColorSubsampling::rb422: 	return Resolution(res.x / 2, res.y);
+	case ColorSubsampling::rb420: 	return Resolution(res.x / 2, res.y / 2);
+	default: 						return res;
+	}
+}
+
+
+
+Channels::Family getChannelFamily(FourCC fourCC) noexcept {
+	switch(fourCC) {
+	case FourCC::UYVY:
+	case FourCC::UYVA:
+	case FourCC::P216:
+	case FourCC::PA16:
+	case FourCC::YV12:
+	case FourCC::I420:
+	case FourCC::NV12:
+		return Channels::YCBCR;
+
+	case FourCC::BGRA:
+	case FourCC::BGRX:
+	case FourCC::RGBA:
+	case FourCC::RGBX:
+		return Channels::RGB;
+
+	default:
+		return Channels::NONE;
+	}
+}
+
+Channels::Family getChannelFamily(ColorFormat format) noexcept {
+	switch(format) {
+	case ColorFormat::B8G8R8G8:
+	case ColorFormat::G8_B8R8:
+	case ColorFormat::G8_B8_R8:
+	case ColorFormat::G8_B8R8_A8:
+	case ColorFormat::G16_B16R16:
+	case ColorFormat::G16_B16R16_A16:
+		return Channels::YCBCR;
+
+	case ColorFormat::R8G8B8A8:
+	case ColorFormat::B8G8R8A8:
+		return Channels::RGB;
+
+	default:
+		return Channels::NONE;
+	}
+}
+
+
+
+Channels getChannels(const VideoFrame& frame) noexcept {
+	Channels result = {};
+	result.family = Channels::NONE;
+
+	const auto data = frame.getData();
+	const size_t stride = frame.getStride();
+	const auto res = frame.getResolution();
+	const auto chroma422 = getChromaResolution(res, ColorSubsampling::rb422);
+	const auto chroma420 = getChromaResolution(res, ColorSubsampling::rb420);
+
+	if(!data) {
+		return result;
+	}
+
+	auto& ch = result.channels;
+	switch(frame.getFourCC()) {
+	case FourCC::UYVA:
+		//Alpha plane immediately follows the UYVY plane, with half of its stride
+		ch[Channels::A] = { data + stride*res.y, sizeof(uint8_t), stride/2, res, sizeof(uint8_t) };
+		[[fallthrough]];
+	case FourCC::UYVY:
+		result.family = Channels::YCBCR;
+		ch[Channels::Y] = 	{ data + 1, 2*sizeof(uint8_t), stride, res, sizeof(uint8_t) };
+		ch[Channels::CB] = 	{ data + 0, 4*sizeof(uint8_t), stride, chroma422, sizeof(uint8_t) };
+		ch[Channels::CR] = 	{ data + 2, 4*sizeof(uint8_t), stride, chroma422, sizeof(uint8_t) };
+		break;
+
+	case FourCC::PA16:
+		//Alpha plane immediately follows the CbCr plane
+		ch[Channels::A] = { data + 2*stride*res.y, sizeof(uint16_t), stride, res, sizeof(uint16_t) };
+		[[fallthrough]];
+	case FourCC::P216:
+		result.family = Channels::YCBCR;
+		ch[Channels::Y] = 	{ data, sizeof(uint16_t), stride, res, sizeof(uint16_t) };
+		ch[Channels::CB] = 	{ data + stride*res.y, 2*sizeof(uint16_t), stride, chroma422, sizeof(uint16_t) };
+		ch[Channels::CR] = 	{ data + stride*res.y + sizeof(uint16_t), 2*sizeof(uint16_t), stride, chroma422, sizeof(uint16_t) };
+		break;
+
+	case FourCC::I420:
+	case FourCC::YV12:
+	{
+		//Chroma planes have half of the stride and height
+		const auto firstChroma = data + stride*res.y;
+		const auto secondChroma = firstChroma + (stride/2)*chroma420.y;
+		const auto isYV12 = frame.getFourCC() == FourCC::YV12;
+
+		result.family = Channels::YCBCR;
+		ch[Channels::Y] = 	{ data, sizeof(uint8_t), stride, res, sizeof(uint8_t) };
+		ch[Channels::CB] = 	{ isYV12 ? secondChroma : firstChroma, sizeof(uint8_t), stride/2, chroma420, sizeof(uint8_t) };
+		ch[Channels::CR] = 	{ isYV12 ? firstChroma : secondChroma, sizeof(uint8_t), stride/2, chroma420, sizeof(uint8_t) };
+		break;
+	}
+
+	case FourCC::NV12:
+		result.family = Channels::YCBCR;
+		ch[Channels::Y] = 	{ data, sizeof(uint8_t), stride, res, sizeof(uint8_t) };
+		ch[Channels::CB] = 	{ data + stride*res.y + 0, 2*sizeof(uint8_t), stride, chroma420, sizeof(uint8_t) };
+		ch[Channels::CR] = 	{ data + stride*res.y + 1, 2*sizeof(uint8_t), stride, chroma420, sizeof(uint8_t) };
+		break;
+
+	case FourCC::BGRA:
+	case FourCC::BGRX:
+		//X is always 255, so it can be treated as alpha
+		result.family = Channels::RGB;
+		ch[Channels::B] = 	{ data + 0, 4*sizeof(uint8_t), stride, res, sizeof(uint8_t) };
+		ch[Channels::G] = 	{ data + 1, 4*sizeof(uint8_t), stride, res, sizeof(uint8_t) };
+		ch[Channels::R] = 	{ data + 2, 4*sizeof(uint8_t), stride, res, sizeof(uint8_t) };
+		ch[Channels::A] = 	{ data + 3, 4*sizeof(uint8_t), stride, res, sizeof(uint8_t) };
+		break;
+
+	case FourCC::RGBA:
+	case FourCC::RGBX:
+		//X is always 255, so it can be treated as alpha
+		result.family = Channels::RGB;
+		ch[Channels::R] = 	{ data + 0, 4*sizeof(uint8_t), stride, res, sizeof(uint8_t) };
+		ch[Channels::G] = 	{ data + 1, 4*sizeof(uint8_t), stride, res, sizeof(uint8_t) };
+		ch[Channels::B] = 	{ data + 2, 4*sizeof(uint8_t), stride, res, sizeof(uint8_t) };
+		ch[Channels::A] = 	{ data + 3, 4*sizeof(uint8_t), stride, res, sizeof(uint8_t) };
+		break;
+
+	default:
+		break;
+	}
+
+	return result;
+}
+
+Channels getChannels(const VideoFrame& frame, const Region& region) noexcept {
+	auto result = getChannels(frame);
+	const auto resolution = frame.getResolution();
+	assert(region.x + region.resolution.x <= resolution.x);
+	assert(region.y + region.resolution.y <= resolution.y);
+
+	//Scale the region to the resolution of each channel
+	for(auto& channel : result.channels) {
+		if(channel) {
+			channel = getSubChannel(
+				channel,
+				region.x * channel.resolution.x / resolution.x,
+				region.y * channel.resolution.y / resolution.y,
+				region.resolution.x * channel.resolution.x / resolution.x,
+				region.resolution.y * channel.resolution.y / resolution.y
+			);
+		}
+	}
+
+	return result;
+}
+
+Channels getChannels(Graphics::StagedFrame& frame) noexcept {
+	Channels result = {};
+	result.family = Channels::NONE;
+
+	const auto& descriptor = frame.getDescriptor();
+	const auto planes = frame.getPixelData();
+	const auto res = descriptor->getResolution();
+	const auto chroma = getChromaResolution(res, descriptor->getColorSubsampling());
+
+	//Destination planes are tightly packed
+	auto& ch = result.channels;
+	switch(descriptor->getColorFormat()) {
+	case ColorFormat::B8G8R8G8:
+		assert(planes.size() == 1);
+		result.family = Channels::YCBCR;
+		ch[Channels::Y] = 	{ planes[0].data() + 1, 2*sizeof(uint8_t), res.x*2*sizeof(uint8_t), res, sizeof(uint8_t) };
+		ch[Channels::CB] = 	{ planes[0].data() + 0, 4*sizeof(uint8_t), res.x*2*sizeof(uint8_t), chroma, sizeof(uint8_t) };
+		ch[Channels::CR] = 	{ planes[0].data() + 2, 4*sizeof(uint8_t), res.x*2*sizeof(uint8_t), chroma, sizeof(uint8_t) };
+		break;
+
+	case ColorFormat::G8_B8R8_A8:
+		assert(planes.size() == 3);
+		ch[Channels::A] = 	{ planes[2].data(), sizeof(uint8_t), res.x*sizeof(uint8_t), res, sizeof(uint8_t) };
+		[[fallthrough]];
+	case ColorFormat::G8_B8R8:
+		assert(planes.size() >= 2);
+		result.family = Channels::YCBCR;
+		ch[Channels::Y] = 	{ planes[0].data(), sizeof(uint8_t), res.x*sizeof(uint8_t), res, sizeof(uint8_t) };
+		ch[Channels::CB] = 	{ planes[1].data() + 0, 2*sizeof(uint8_t), chroma.x*2*sizeof(uint8_t), chroma, sizeof(uint8_t) };
+		ch[Channels::CR] = 	{ planes[1].data() + 1, 2*sizeof(uint8_t), chroma.x*2*sizeof(uint8_t), chroma, sizeof(uint8_t) };
+		break;
+
+	case ColorFormat::G8_B8_R8:
+		assert(planes.size() == 3);
+		result.family = Channels::YCBCR;
+		ch[Channels::Y] = 	{ planes[0].data(), sizeof(uint8_t), res.x*sizeof(uint8_t), res, sizeof(uint8_t) };
+		ch[Channels::CB] = 	{ planes[1].data(), sizeof(uint8_t), chroma.x*sizeof(uint8_t), chroma, sizeof(uint8_t) };
+		ch[Channels::CR] = 	{ planes[2].data(), sizeof(uint8_t), chroma.x*sizeof(uint8_t), chroma, sizeof(uint8_t) };
+		break;
+
+	case ColorFormat::G16_B16R16_A16:
+		assert(planes.size() == 3);
+		ch[Channels::A] = 	{ planes[2].data(), sizeof(uint16_t), res.x*sizeof(uint16_t), res, sizeof(uint16_t) };
+		[[fallthrough]];
+	case ColorFormat::G16_B16R16:
+		assert(planes.size() >= 2);
+		result.family = Channels::YCBCR;
+		ch[Channels::Y] = 	{ planes[0].data(), sizeof(uint16_t), res.x*sizeof(uint16_t), res, sizeof(uint16_t) };
+		ch[Channels::CB] = 	{ planes[1].data() + 0, 2*sizeof(uint16_t), chroma.x*2*sizeof(uint16_t), chroma, sizeof(uint16_t) };
+		ch[Channels::CR] = 	{ planes[1].data() + 2, 2*sizeof(uint16_t), chroma.x*2*sizeof(uint16_t), chroma, sizeof(uint16_t) };
+		break;
+
+	case ColorFormat::R8G8B8A8:
+		assert(planes.size() == 1);
+		result.family = Channels::RGB;
+		ch[Channels::R] = 	{ planes[0].data() + 0, 4*sizeof(uint8_t), res.x*4*sizeof(uint8_t), res, sizeof(uint8_t) };
+		ch[Channels::G] = 	{ planes[0].data() + 1, 4*sizeof(uint8_t), res.x*4*sizeof(uint8_t), res, sizeof(uint8_t) };
+		ch[Channels::B] = 	{ planes[0].data() + 2, 4*sizeof(uint8_t), res.x*4*sizeof(uint8_t), res, sizeof(uint8_t) };
+		ch[Channels::A] = 	{ planes[0].data() + 3, 4*sizeof(uint8_t), res.x*4*sizeof(uint8_t), res, sizeof(uint8_t) };
+		break;
+
+	case ColorFormat::B8G8R8A8:
+		assert(planes.size() == 1);
+		result.family = Channels::RGB;
+		ch[Channels::B] = 	{ planes[0].data() + 0, 4*sizeof(uint8_t), res.x*4*sizeof(uint8_t), res, sizeof(uint8_t) };
+		ch[Channels::G] = 	{ planes[0].data() + 1, 4*sizeof(uint8_t), res.x*4*sizeof(uint8_t), res, sizeof(uint8_t) };
+		ch[Channels::R] = 	{ planes[0].data() + 2, 4*sizeof(uint8_t), res.x*4*sizeof(uint8_t), res, sizeof(uint8_t) };
+		ch[Channels::A] = 	{ planes[0].data() + 3, 4*sizeof(uint8_t), res.x*4*sizeof(uint8_t), res, sizeof(uint8_t) };
+		break;
+
+	default:
+		break;
+	}
+
+	return result;
+}
+
+
+
+Planes getPlanes(const VideoFrame& frame) noexcept {
+	Planes result = {};
+
+	const auto data = frame.getData();
+	const size_t stride = frame.getStride();
+	const size_t width = frame.getResolution().x;
+	const size_t height = frame.getResolution().y;
+
+	if(!data) {
+		return result;
+	}
+
+	switch(frame.getFourCC()) {
+	case FourCC::BGRA:
+	case FourCC::BGRX:
+	case FourCC::RGBA:
+	case FourCC::RGBX:
+		result[0] = { data, stride, 4*width, height, sizeof(uint8_t) };
+		break;
+
+	case FourCC::UYVA:
+		//Alpha plane has half of the stride
+		result[1] = { data + stride*height, stride/2, width, height, sizeof(uint8_t) };
+		[[fallthrough]];
+	case FourCC::UYVY:
+		result[0] = { data, stride, 2*width, height, sizeof(uint8_t) };
+		break;
+
+	case FourCC::I420:
+	case FourCC::YV12:
+		//Chroma planes have half of the stride and height
+		result[0] = { data, stride, width, height, sizeof(uint8_t) };
+		result[1] = { data + stride*height, stride/2, width/2, height/2, sizeof(uint8_t) };
+		result[2] = { data + stride*height + (stride/2)*(height/2), stride/2, width/2, height/2, sizeof(uint8_t) };
+		break;
+
+	case FourCC::NV12:
+		result[0] = { data, stride, width, height, sizeof(uint8_t) };
+		result[1] = { data + stride*height, stride, width, height/2, sizeof(uint8_t) };
+		break;
+
+	case FourCC::PA16:
+		result[2] = { data + 2*stride*height, stride, 2*width, height, sizeof(uint16_t) };
+		[[fallthrough]];
+	case FourCC::P216:
+		result[0] = { data, stride, 2*width, height, sizeof(uint16_t) };
+		result[1] = { data + stride*height, stride, 2*width, height, sizeof(uint16_t) };
+		break;
+
+	default:
+		break;
+	}
+
+	return result;
+}
+
+Planes getPlanes(const VideoFrame& frame, const Region& region) noexcept {
+	auto result = getPlanes(frame);
+	const auto resolution = frame.getResolution();
+	assert(region.x + region.resolution.x <= resolution.x);
+	assert(region.y + region.resolution.y <= resolution.y);
+
+	//Scale the region to the geometry of each plane. Even 
+	//coordinates keep chroma pairs and macropixels intact
+	for(auto& plane : result) {
+		if(plane) {
+			const size_t x = region.x * plane.width / resolution.x;
+			const size_t y = region.y * plane.height / resolution.y;
+			plane.data += y*plane.stride + x;
+			plane.width = region.resolution.x * plane.width / resolution.x;
+			plane.height = region.resolution.y * plane.height / resolution.y;
+		}
+	}
+
+	return result;
+}
+
+Planes getPlanes(Graphics::StagedFrame& frame, const Planes& layout) noexcept {
+	//Plane copies write tightly packed rows of the same width as 
+	//the source planes. See isPlaneCopy
+	Planes result = {};
+	const auto data = frame.getPixelData();
+
+	for(size_t i = 0; i < result.size() && i < data.size(); ++i) {
+		if(layout[i]) {
+			assert(data[i].size() >= layout[i].width*layout[i].height);
+			result[i] = { data[i].data(), layout[i].width, layout[i].width, layout[i].height, layout[i].depth };
+		}
+	}
+
+	return result;
+}
+
+Analyzer::Layout getLumaLayout(FourCC fourCC) noexcept {
+	//Layout of the first plane
+	switch(fourCC) {
+	case FourCC::UYVY:
+	case FourCC::UYVA:	return Analyzer::Layout::UYVY;
+	case FourCC::P216:
+	case FourCC::PA16:	return Analyzer::Layout::Y16;
+	case FourCC::RGBA:
+	case FourCC::RGBX:	return Analyzer::Layout::RGBA;
+	case FourCC::BGRA:
+	case FourCC::BGRX:	return Analyzer::Layout::BGRA;
+	default:			return Analyzer::Layout::Y8;
+	}
+}
+
+size_t getFrameSize(const VideoFrame& frame) noexcept {
+	size_t result = 0;
+
+	for(const auto& plane : getPlanes(frame)) {
+		if(plane) {
+			result = std::max(result, static_cast<size_t>(plane.data - frame.getData()) + plane.stride*plane.height);
+		}
+	}
+
+	return result;
+}
+
+
+
+Channel getSubChannel(	const Channel& channel,
+						size_t x, size_t y,
+						size_t width, size_t height ) noexcept
+{
+	assert(x + width <= channel.resolution.x);
+	assert(y + height <= channel.resolution.y);
+
+	Channel result = channel;
+	result.data += y*channel.stride + x*channel.step;
+	result.resolution = Resolution(width, height);
+	return result;
+}
+
+uint16_t getBlankValue(Channels::Family family, Channels::Index index) noexcept {
+	//Values are expressed in 16 bits. Limited range is assumed for YCbCr
+	if(index == Channels::A) {
+		return 0xFFFF; //Opaque
+	} else if(family == Channels::YCBCR) {
+		return (index == Channels::Y) ? (16 << 8) : (128 << 8);
+	} else {
+		return 0x0000;
+	}
+}
+
+}
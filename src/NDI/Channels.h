@@ -0,0 +1,83 @@
+#pragma once
+
+#include <zuazo/NDI/VideoFrame.h>
+#include <zuazo/NDI/Conversions.h>
+#include <zuazo/Graphics/StagedFrame.h>
+#include <zuazo/FourCC.h>
+#include <zuazo/Resolution.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Zuazo::NDI {
+
+/*
+ * A Channel describes a single component of an image, regardless
+ * of it being packed, semi-planar or planar in memory
+ */
+struct Channel {
+	std::byte*								data;
+	size_t									step;	//Bytes between consecutive samples
+	size_t									stride; //Bytes between consecutive rows
+	Resolution								resolution;
+	size_t									depth;	//Bytes per sample. 1 or 2
+
+	explicit operator bool() const noexcept { return data; }
+};
+
+struct Channels {
+	enum Family {
+		NONE,
+		YCBCR,
+		RGB
+	};
+
+	enum Index {
+		Y = 0, 	CB = 1, CR = 2,
+		R = 0, 	G = 1, 	B = 2,
+		A = 3,
+
+		COUNT
+	};
+
+	Family									family;
+	std::array<Channel, COUNT>				channels;
+};
+
+/*
+ * A Plane describes a contiguous region of a frame, regardless of
+ * the channels it holds. Rows of a plane can be processed as a whole
+ */
+struct Plane {
+	std::byte*								data;
+	size_t									stride; //Bytes between consecutive rows
+	size_t									width;	//Useful bytes of each row
+	size_t									height;
+	size_t									depth;	//Bytes per sample. 1 or 2
+
+	explicit operator bool() const noexcept { return data; }
+};
+
+using Planes = std::array<Plane, 3>;
+
+Channels::Family getChannelFamily(FourCC fourCC) noexcept;
+Channels::Family getChannelFamily(ColorFormat format) noexcept;
+
+Channels getChannels(const VideoFrame& frame) noexcept;
+Channels getChannels(const VideoFrame& frame, const Region& region) noexcept;
+Channels getChannels(Graphics::StagedFrame& frame) noexcept;
+
+Planes getPlanes(const VideoFrame& frame) noexcept;
+Planes getPlanes(const VideoFrame& frame, const Region& region) noexcept;
+Planes getPlanes(Graphics::StagedFrame& frame, const Planes& layout) noexcept;
+Analyzer::Layout getLumaLayout(FourCC fourCC) noexcept;
+size_t getFrameSize(const VideoFrame& frame) noexcept;
+
+Channel getSubChannel(	const Channel& channel,
+						size_t x, size_t y,
+						size_t width, size_t height ) noexcept;
+
+uint16_t getBlankValue(Channels::Family family, Channels::Index index) noexcept;
+
+}
\ No newline at end of file
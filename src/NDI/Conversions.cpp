@@ -1,28 +1,34 @@
 #include <zuazo/NDI/Conversions.h>
 
+#include "Channels.h"
+#include "Kernels.h"
+
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstring>
 #include <cstdint>
 
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
 namespace Zuazo::NDI {
 
-static void copyPlane(	Utils::BufferView<const std::byte> src, 
-						size_t srcStride,
+static void copyPlane(	const Plane& src,
 						Utils::BufferView<std::byte> dst,
-						size_t dstStride,
-						size_t height ) noexcept
+						size_t dstStride ) noexcept
 {
-	assert(src.size() >= srcStride*height);
-	assert(dst.size() >= dstStride*height);
+	assert(dst.size() >= dstStride*src.height);
+	assert(src.width <= dstStride);
 	
-	if(srcStride != dstStride) {
+	if(src.stride != dstStride || src.width != dstStride) {
 		//As they have different strides, copy line by line
-		const auto minStride = Math::min(srcStride, dstStride);
-		for(size_t i = 0; i < height; ++i) {
+		for(size_t i = 0; i < src.height; ++i) {
 			std::memcpy(
 				dst.data() + i*dstStride,
-				src.data() + i*srcStride,
-				minStride
+				src.data + i*src.stride,
+				src.width
 			);
 		}
 
@@ -30,38 +36,91 @@ static void copyPlane(	Utils::BufferView<const std::byte> src,
 		//Copy everything at once
 		std::memcpy(
 			dst.data(),
-			src.data(),
-			Math::min(src.size(), dst.size())
+			src.data,
+			dstStride*src.height
 		);
 
 	}
 }
 
+static void copyPlane(	const Plane& src,
+						Utils::BufferView<std::byte> dst,
+						size_t dstStride,
+						Analyzer* analyzer,
+						Analyzer::Layout layout ) noexcept
+{
+	if(analyzer) {
+		assert(dst.size() >= dstStride*src.height);
+		assert(src.width <= dstStride);
+
+		//Analyze each row right after copying it, while it is in cache
+		for(size_t i = 0; i < src.height; ++i) {
+			auto* dstRow = dst.data() + i*dstStride;
+			std::memcpy(dstRow, src.data + i*src.stride, src.width);
+			analyzer->analyzeRow(i, dstRow, layout);
+		}
+	} else {
+		copyPlane(src, dst, dstStride);
+	}
+}
+
+template<size_t WordSize>
+static void deinterleaveRow(const std::byte* src,
+							std::byte* dst0,
+							std::byte* dst1,
+							size_t width ) noexcept
+{
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	if constexpr (WordSize == sizeof(uint8_t)) {
+		//Split even and odd bytes 16 at a time
+		const auto lowMask = _mm_set1_epi16(0x00FF);
+		for(; i + 32 <= width; i += 32) {
+			const auto v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			const auto v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 16));
+			const auto even = _mm_packus_epi16(_mm_and_si128(v0, lowMask), _mm_and_si128(v1, lowMask));
+			const auto odd = _mm_packus_epi16(_mm_srli_epi16(v0, 8), _mm_srli_epi16(v1, 8));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst0 + i/2), even);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst1 + i/2), odd);
+		}
+	}
+#endif
+
+	for(; i < width; i += 2*WordSize) {
+		//Even words to dst0, odd ones to dst1
+		std::memcpy(dst0 + i/2, src + i, WordSize);
+		std::memcpy(dst1 + i/2, src + i + WordSize, WordSize);
+	}
+}
+
 template<size_t WordSize>
-static void copyPlaneInterleaved(	Utils::BufferView<const std::byte> src, 
-									size_t srcStride,
+static void copyPlaneInterleaved(	const Plane& src,
 									Utils::BufferView<std::byte> dst0,
 									Utils::BufferView<std::byte> dst1,
 									size_t dstStride,
-									size_t height ) noexcept
+									Analyzer* analyzer ) noexcept
 {
-	assert(src.size() >= srcStride*height);
-	assert(dst0.size() >= dstStride*height);
-	assert(dst1.size() >= dstStride*height);
-	assert(srcStride % (2*WordSize) == 0);
-	assert(dstStride % WordSize == 0);
-
-	//Copy data inteleaving words between planes
-	for(size_t i = 0; i < height; ++i) {
-		for(size_t j = 0; j < srcStride/WordSize; ++j) {
-			//Odd words to dst1, even ones to dst0
-			const auto& dst = (j%2) ? dst1 : dst0;
-
-			//Copy a word
-			std::memcpy(
-				dst.data() + i*dstStride + (j/2)*WordSize,
-				src.data() + i*srcStride + (j  )*WordSize,
-				WordSize
+	assert(dst0.size() >= dstStride*src.height);
+	assert(dst1.size() >= dstStride*src.height);
+	assert(src.width <= 2*dstStride);
+	assert(src.width % (2*WordSize) == 0);
+
+	//Copy data inteleaving words between planes. Odd words are
+	//analyzed as luma, if requested
+	for(size_t i = 0; i < src.height; ++i) {
+		deinterleaveRow<WordSize>(
+			src.data + i*src.stride,
+			dst0.data() + i*dstStride,
+			dst1.data() + i*dstStride,
+			src.width
+		);
+
+		if(analyzer) {
+			analyzer->analyzeRow(
+				i, 
+				dst1.data() + i*dstStride, 
+				(WordSize == sizeof(uint8_t)) ? Analyzer::Layout::Y8 : Analyzer::Layout::Y16
 			);
 		}
 	}
@@ -70,48 +129,50 @@ static void copyPlaneInterleaved(	Utils::BufferView<const std::byte> src,
 
 
 
-void copyRGBA(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept {
+void copyRGBA(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept {
 	// Planar 8bit, 4:4:4:4 video format.
 	const auto& dstDescriptor = dst.getDescriptor();
 	const auto dstResolution = dstDescriptor->getResolution();
 	assert(dstDescriptor->getColorFormat() == ColorFormat::R8G8B8A8 || dstDescriptor->getColorFormat() == ColorFormat::B8G8R8A8);
 	assert(dstDescriptor->getColorSubsampling() == ColorSubsampling::rb444);
+	assert(dstResolution == region.resolution);
 
-	const auto srcData = src.getSlicedData();
+	const auto srcPlanes = getPlanes(src, region);
 	const auto dstData = dst.getPixelData();
 	assert(dstData.size() == 1);
 
 	copyPlane(
-		srcData[0],
-		src.getStride()*sizeof(uint8_t),
+		srcPlanes[0],
 		dstData[0],
 		dstResolution.width*sizeof(uint8_t)*4,
-		dstResolution.height
+		analyzer,
+		getLumaLayout(src.getFourCC())
 	);
 }
 
-void copyUYVY(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept {
+void copyUYVY(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept {
 	// YCbCr color space using 4:2:2.
 	const auto& dstDescriptor = dst.getDescriptor();
 	const auto dstResolution = dstDescriptor->getResolution();
 	assert(dstDescriptor->getColorFormat() == ColorFormat::B8G8R8G8);
 	assert(dstDescriptor->getColorSubsampling() == ColorSubsampling::rb422);
+	assert(dstResolution == region.resolution);
 
-	const auto srcData = src.getSlicedData();
+	const auto srcPlanes = getPlanes(src, region);
 	const auto dstData = dst.getPixelData();
 	assert(dstData.size() == 1);
 
 	copyPlane(
-		srcData[0],
-		src.getStride()*sizeof(uint8_t),
+		srcPlanes[0],
 		dstData[0],
 		dstResolution.width*sizeof(uint8_t)*2,
-		dstResolution.height
+		analyzer,
+		Analyzer::Layout::UYVY
 	);
 }
 
 
-void copyP216(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept {
+void copyP216(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept {
 	// YCbCr color space using 4:2:2 in 16bpp
 	// In memory this is a semi-planar format. This is identical to a 16bpp 
 	// version of the NV16 format. 
@@ -122,28 +183,27 @@ void copyP216(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept {
 	const auto dstResolution = dstDescriptor->getResolution();
 	assert(dstDescriptor->getColorFormat() == ColorFormat::G16_B16R16);
 	assert(dstDescriptor->getColorSubsampling() == ColorSubsampling::rb422);
+	assert(dstResolution == region.resolution);
 
-	const auto srcData = src.getSlicedData();
+	const auto srcPlanes = getPlanes(src, region);
 	const auto dstData = dst.getPixelData();
 	assert(dstData.size() == 2);
 
 	copyPlane( //Y plane
-		srcData[0],
-		src.getStride()*sizeof(uint16_t),
+		srcPlanes[0],
 		dstData[0],
 		dstResolution.width*sizeof(uint16_t),
-		dstResolution.height
+		analyzer,
+		Analyzer::Layout::Y16
 	);
 	copyPlane( //4:2:2 CbCr plane
-		srcData[1],
-		src.getStride()*sizeof(uint16_t),
+		srcPlanes[1],
 		dstData[1],
-		dstResolution.width*sizeof(uint16_t),
-		dstResolution.height
+		dstResolution.width*sizeof(uint16_t)
 	);
 }
 
-void copyPA16(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept {
+void copyPA16(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept {
 	// YCbCr color space with an alpha channel, using 4:2:2:4
 	// In memory this is a semi-planar format. 
 	// The first buffer is a 16bpp luminance buffer. 
@@ -154,35 +214,32 @@ void copyPA16(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept {
 	const auto dstResolution = dstDescriptor->getResolution();
 	assert(dstDescriptor->getColorFormat() == ColorFormat::G16_B16R16_A16);
 	assert(dstDescriptor->getColorSubsampling() == ColorSubsampling::rb422);
+	assert(dstResolution == region.resolution);
 
-	const auto srcData = src.getSlicedData();
+	const auto srcPlanes = getPlanes(src, region);
 	const auto dstData = dst.getPixelData();
 	assert(dstData.size() == 3);
 
 	copyPlane( //Y plane
-		srcData[0],
-		src.getStride()*sizeof(uint16_t),
+		srcPlanes[0],
 		dstData[0],
 		dstResolution.width*sizeof(uint16_t),
-		dstResolution.height
+		analyzer,
+		Analyzer::Layout::Y16
 	);
 	copyPlane( //4:2:2 CbCr plane
-		srcData[1],
-		src.getStride()*sizeof(uint16_t),
+		srcPlanes[1],
 		dstData[1],
-		dstResolution.width*sizeof(uint16_t),
-		dstResolution.height
+		dstResolution.width*sizeof(uint16_t)
 	);
 	copyPlane( //A plane
-		srcData[2],
-		src.getStride()*sizeof(uint16_t),
+		srcPlanes[2],
 		dstData[2],
-		dstResolution.width*sizeof(uint16_t),
-		dstResolution.height
+		dstResolution.width*sizeof(uint16_t)
 	);
 }
 
-void copyI420(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept {
+void copyI420(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept {
 	// The first buffer is an 8bpp luminance buffer.
 	// Immediately following this is a 8bpp Cb buffer.
 	// Immediately following this is a 8bpp Cr buffer.
@@ -191,35 +248,32 @@ void copyI420(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept {
 	const auto dstResolution = dstDescriptor->getResolution();
 	assert(dstDescriptor->getColorFormat() == ColorFormat::G8_B8_R8);
 	assert(dstDescriptor->getColorSubsampling() == ColorSubsampling::rb420);
+	assert(dstResolution == region.resolution);
 
-	const auto srcData = src.getSlicedData();
+	const auto srcPlanes = getPlanes(src, region);
 	const auto dstData = dst.getPixelData();
 	assert(dstData.size() == 3);
 
 	copyPlane( //Y plane
-		srcData[0],
-		src.getStride()*sizeof(uint8_t),
+		srcPlanes[0],
 		dstData[0],
 		dstResolution.width*sizeof(uint8_t),
-		dstResolution.height
+		analyzer,
+		Analyzer::Layout::Y8
 	);
 	copyPlane( //4:2:0 Cb plane
-		srcData[1],
-		src.getStride()*sizeof(uint8_t),
+		srcPlanes[1],
 		dstData[1],
-		dstResolution.width*sizeof(uint8_t) / 2,
-		dstResolution.height / 2
+		dstResolution.width*sizeof(uint8_t) / 2
 	);
 	copyPlane( //4:2:0 Cr plane
-		srcData[2],
-		src.getStride()*sizeof(uint8_t),
+		srcPlanes[2],
 		dstData[2],
-		dstResolution.width*sizeof(uint8_t) / 2,
-		dstResolution.height / 2
+		dstResolution.width*sizeof(uint8_t) / 2
 	);
 }
 
-void copyNV12(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept {
+void copyNV12(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept {
 	// Planar 8bit 4:2:0 video format.
 	// The first buffer is an 8bpp luminance buffer.
 	// Immediately following this is in interleaved buffer of 8bpp Cb, Cr pairs
@@ -228,53 +282,52 @@ void copyNV12(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept {
 	const auto dstResolution = dstDescriptor->getResolution();
 	assert(dstDescriptor->getColorFormat() == ColorFormat::G8_B8R8);
 	assert(dstDescriptor->getColorSubsampling() == ColorSubsampling::rb420);
+	assert(dstResolution == region.resolution);
 
-	const auto srcData = src.getSlicedData();
+	const auto srcPlanes = getPlanes(src, region);
 	const auto dstData = dst.getPixelData();
 	assert(dstData.size() == 2);
 
 	copyPlane( //Y plane
-		srcData[0],
-		src.getStride()*sizeof(uint8_t),
+		srcPlanes[0],
 		dstData[0],
 		dstResolution.width*sizeof(uint8_t),
-		dstResolution.height
+		analyzer,
+		Analyzer::Layout::Y8
 	);
 	copyPlane( //4:2:0 CbCr plane
-		srcData[1],
-		src.getStride()*sizeof(uint8_t),
+		srcPlanes[1],
 		dstData[1],
-		dstResolution.width*sizeof(uint8_t),
-		dstResolution.height / 2
+		dstResolution.width*sizeof(uint8_t)
 	);
 }
 
 
 
-void copyUYVYtoNV16(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept {
+void copyUYVYtoNV16(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept {
 	// YCbCr color space using 4:2:2.
 
 	const auto& dstDescriptor = dst.getDescriptor();
 	const auto dstResolution = dstDescriptor->getResolution();
 	assert(dstDescriptor->getColorFormat() == ColorFormat::G8_B8R8);
 	assert(dstDescriptor->getColorSubsampling() == ColorSubsampling::rb422);
+	assert(dstResolution == region.resolution);
 
-	const auto srcData = src.getSlicedData();
+	const auto srcPlanes = getPlanes(src, region);
 	const auto dstData = dst.getPixelData();
 	assert(dstData.size() == 2);
 
-	copyPlaneInterleaved<1>( 
-		srcData[0],
-		src.getStride()*sizeof(uint8_t),
-		dstData[0],
+	copyPlaneInterleaved<1>( //UYVY has chroma on even bytes and luma on odd ones
+		srcPlanes[0],
 		dstData[1],
+		dstData[0],
 		dstResolution.width*sizeof(uint8_t),
-		dstResolution.height
+		analyzer
 	);
 
 }
 
-void copyUYVAtoPA8(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept {
+void copyUYVAtoPA8(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept {
 	// YCbCr + Alpha color space, using 4:2:2:4.
 	// In memory there are two separate planes. The first is a regular
 	// UYVY 4:2:2 buffer. Immediately following this in memory is a 
@@ -284,30 +337,28 @@ void copyUYVAtoPA8(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept {
 	const auto dstResolution = dstDescriptor->getResolution();
 	assert(dstDescriptor->getColorFormat() == ColorFormat::G8_B8R8_A8);
 	assert(dstDescriptor->getColorSubsampling() == ColorSubsampling::rb422);
+	assert(dstResolution == region.resolution);
 
-	const auto srcData = src.getSlicedData();
+	const auto srcPlanes = getPlanes(src, region);
 	const auto dstData = dst.getPixelData();
 	assert(dstData.size() == 3);
 
-	copyPlaneInterleaved<1>( 
-		srcData[0],
-		src.getStride()*sizeof(uint8_t),
-		dstData[0],
+	copyPlaneInterleaved<1>( //UYVY has chroma on even bytes and luma on odd ones
+		srcPlanes[0],
 		dstData[1],
+		dstData[0],
 		dstResolution.width*sizeof(uint8_t),
-		dstResolution.height
+		analyzer
 	);
 	copyPlane( //A plane
-		srcData[2],
-		src.getStride()*sizeof(uint8_t),
+		srcPlanes[1],
 		dstData[2],
-		dstResolution.width*sizeof(uint8_t),
-		dstResolution.height
+		dstResolution.width*sizeof(uint8_t)
 	);
 
 }
 
-void copyYV12toI420(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept {
+void copyYV12toI420(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept {
 	// Planar 8bit 4:2:0 video format.
 	// The first buffer is an 8bpp luminance buffer.
 	// Immediately following this is a 8bpp Cr buffer.
@@ -317,33 +368,769 @@ void copyYV12toI420(const VideoFrame& src, Graphics::StagedFrame& dst) noexcept
 	const auto dstResolution = dstDescriptor->getResolution();
 	assert(dstDescriptor->getColorFormat() == ColorFormat::G8_B8_R8);
 	assert(dstDescriptor->getColorSubsampling() == ColorSubsampling::rb420);
+	assert(dstResolution == region.resolution);
 
-	const auto srcData = src.getSlicedData();
+	const auto srcPlanes = getPlanes(src, region);
 	const auto dstData = dst.getPixelData();
 	assert(dstData.size() == 3);
 
 	copyPlane( //Y plane
-		srcData[0],
-		src.getStride()*sizeof(uint8_t),
+		srcPlanes[0],
 		dstData[0],
 		dstResolution.width*sizeof(uint8_t),
-		dstResolution.height
+		analyzer,
+		Analyzer::Layout::Y8
 	);
 	copyPlane( //4:2:0 Cr plane
-		srcData[1],
-		src.getStride()*sizeof(uint8_t),
+		srcPlanes[1],
 		dstData[2],
-		dstResolution.width*sizeof(uint8_t) / 2,
-		dstResolution.height / 2
+		dstResolution.width*sizeof(uint8_t) / 2
 	);
 	copyPlane( //4:2:0 Cb plane
-		srcData[2],
-		src.getStride()*sizeof(uint8_t),
+		srcPlanes[2],
 		dstData[1],
-		dstResolution.width*sizeof(uint8_t) / 2,
-		dstResolution.height / 2
+		dstResolution.width*sizeof(uint8_t) / 2
 	);
 }
 
 
+
+void copyRGBAPremultiplied(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept {
+	// Same as copyRGBA, scaling color by alpha on the way
+	const auto& dstDescriptor = dst.getDescriptor();
+	const auto dstResolution = dstDescriptor->getResolution();
+	assert(dstDescriptor->getColorFormat() == ColorFormat::R8G8B8A8 || dstDescriptor->getColorFormat() == ColorFormat::B8G8R8A8);
+	assert(dstDescriptor->getColorSubsampling() == ColorSubsampling::rb444);
+	assert(dstResolution == region.resolution);
+
+	const auto srcPlanes = getPlanes(src, region);
+	const auto dstData = dst.getPixelData();
+	assert(dstData.size() == 1);
+
+	const size_t dstStride = dstResolution.width*sizeof(uint8_t)*4;
+	for(size_t i = 0; i < srcPlanes[0].height; ++i) {
+		const auto* srcRow = srcPlanes[0].data + i*srcPlanes[0].stride;
+		premultiplyRGBARow(srcRow, dstData[0].data() + i*dstStride, dstResolution.width);
+
+		if(analyzer) {
+			//Straight color is analyzed
+			analyzer->analyzeRow(i, srcRow, getLumaLayout(src.getFourCC()));
+		}
+	}
+}
+
+void copyPA16Premultiplied(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept {
+	// Same as copyPA16, scaling color by alpha on the way
+	const auto& dstDescriptor = dst.getDescriptor();
+	const auto dstResolution = dstDescriptor->getResolution();
+	assert(dstDescriptor->getColorFormat() == ColorFormat::G16_B16R16_A16);
+	assert(dstDescriptor->getColorSubsampling() == ColorSubsampling::rb422);
+	assert(dstResolution == region.resolution);
+
+	const auto srcPlanes = getPlanes(src, region);
+	const auto dstData = dst.getPixelData();
+	assert(dstData.size() == 3);
+
+	const size_t dstStride = dstResolution.width*sizeof(uint16_t);
+	const auto yOffset = getBlankValue(Channels::YCBCR, Channels::Y);
+	const auto cOffset = getBlankValue(Channels::YCBCR, Channels::CB);
+	for(size_t i = 0; i < srcPlanes[0].height; ++i) {
+		const auto* srcAlpha = srcPlanes[2].data + i*srcPlanes[2].stride;
+		const auto* srcY = srcPlanes[0].data + i*srcPlanes[0].stride;
+
+		if(analyzer) {
+			//Straight color is analyzed
+			analyzer->analyzeRow(i, srcY, Analyzer::Layout::Y16);
+		}
+
+		premultiplyRow( //Y plane
+			srcY,
+			srcAlpha,
+			dstData[0].data() + i*dstStride,
+			dstResolution.width,
+			sizeof(uint16_t),
+			yOffset
+		);
+		premultiplyChromaRow( //4:2:2 CbCr plane
+			srcPlanes[1].data + i*srcPlanes[1].stride,
+			srcAlpha,
+			dstData[1].data() + i*dstStride,
+			dstResolution.width,
+			sizeof(uint16_t),
+			cOffset
+		);
+		std::memcpy( //A plane
+			dstData[2].data() + i*dstStride,
+			srcAlpha,
+			dstStride
+		);
+	}
+}
+
+void copyUYVAtoPA8Premultiplied(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst, Analyzer* analyzer) noexcept {
+	// Same as copyUYVAtoPA8, scaling color by alpha on the way.
+	// Rows are premultiplied right after being deinterleaved, while
+	// they are still in cache
+
+	const auto& dstDescriptor = dst.getDescriptor();
+	const auto dstResolution = dstDescriptor->getResolution();
+	assert(dstDescriptor->getColorFormat() == ColorFormat::G8_B8R8_A8);
+	assert(dstDescriptor->getColorSubsampling() == ColorSubsampling::rb422);
+	assert(dstResolution == region.resolution);
+
+	const auto srcPlanes = getPlanes(src, region);
+	const auto dstData = dst.getPixelData();
+	assert(dstData.size() == 3);
+
+	const size_t dstStride = dstResolution.width*sizeof(uint8_t);
+	const auto yOffset = getBlankValue(Channels::YCBCR, Channels::Y) >> 8;
+	const auto cOffset = getBlankValue(Channels::YCBCR, Channels::CB) >> 8;
+	for(size_t i = 0; i < srcPlanes[0].height; ++i) {
+		const auto* srcAlpha = srcPlanes[1].data + i*srcPlanes[1].stride;
+		auto* dstY = dstData[0].data() + i*dstStride;
+		auto* dstCbCr = dstData[1].data() + i*dstStride;
+
+		//UYVY has chroma on even bytes and luma on odd ones
+		deinterleaveRow<1>(srcPlanes[0].data + i*srcPlanes[0].stride, dstCbCr, dstY, srcPlanes[0].width);
+		if(analyzer) {
+			//Straight color is analyzed
+			analyzer->analyzeRow(i, dstY, Analyzer::Layout::Y8);
+		}
+		premultiplyRow(dstY, srcAlpha, dstY, dstResolution.width, sizeof(uint8_t), yOffset);
+		premultiplyChromaRow(dstCbCr, srcAlpha, dstCbCr, dstResolution.width, sizeof(uint8_t), cOffset);
+		std::memcpy(dstData[2].data() + i*dstStride, srcAlpha, dstStride);
+	}
+}
+
+void analyzeLuma(const VideoFrame& src, const Region& region, Analyzer& analyzer) noexcept {
+	//Used when the frame is not copied by any of the functions above
+	const auto srcPlanes = getPlanes(src, region);
+	const auto layout = getLumaLayout(src.getFourCC());
+
+	if(srcPlanes[0]) {
+		for(size_t i = 0; i < srcPlanes[0].height; ++i) {
+			analyzer.analyzeRow(i, srcPlanes[0].data + i*srcPlanes[0].stride, layout);
+		}
+	}
+}
+
+void premultiplyAlpha(Graphics::StagedFrame& frame) noexcept {
+	const auto& descriptor = frame.getDescriptor();
+	const auto resolution = descriptor->getResolution();
+	const auto data = frame.getPixelData();
+
+	switch(descriptor->getColorFormat()) {
+	case ColorFormat::R8G8B8A8:
+	case ColorFormat::B8G8R8A8:
+		assert(data.size() == 1);
+		for(size_t i = 0; i < resolution.height; ++i) {
+			auto* row = data[0].data() + i*resolution.width*4;
+			premultiplyRGBARow(row, row, resolution.width);
+		}
+		break;
+
+	case ColorFormat::G8_B8R8_A8:
+	case ColorFormat::G16_B16R16_A16:
+	{
+		//All the planes have the same stride for 4:2:2
+		assert(data.size() == 3);
+		assert(descriptor->getColorSubsampling() == ColorSubsampling::rb422);
+		const size_t depth = (descriptor->getColorFormat() == ColorFormat::G8_B8R8_A8) ? sizeof(uint8_t) : sizeof(uint16_t);
+		const size_t stride = resolution.width*depth;
+		const auto shift = 8*(sizeof(uint16_t) - depth);
+		const auto yOffset = getBlankValue(Channels::YCBCR, Channels::Y) >> shift;
+		const auto cOffset = getBlankValue(Channels::YCBCR, Channels::CB) >> shift;
+
+		for(size_t i = 0; i < resolution.height; ++i) {
+			auto* y = data[0].data() + i*stride;
+			auto* cbcr = data[1].data() + i*stride;
+			const auto* a = data[2].data() + i*stride;
+			premultiplyRow(y, a, y, resolution.width, depth, yOffset);
+			premultiplyChromaRow(cbcr, a, cbcr, resolution.width, depth, cOffset);
+		}
+		break;
+	}
+
+	default:
+		//No alpha, nothing to do
+		break;
+	}
+}
+
+
+
+bool operator==(const Region& lhs, const Region& rhs) noexcept {
+	return 	lhs.x == rhs.x &&
+			lhs.y == rhs.y &&
+			lhs.resolution == rhs.resolution ;
+}
+
+bool operator!=(const Region& lhs, const Region& rhs) noexcept {
+	return !operator==(lhs, rhs);
+}
+
+Region getEffectiveRegion(const Region& crop, Resolution resolution) noexcept {
+	//Empty crops refer to the whole frame
+	if(crop.resolution.x == 0 || crop.resolution.y == 0) {
+		return Region{ 0, 0, resolution };
+	}
+
+	//Keep it inside of the frame and aligned to the chroma samples
+	const uint32_t x = std::min<uint32_t>(crop.x, resolution.x) & ~1U;
+	const uint32_t y = std::min<uint32_t>(crop.y, resolution.y) & ~1U;
+	const uint32_t width = std::min<uint32_t>(crop.resolution.x, resolution.x - x) & ~1U;
+	const uint32_t height = std::min<uint32_t>(crop.resolution.y, resolution.y - y) & ~1U;
+
+	return Region{ x, y, Resolution(width, height) };
+}
+
+
+
+Colorimetry getColorimetry(Resolution resolution) noexcept {
+	//This has been elaborated according to the NDI SDK doc.
+	Colorimetry result;
+
+	if(resolution.x>1920 || resolution.y>1080) {
+		result = { ColorModel::bt2020, ColorPrimaries::bt2020, ColorRange::ituNarrowFullAlpha };
+	} else if(resolution.x>720 || resolution.y>576) {
+		result = { ColorModel::bt709, ColorPrimaries::bt709, ColorRange::ituNarrowFullAlpha };
+	} else {
+		result = { ColorModel::bt601, ColorPrimaries::bt601_625, ColorRange::ituNarrowFullAlpha };
+	}
+
+	return result;
+}
+
+
+
+bool hasAlpha(FourCC src) noexcept {
+	//RGBX and BGRX only carry padding
+	switch(src) {
+	case FourCC::RGBA:
+	case FourCC::BGRA:
+	case FourCC::UYVA:
+	case FourCC::PA16:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool isPlaneCopy(CopyFunction copy) noexcept {
+	//These copy each plane as it is, into tightly packed rows. Frames 
+	//of the same layout may be processed straight into the destination
+	return 	copy == copyRGBA ||
+			copy == copyUYVY ||
+			copy == copyP216 ||
+			copy == copyPA16 ||
+			copy == copyI420 ||
+			copy == copyNV12 ;
+}
+
+CopyFunction getCopyFunction(	FourCC src, 
+								ColorFormat dstFormat, 
+								ColorSubsampling dstSubsampling,
+								bool premultiply ) noexcept
+{
+	//Premultiplying formats without alpha has no effect
+	if(premultiply && hasAlpha(src)) {
+		const auto result = getCopyFunction(src, dstFormat, dstSubsampling, false);
+
+		if(result == copyRGBA) {
+			return copyRGBAPremultiplied;
+		} else if(result == copyPA16) {
+			return copyPA16Premultiplied;
+		} else if(result == copyUYVAtoPA8) {
+			return copyUYVAtoPA8Premultiplied;
+		} else {
+			assert(!result);
+			return nullptr;
+		}
+	}
+
+	//Returns the specialized copy function for this pair, if any
+	CopyFunction result = nullptr;
+
+	switch(src) {
+	case FourCC::RGBA:
+	case FourCC::RGBX:
+		if(dstFormat == ColorFormat::R8G8B8A8 && dstSubsampling == ColorSubsampling::rb444) {
+			result = copyRGBA;
+		}
+		break;
+
+	case FourCC::BGRA:
+	case FourCC::BGRX:
+		if(dstFormat == ColorFormat::B8G8R8A8 && dstSubsampling == ColorSubsampling::rb444) {
+			result = copyRGBA;
+		}
+		break;
+
+	case FourCC::UYVY:
+		if(dstFormat == ColorFormat::B8G8R8G8 && dstSubsampling == ColorSubsampling::rb422) {
+			result = copyUYVY;
+		} else if(dstFormat == ColorFormat::G8_B8R8 && dstSubsampling == ColorSubsampling::rb422) {
+			result = copyUYVYtoNV16;
+		}
+		break;
+
+	case FourCC::UYVA:
+		if(dstFormat == ColorFormat::G8_B8R8_A8 && dstSubsampling == ColorSubsampling::rb422) {
+			result = copyUYVAtoPA8;
+		}
+		break;
+
+	case FourCC::P216:
+		if(dstFormat == ColorFormat::G16_B16R16 && dstSubsampling == ColorSubsampling::rb422) {
+			result = copyP216;
+		}
+		break;
+
+	case FourCC::PA16:
+		if(dstFormat == ColorFormat::G16_B16R16_A16 && dstSubsampling == ColorSubsampling::rb422) {
+			result = copyPA16;
+		}
+		break;
+
+	case FourCC::I420:
+		if(dstFormat == ColorFormat::G8_B8_R8 && dstSubsampling == ColorSubsampling::rb420) {
+			result = copyI420;
+		}
+		break;
+
+	case FourCC::YV12:
+		if(dstFormat == ColorFormat::G8_B8_R8 && dstSubsampling == ColorSubsampling::rb420) {
+			result = copyYV12toI420;
+		}
+		break;
+
+	case FourCC::NV12:
+		if(dstFormat == ColorFormat::G8_B8R8 && dstSubsampling == ColorSubsampling::rb420) {
+			result = copyNV12;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	return result;
+}
+
+
+
+/*
+ * Conversion targets. Ordered by preference, the ones preserving
+ * the alpha channel (if any) first. YCbCr sources can also be converted
+ * to RGBA for devices lacking multi-planar format support
+ */
+
+static constexpr std::array<ConversionTarget, 8> UYVY_TARGETS = {
+	ConversionTarget(ColorFormat::B8G8R8G8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8R8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8_R8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8R8,			ColorSubsampling::rb420),
+	ConversionTarget(ColorFormat::G8_B8_R8,			ColorSubsampling::rb420),
+	ConversionTarget(ColorFormat::G16_B16R16,		ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::R8G8B8A8,			ColorSubsampling::rb444),
+	ConversionTarget(ColorFormat::B8G8R8A8,			ColorSubsampling::rb444),
+};
+
+static constexpr std::array<ConversionTarget, 10> UYVA_TARGETS = {
+	ConversionTarget(ColorFormat::G8_B8R8_A8,		ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G16_B16R16_A16,	ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::B8G8R8G8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8R8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8_R8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8R8,			ColorSubsampling::rb420),
+	ConversionTarget(ColorFormat::G8_B8_R8,			ColorSubsampling::rb420),
+	ConversionTarget(ColorFormat::G16_B16R16,		ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::R8G8B8A8,			ColorSubsampling::rb444),
+	ConversionTarget(ColorFormat::B8G8R8A8,			ColorSubsampling::rb444),
+};
+
+static constexpr std::array<ConversionTarget, 8> P216_TARGETS = {
+	ConversionTarget(ColorFormat::G16_B16R16,		ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8R8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::B8G8R8G8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8_R8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8R8,			ColorSubsampling::rb420),
+	ConversionTarget(ColorFormat::G8_B8_R8,			ColorSubsampling::rb420),
+	ConversionTarget(ColorFormat::R8G8B8A8,			ColorSubsampling::rb444),
+	ConversionTarget(ColorFormat::B8G8R8A8,			ColorSubsampling::rb444),
+};
+
+static constexpr std::array<ConversionTarget, 10> PA16_TARGETS = {
+	ConversionTarget(ColorFormat::G16_B16R16_A16,	ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8R8_A8,		ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G16_B16R16,		ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8R8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::B8G8R8G8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8_R8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8R8,			ColorSubsampling::rb420),
+	ConversionTarget(ColorFormat::G8_B8_R8,			ColorSubsampling::rb420),
+	ConversionTarget(ColorFormat::R8G8B8A8,			ColorSubsampling::rb444),
+	ConversionTarget(ColorFormat::B8G8R8A8,			ColorSubsampling::rb444),
+};
+
+static constexpr std::array<ConversionTarget, 8> YUV420_TARGETS = {
+	ConversionTarget(ColorFormat::G8_B8_R8,			ColorSubsampling::rb420),
+	ConversionTarget(ColorFormat::G8_B8R8,			ColorSubsampling::rb420),
+	ConversionTarget(ColorFormat::G8_B8R8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8_R8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::B8G8R8G8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G16_B16R16,		ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::R8G8B8A8,			ColorSubsampling::rb444),
+	ConversionTarget(ColorFormat::B8G8R8A8,			ColorSubsampling::rb444),
+};
+
+static constexpr std::array<ConversionTarget, 8> NV12_TARGETS = {
+	ConversionTarget(ColorFormat::G8_B8R8,			ColorSubsampling::rb420),
+	ConversionTarget(ColorFormat::G8_B8_R8,			ColorSubsampling::rb420),
+	ConversionTarget(ColorFormat::G8_B8R8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G8_B8_R8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::B8G8R8G8,			ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::G16_B16R16,		ColorSubsampling::rb422),
+	ConversionTarget(ColorFormat::R8G8B8A8,			ColorSubsampling::rb444),
+	ConversionTarget(ColorFormat::B8G8R8A8,			ColorSubsampling::rb444),
+};
+
+static constexpr std::array<ConversionTarget, 2> RGBA_TARGETS = {
+	ConversionTarget(ColorFormat::R8G8B8A8,			ColorSubsampling::rb444),
+	ConversionTarget(ColorFormat::B8G8R8A8,			ColorSubsampling::rb444),
+};
+
+static constexpr std::array<ConversionTarget, 2> BGRA_TARGETS = {
+	ConversionTarget(ColorFormat::B8G8R8A8,			ColorSubsampling::rb444),
+	ConversionTarget(ColorFormat::R8G8B8A8,			ColorSubsampling::rb444),
+};
+
+template<size_t N>
+static Utils::BufferView<const ConversionTarget> makeView(const std::array<ConversionTarget, N>& targets) noexcept {
+	return Utils::BufferView<const ConversionTarget>(targets.data(), targets.size());
+}
+
+Utils::BufferView<const ConversionTarget> getConversionTargets(FourCC src) noexcept {
+	Utils::BufferView<const ConversionTarget> result;
+
+	switch(src) {
+	case FourCC::UYVY: result = makeView(UYVY_TARGETS); break;
+	case FourCC::UYVA: result = makeView(UYVA_TARGETS); break;
+	case FourCC::P216: result = makeView(P216_TARGETS); break;
+	case FourCC::PA16: result = makeView(PA16_TARGETS); break;
+	case FourCC::I420:
+	case FourCC::YV12: result = makeView(YUV420_TARGETS); break;
+	case FourCC::NV12: result = makeView(NV12_TARGETS); break;
+	case FourCC::RGBA:
+	case FourCC::RGBX: result = makeView(RGBA_TARGETS); break;
+	case FourCC::BGRA:
+	case FourCC::BGRX: result = makeView(BGRA_TARGETS); break;
+	default: break;
+	}
+
+	return result;
+}
+
+
+
+/*
+ * Conversion cost estimation. Work is expressed relative to a 
+ * plain memcpy of the uploaded frame
+ */
+
+static constexpr size_t COPY_COST = 1; 			//Plane by plane memcpy
+static constexpr size_t DEINTERLEAVE_COST = 2;	//Specialized byte shuffling
+static constexpr size_t REPACK_COST = 4;		//Generic sample by sample copy
+static constexpr size_t RESAMPLE_COST = 8;		//Generic chroma resampling
+static constexpr size_t COLOR_COST = 12;		//Chroma upsampling and YCbCr to RGB
+
+static ColorSubsampling getColorSubsampling(FourCC fourCC) noexcept {
+	switch(fourCC) {
+	case FourCC::UYVY:
+	case FourCC::UYVA:
+	case FourCC::P216:
+	case FourCC::PA16:
+		return ColorSubsampling::rb422;
+
+	case FourCC::I420:
+	case FourCC::YV12:
+	case FourCC::NV12:
+		return ColorSubsampling::rb420;
+
+	default:
+		return ColorSubsampling::rb444;
+	}
+}
+
+static size_t getFrameSize(	ColorFormat format, 
+							ColorSubsampling subsampling, 
+							Resolution resolution ) noexcept
+{
+	const size_t luma = static_cast<size_t>(resolution.x) * resolution.y;
+	size_t chroma; //Per chroma channel
+	switch(subsampling) {
+	case ColorSubsampling::rb422: chroma = luma / 2; break;
+	case ColorSubsampling::rb420: chroma = luma / 4; break;
+	default: chroma = luma; break;
+	}
+
+	switch(format) {
+	case ColorFormat::R8G8B8A8:
+	case ColorFormat::B8G8R8A8:
+		return 4*luma;
+	case ColorFormat::B8G8R8G8:
+	case ColorFormat::G8_B8R8:
+	case ColorFormat::G8_B8_R8:
+		return luma + 2*chroma;
+	case ColorFormat::G8_B8R8_A8:
+		return 2*luma + 2*chroma;
+	case ColorFormat::G16_B16R16:
+		return sizeof(uint16_t)*(luma + 2*chroma);
+	case ColorFormat::G16_B16R16_A16:
+		return sizeof(uint16_t)*(2*luma + 2*chroma);
+	default:
+		return 0;
+	}
+}
+
+ConversionCost estimateConversionCost(	FourCC src,
+										Resolution resolution,
+										ColorFormat dstFormat,
+										ColorSubsampling dstSubsampling ) noexcept
+{
+	ConversionCost result;
+	result.upload = getFrameSize(dstFormat, dstSubsampling, resolution);
+
+	const auto copyFunction = getCopyFunction(src, dstFormat, dstSubsampling);
+	if(copyFunction == copyUYVYtoNV16 || copyFunction == copyUYVAtoPA8) {
+		result.cpu = DEINTERLEAVE_COST*result.upload;
+	} else if(copyFunction) {
+		result.cpu = COPY_COST*result.upload;
+	} else if(getChannelFamily(src) != getChannelFamily(dstFormat)) {
+		result.cpu = COLOR_COST*result.upload;
+	} else if(getColorSubsampling(src) == dstSubsampling) {
+		result.cpu = REPACK_COST*result.upload;
+	} else {
+		result.cpu = RESAMPLE_COST*result.upload;
+	}
+
+	return result;
+}
+
+
+
+bool canResample(FourCC src, ColorFormat dst) noexcept {
+	//Conversions within the same color family are possible,
+	//as well as YCbCr to 8 bit RGBA
+	const auto srcFamily = getChannelFamily(src);
+	const auto dstFamily = getChannelFamily(dst);
+	return 	srcFamily != Channels::NONE && 
+			(srcFamily == dstFamily || (srcFamily == Channels::YCBCR && dstFamily == Channels::RGB));
+}
+
+void resample(const VideoFrame& src, const Region& region, Graphics::StagedFrame& dst) noexcept {
+	// Scales the source to fit the destination, preserving its aspect ratio
+	// and padding it with black. Any layout, subsampling or depth can be
+	// converted as long as both belong to the same color family. YCbCr
+	// can also be converted to RGBA, according to its colorimetry.
+
+	const auto srcChannels = getChannels(src, region);
+	const auto dstChannels = getChannels(dst);
+	assert(srcChannels.family == dstChannels.family || srcChannels.family == Channels::YCBCR);
+	assert(dstChannels.family != Channels::NONE);
+
+	//Determine the area where the image will be placed
+	const auto srcResolution = region.resolution;
+	const auto dstResolution = dst.getDescriptor()->getResolution();
+	if(srcResolution.x == 0 || srcResolution.y == 0) {
+		return;
+	}
+
+	size_t width = dstResolution.x;
+	size_t height = dstResolution.y;
+	if(static_cast<uint64_t>(srcResolution.x)*dstResolution.y > static_cast<uint64_t>(dstResolution.x)*srcResolution.y) {
+		//Source is wider. Pad top and bottom
+		height = static_cast<uint64_t>(dstResolution.x)*srcResolution.y / srcResolution.x;
+	} else {
+		//Source is taller. Pad left and right
+		width = static_cast<uint64_t>(dstResolution.y)*srcResolution.x / srcResolution.y;
+	}
+
+	//Keep it aligned to the chroma samples
+	width &= ~size_t(1);
+	height &= ~size_t(1);
+	const size_t x = ((dstResolution.x - width) / 2) & ~size_t(1);
+	const size_t y = ((dstResolution.y - height) / 2) & ~size_t(1);
+	const auto isPadded = width != dstResolution.x || height != dstResolution.y;
+
+	if(srcChannels.family != dstChannels.family) {
+		//YCbCr to RGBA. Channels are interleaved, so convert all of them at once
+		const auto bgra = dst.getDescriptor()->getColorFormat() == ColorFormat::B8G8R8A8;
+		const auto& first = dstChannels.channels[bgra ? Channels::B : Channels::R];
+		const auto colorimetry = getColorimetry(src.getResolution()); //As advertised. Cropping does not alter it
+
+		if(isPadded) {
+			for(size_t i = 0; i < Channels::COUNT; ++i) {
+				const auto index = static_cast<Channels::Index>(i);
+				fillChannel(dstChannels.channels[i], getBlankValue(dstChannels.family, index));
+			}
+		}
+
+		convertChannelsToRGBA(
+			srcChannels.channels[Channels::Y],
+			srcChannels.channels[Channels::CB],
+			srcChannels.channels[Channels::CR],
+			srcChannels.channels[Channels::A],
+			getSubChannel(first, x, y, width, height),
+			bgra,
+			getYCbCrMatrix(colorimetry.model, colorimetry.range)
+		);
+		return;
+	}
+
+	for(size_t i = 0; i < Channels::COUNT; ++i) {
+		const auto index = static_cast<Channels::Index>(i);
+		const auto& dstChannel = dstChannels.channels[i];
+		const auto& srcChannel = srcChannels.channels[i];
+
+		if(!dstChannel) {
+			continue; //Not present in the destination
+		}
+
+		//Express the area in this channel's coordinates, as it may be subsampled
+		const auto area = getSubChannel(
+			dstChannel,
+			x * dstChannel.resolution.x / dstResolution.x,
+			y * dstChannel.resolution.y / dstResolution.y,
+			width * dstChannel.resolution.x / dstResolution.x,
+			height * dstChannel.resolution.y / dstResolution.y
+		);
+
+		if(isPadded) {
+			fillChannel(dstChannel, getBlankValue(dstChannels.family, index));
+		}
+
+		if(srcChannel) {
+			resampleChannel(srcChannel, area);
+		} else {
+			//Not present in the source (i.e. alpha)
+			fillChannel(area, getBlankValue(dstChannels.family, index));
+		}
+	}
+}
+
+void decimate(	const VideoFrame& src, 
+				const Region& region,
+				Graphics::StagedFrame* half, 
+				Graphics::StagedFrame* quarter ) noexcept
+{
+	// Box filters the source by 2 and/or 4, reading it only once. 
+	// Destinations are expected to have the same layout family as
+	// the source and each of their channels to be exactly a half/quarter 
+	// of the source's. Otherwise they are resampled on their own.
+
+	const auto srcChannels = getChannels(src, region);
+
+	const auto isExact = [&srcChannels] (Graphics::StagedFrame* dst, uint32_t factor) -> bool {
+		if(getChannelFamily(dst->getDescriptor()->getColorFormat()) != srcChannels.family) {
+			return false;
+		}
+
+		//Subsampling may differ, i.e. 4:2:0 into 4:2:2
+		const auto dstChannels = getChannels(*dst);
+		for(size_t i = 0; i < Channels::COUNT; ++i) {
+			const auto& srcChannel = srcChannels.channels[i];
+			const auto& dstChannel = dstChannels.channels[i];
+
+			if(srcChannel && dstChannel) {
+				if(	srcChannel.resolution.x != dstChannel.resolution.x * factor ||
+					srcChannel.resolution.y != dstChannel.resolution.y * factor )
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	};
+
+	if(half && !isExact(half, 2)) {
+		resample(src, region, *half);
+		half = nullptr;
+	}
+	if(quarter && !isExact(quarter, 4)) {
+		resample(src, region, *quarter);
+		quarter = nullptr;
+	}
+	if(!half && !quarter) {
+		return;
+	}
+
+	const auto halfChannels = half ? getChannels(*half) : Channels{};
+	const auto quarterChannels = quarter ? getChannels(*quarter) : Channels{};
+	const auto family = srcChannels.family;
+
+	for(size_t i = 0; i < Channels::COUNT; ++i) {
+		const auto index = static_cast<Channels::Index>(i);
+		const auto& srcChannel = srcChannels.channels[i];
+		const auto& halfChannel = halfChannels.channels[i];
+		const auto& quarterChannel = quarterChannels.channels[i];
+
+		if(!halfChannel && !quarterChannel) {
+			continue; //Not present in the destinations
+		}
+
+		if(srcChannel) {
+			decimateChannel(srcChannel, halfChannel, quarterChannel);
+		} else {
+			//Not present in the source (i.e. alpha)
+			if(halfChannel) fillChannel(halfChannel, getBlankValue(family, index));
+			if(quarterChannel) fillChannel(quarterChannel, getBlankValue(family, index));
+		}
+	}
+}
+
+void blend(	const VideoFrame& a,
+			const VideoFrame& b,
+			uint32_t weight,
+			const Region& region,
+			Graphics::StagedFrame& dst,
+			Analyzer* analyzer ) noexcept
+{
+	// Same as a plane copy of b, but blending it with a on the way.
+	// Weight of b is expressed in Q16. Both must have the same layout
+
+	assert(a.getFourCC() == b.getFourCC());
+	assert(a.getResolution() == b.getResolution());
+	assert(a.getStride() == b.getStride());
+
+	const auto aPlanes = getPlanes(a, region);
+	const auto bPlanes = getPlanes(b, region);
+	const auto dstPlanes = getPlanes(dst, bPlanes);
+	const auto layout = getLumaLayout(b.getFourCC());
+
+	for(size_t i = 0; i < dstPlanes.size(); ++i) {
+		if(!dstPlanes[i]) {
+			continue;
+		}
+
+		if(i == 0 && analyzer) {
+			//Analyze each row right after blending it, while it is in cache
+			for(size_t j = 0; j < dstPlanes[i].height; ++j) {
+				const auto getRow = [j] (Plane plane) -> Plane {
+					plane.data += j*plane.stride;
+					plane.height = 1;
+					return plane;
+				};
+
+				const auto dstRow = getRow(dstPlanes[i]);
+				blendPlane(getRow(aPlanes[i]), getRow(bPlanes[i]), dstRow, weight);
+				analyzer->analyzeRow(j, dstRow.data, layout);
+			}
+		} else {
+			blendPlane(aPlanes[i], bPlanes[i], dstPlanes[i], weight);
+		}
+	}
+}
+
 }
\ No newline at end of file
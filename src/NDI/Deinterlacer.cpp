@@ -0,0 +1,159 @@
+#include <zuazo/NDI/Deinterlacer.h>
+
+#include "Channels.h"
+#include "Kernels.h"
+
+#include <cassert>
+
+namespace Zuazo::NDI {
+
+Deinterlacer::Deinterlacer(Mode mode)
+	: m_mode(mode)
+	, m_motionThreshold(DEFAULT_MOTION_THRESHOLD)
+	, m_output()
+	, m_outputData()
+{
+}
+
+
+
+void Deinterlacer::setMode(Mode mode) noexcept {
+	if(m_mode != mode) {
+		m_mode = mode;
+		reset();
+	}
+}
+
+Deinterlacer::Mode Deinterlacer::getMode() const noexcept {
+	return m_mode;
+}
+
+
+void Deinterlacer::setMotionThreshold(uint8_t threshold) noexcept {
+	m_motionThreshold = threshold;
+}
+
+uint8_t Deinterlacer::getMotionThreshold() const noexcept {
+	return m_motionThreshold;
+}
+
+
+
+bool Deinterlacer::isDeinterlacing(const VideoFrame& frame) const noexcept {
+	//Only interleaved frames need to be processed. Weaving 
+	//is what the interleaved frame already is
+	return 	frame.getData() &&
+			frame.getFormat() == VideoFrame::Format::INTERLEAVED &&
+			m_mode != Mode::NONE && 
+			m_mode != Mode::WEAVE ;
+}
+
+const VideoFrame& Deinterlacer::process(	const VideoFrame& frame, 
+											const VideoFrame& previous, 
+											VideoFrame::Format field )
+{
+	//Used when the frame can not be deinterlaced while converting it
+	if(!isDeinterlacing(frame)) {
+		return frame;
+	}
+
+	//Prepare the output frame with the same layout
+	m_outputData.resize(getFrameSize(frame));
+	m_output = frame;
+	m_output.setData(m_outputData.data());
+	m_output.setFormat(VideoFrame::Format::PROGRESSIVE);
+
+	//Field 0 is held on the even rows
+	const size_t fieldIndex = (field == VideoFrame::Format::FIELD1) ? 1 : 0;
+	const auto mode = getMode(frame, previous);
+
+	const auto srcPlanes = getPlanes(frame);
+	const auto prevPlanes = getPlanes(previous);
+	const auto dstPlanes = getPlanes(m_output);
+	for(size_t i = 0; i < srcPlanes.size(); ++i) {
+		if(!srcPlanes[i]) {
+			continue;
+		}
+
+		if(mode == Mode::MOTION_ADAPTIVE) {
+			motionAdaptivePlane(srcPlanes[i], prevPlanes[i], dstPlanes[i], fieldIndex, 0, m_motionThreshold);
+		} else {
+			bobPlane(srcPlanes[i], dstPlanes[i], fieldIndex, 0);
+		}
+	}
+
+	return m_output;
+}
+
+void Deinterlacer::process(	const VideoFrame& frame, 
+							const VideoFrame& previous, 
+							VideoFrame::Format field,
+							const Region& region,
+							Graphics::StagedFrame& dst,
+							Analyzer* analyzer ) const noexcept
+{
+	//Same as a plane copy (see isPlaneCopy), but deinterlacing on the way
+	assert(isDeinterlacing(frame));
+
+	const size_t fieldIndex = (field == VideoFrame::Format::FIELD1) ? 1 : 0;
+	const auto mode = getMode(frame, previous);
+
+	//Neighbouring rows may lay outside of the region. Take whole columns
+	//and only write the rows of the region
+	const Region columns = { region.x, 0, Resolution(region.resolution.x, frame.getResolution().y) };
+	const auto srcPlanes = getPlanes(frame, columns);
+	const auto prevPlanes = (mode == Mode::MOTION_ADAPTIVE) ? getPlanes(previous, columns) : Planes{};
+	const auto regionPlanes = getPlanes(frame, region);
+	const auto dstPlanes = getPlanes(dst, regionPlanes);
+	const auto layout = getLumaLayout(frame.getFourCC());
+
+	for(size_t i = 0; i < dstPlanes.size(); ++i) {
+		if(!dstPlanes[i]) {
+			continue;
+		}
+
+		const auto first = static_cast<size_t>(regionPlanes[i].data - srcPlanes[i].data) / srcPlanes[i].stride;
+		const auto deinterlace = [&, i] (const Plane& dstPlane, size_t dstFirst) {
+			if(mode == Mode::MOTION_ADAPTIVE) {
+				motionAdaptivePlane(srcPlanes[i], prevPlanes[i], dstPlane, fieldIndex, dstFirst, m_motionThreshold);
+			} else {
+				bobPlane(srcPlanes[i], dstPlane, fieldIndex, dstFirst);
+			}
+		};
+
+		if(i == 0 && analyzer) {
+			//Analyze each row right after deinterlacing it, while it is in cache
+			for(size_t j = 0; j < dstPlanes[i].height; ++j) {
+				auto dstRow = dstPlanes[i];
+				dstRow.data += j*dstRow.stride;
+				dstRow.height = 1;
+
+				deinterlace(dstRow, first + j);
+				analyzer->analyzeRow(j, dstRow.data, layout);
+			}
+		} else {
+			deinterlace(dstPlanes[i], first);
+		}
+	}
+}
+
+void Deinterlacer::reset() noexcept {
+	//Nothing is remembered but the intermediate frame
+	m_output = VideoFrame();
+	m_outputData.clear();
+}
+
+
+
+Deinterlacer::Mode Deinterlacer::getMode(const VideoFrame& frame, const VideoFrame& previous) const noexcept {
+	//Motion adaptive deinterlacing needs a previous frame of the same layout
+	const auto hasHistory =
+		previous.getData() &&
+		previous.getResolution() == frame.getResolution() &&
+		previous.getFourCC() == frame.getFourCC() &&
+		previous.getStride() == frame.getStride() ;
+
+	return (m_mode == Mode::MOTION_ADAPTIVE && !hasHistory) ? Mode::BOB : m_mode;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,224 @@
+#include <zuazo/NDI/Discovery.h>
+
+#include <cassert>
+#include <chrono>
+
+namespace Zuazo::NDI {
+
+/*
+ * Discovery::Entry
+ */
+
+Discovery::Entry::Entry(std::string name, std::string url)
+	: m_name(std::move(name))
+	, m_url(std::move(url))
+{
+}
+
+Discovery::Entry::operator Source() const noexcept {
+	return Source(m_name.c_str(), m_url.empty() ? nullptr : m_url.c_str());
+}
+
+const std::string& Discovery::Entry::getName() const noexcept {
+	return m_name;
+}
+
+const std::string& Discovery::Entry::getURL() const noexcept {
+	return m_url;
+}
+
+
+
+/*
+ * Discovery
+ */
+
+Discovery::Discovery(	bool showLocalSources,
+						const char* groups,
+						const char* extraIps )
+	: m_finder(showLocalSources, groups, extraIps)
+	, m_mutex()
+	, m_changed()
+	, m_registry()
+	, m_urlIndex()
+	, m_generation(0)
+	, m_changeCount(0)
+	, m_callbackMutex()
+	, m_callbacks()
+	, m_exit(false)
+	, m_thread(&Discovery::threadFunc, this)
+{
+}
+
+Discovery::~Discovery() {
+	m_exit.store(true);
+	m_thread.join();
+}
+
+
+
+Discovery::EntryRef Discovery::findByName(std::string_view name) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const auto ite = m_registry.find(name);
+	return (ite != m_registry.cend()) ? ite->second.entry : nullptr;
+}
+
+Discovery::EntryRef Discovery::findByURL(std::string_view url) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const auto ite = m_urlIndex.find(url);
+	return (ite != m_urlIndex.cend()) ? ite->second : nullptr;
+}
+
+std::vector<Discovery::EntryRef> Discovery::getSources() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::vector<EntryRef> result;
+	result.reserve(m_registry.size());
+	for(const auto& record : m_registry) {
+		result.push_back(record.second.entry);
+	}
+
+	return result;
+}
+
+size_t Discovery::size() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_registry.size();
+}
+
+
+bool Discovery::waitForChanges(uint32_t timeo) const {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	const auto changeCount = m_changeCount;
+	return m_changed.wait_for(
+		lock, 
+		std::chrono::milliseconds(timeo),
+		[this, changeCount] () -> bool {
+			return m_changeCount != changeCount;
+		}
+	);
+}
+
+
+Discovery::Handle Discovery::subscribe(Callback callback) {
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	return m_callbacks.insert(m_callbacks.cend(), std::move(callback));
+}
+
+void Discovery::unsubscribe(Handle handle) {
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	m_callbacks.erase(handle);
+}
+
+
+
+void Discovery::threadFunc() {
+	//Sources may have been already discovered
+	update();
+
+	//Finder only returns when something changes or on timeout, 
+	//so that exit requests are attended periodically
+	while(!m_exit.load()) {
+		if(m_finder.waitForSources(DEFAULT_POLL_TIMEOUT)) {
+			update();
+		}
+	}
+}
+
+void Discovery::update() {
+	//The returned memory is owned by the SDK and gets invalidated
+	//on the next call. Only the differences are copied
+	const auto sources = m_finder.getCurrentSources();
+	std::vector<std::pair<Event, EntryRef>> events;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const auto generation = ++m_generation;
+
+		//Mark the sources present in this list
+		for(const auto& source : sources) {
+			const std::string_view name = source.getName() ? source.getName() : "";
+			const std::string_view url = source.getURL() ? source.getURL() : "";
+			if(name.empty()) {
+				continue;
+			}
+
+			const auto ite = m_registry.find(name);
+			if(ite == m_registry.cend()) {
+				//New source
+				auto entry = std::make_shared<const Entry>(std::string(name), std::string(url));
+				m_registry.emplace(entry->getName(), Record{ entry, generation });
+				indexURL(entry);
+				events.emplace_back(Event::ADDED, std::move(entry));
+
+			} else if(ite->second.entry->getURL() != url) {
+				//Same source, different location. Entries are immutable,
+				//so it gets replaced. Keys refer to the old one, re-insert it
+				const auto& oldEntry = ite->second.entry;
+				const auto oldURLIte = m_urlIndex.find(oldEntry->getURL());
+				if(oldURLIte != m_urlIndex.cend() && oldURLIte->second == oldEntry) {
+					m_urlIndex.erase(oldURLIte);
+				}
+				m_registry.erase(ite);
+
+				auto entry = std::make_shared<const Entry>(std::string(name), std::string(url));
+				m_registry.emplace(entry->getName(), Record{ entry, generation });
+				indexURL(entry);
+				events.emplace_back(Event::CHANGED, std::move(entry));
+
+			} else {
+				//Still there
+				ite->second.generation = generation;
+
+			}
+		}
+
+		//Sweep the sources that are no longer present
+		for(auto ite = m_registry.begin(); ite != m_registry.end(); ) {
+			if(ite->second.generation != generation) {
+				const auto& entry = ite->second.entry;
+				const auto urlIte = m_urlIndex.find(entry->getURL());
+				if(urlIte != m_urlIndex.cend() && urlIte->second == entry) {
+					m_urlIndex.erase(urlIte);
+				}
+
+				events.emplace_back(Event::REMOVED, entry);
+				ite = m_registry.erase(ite);
+			} else {
+				++ite;
+			}
+		}
+
+		if(!events.empty()) {
+			++m_changeCount;
+			m_changed.notify_all();
+		}
+	}
+
+	//Notify in an unlocked environment, so that the registry can be queried
+	for(const auto& event : events) {
+		notify(event.first, event.second);
+	}
+}
+
+void Discovery::indexURL(const EntryRef& entry) {
+	if(entry->getURL().empty()) {
+		return;
+	}
+
+	//Keys refer to the string held by the indexed entry. Another one
+	//may have the same URL, so the key is re-inserted with the value
+	m_urlIndex.erase(entry->getURL());
+	m_urlIndex.emplace(entry->getURL(), entry);
+}
+
+void Discovery::notify(Event event, const EntryRef& entry) {
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	for(const auto& callback : m_callbacks) {
+		if(callback) {
+			callback(event, entry);
+		}
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,318 @@
+#include <zuazo/NDI/Exporter.h>
+
+#include <zuazo/Exception.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Zuazo::NDI {
+
+static constexpr int EXPORTER_POLL_TIMEOUT = 500; //ms
+static constexpr int EXPORTER_BACKLOG = 8;
+static constexpr size_t EXPORTER_MAX_REQUEST_SIZE = 4096;
+
+static void writeExporterLabel(std::ostream& os, std::string_view value) {
+	//As required by the exposition format
+	os << '"';
+	for(const auto c : value) {
+		switch(c) {
+		case '\\':	os << "\\\\"; break;
+		case '"':	os << "\\\""; break;
+		case '\n':	os << "\\n"; break;
+		default:	os << c; break;
+		}
+	}
+	os << '"';
+}
+
+static bool sendExporterData(int connection, std::string_view data) noexcept {
+	while(!data.empty()) {
+		const auto sent = send(connection, data.data(), data.size(), MSG_NOSIGNAL);
+		if(sent <= 0) {
+			return false;
+		}
+		data.remove_prefix(sent);
+	}
+
+	return true;
+}
+
+
+
+Exporter::Exporter()
+	: m_mutex()
+	, m_entries()
+	, m_socket(-1)
+	, m_socketPath()
+	, m_exit(false)
+	, m_thread()
+{
+}
+
+Exporter::~Exporter() {
+	stop();
+}
+
+
+
+Exporter::Handle Exporter::add(std::string source, MetricsRef metrics) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.emplace(m_entries.cend(), Entry{ std::move(source), std::move(metrics) });
+}
+
+void Exporter::remove(Handle handle) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries.erase(handle);
+}
+
+
+
+void Exporter::listen(uint16_t port, const char* address) {
+	stop();
+
+	sockaddr_in addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	if(inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+		throw Exception("Invalid metrics address");
+	}
+
+	const auto fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(fd < 0) {
+		throw Exception("Metrics socket could not be created");
+	}
+
+	const int reuse = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	if(bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, EXPORTER_BACKLOG) < 0) {
+		close(fd);
+		throw Exception("Metrics port could not be bound");
+	}
+
+	start(fd);
+}
+
+void Exporter::listen(const std::string& path) {
+	stop();
+
+	sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(path.empty() || path.size() >= sizeof(addr.sun_path)) {
+		throw Exception("Invalid metrics socket path");
+	}
+	std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+	const auto fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(fd < 0) {
+		throw Exception("Metrics socket could not be created");
+	}
+
+	//Remove any stale socket left by a previous run
+	unlink(path.c_str());
+	if(bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, EXPORTER_BACKLOG) < 0) {
+		close(fd);
+		throw Exception("Metrics socket could not be bound");
+	}
+
+	m_socketPath = path;
+	start(fd);
+}
+
+void Exporter::stop() {
+	if(m_thread.joinable()) {
+		m_exit.store(true);
+		m_thread.join();
+	}
+
+	if(m_socket >= 0) {
+		close(m_socket);
+		m_socket = -1;
+	}
+
+	if(!m_socketPath.empty()) {
+		unlink(m_socketPath.c_str());
+		m_socketPath.clear();
+	}
+}
+
+bool Exporter::isListening() const noexcept {
+	return m_socket >= 0;
+}
+
+
+
+void Exporter::write(std::ostream& os) const {
+	//Only the list is copied while locked. Metrics are read afterwards
+	std::vector<Entry> entries;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		entries.assign(m_entries.cbegin(), m_entries.cend());
+	}
+
+	const auto writeFamily = [&os, &entries] (	const char* name,
+												const char* type,
+												const char* help,
+												const auto& getValue )
+	{
+		os << "# HELP " << name << ' ' << help << '\n';
+		os << "# TYPE " << name << ' ' << type << '\n';
+		for(const auto& entry : entries) {
+			os << name << "{source=";
+			writeExporterLabel(os, entry.source);
+			os << "} " << getValue(*entry.metrics) << '\n';
+		}
+	};
+
+	constexpr auto relaxed = std::memory_order_relaxed;
+	os << std::setprecision(9);
+
+	writeFamily(
+		"zuazo_ndi_captured_frames_total", "counter",
+		"Frames captured from the receiver",
+		[] (const Metrics& m) { return m.capturedFrames.load(relaxed); }
+	);
+	writeFamily(
+		"zuazo_ndi_duplicated_frames_total", "counter",
+		"Frames captured again, as no new frame had arrived",
+		[] (const Metrics& m) { return m.duplicatedFrames.load(relaxed); }
+	);
+	writeFamily(
+		"zuazo_ndi_dropped_frames_total", "counter",
+		"Frames dropped by the receiver",
+		[] (const Metrics& m) { return m.droppedFrames.load(relaxed); }
+	);
+	writeFamily(
+		"zuazo_ndi_format_changes_total", "counter",
+		"Changes of resolution, FourCC, frame rate or field order",
+		[] (const Metrics& m) { return m.formatChanges.load(relaxed); }
+	);
+	writeFamily(
+		"zuazo_ndi_conversions_total", "counter",
+		"Frames converted and uploaded",
+		[] (const Metrics& m) { return m.conversions.load(relaxed); }
+	);
+	writeFamily(
+		"zuazo_ndi_conversion_seconds_total", "counter",
+		"Time spent converting and uploading frames",
+		[] (const Metrics& m) { return m.conversionTime.load(relaxed) / 1e9; }
+	);
+	writeFamily(
+		"zuazo_ndi_upload_bytes_total", "counter",
+		"Bytes uploaded to the GPU",
+		[] (const Metrics& m) { return m.uploadedBytes.load(relaxed); }
+	);
+	writeFamily(
+		"zuazo_ndi_frame_rate", "gauge",
+		"Frames per second received by the SDK",
+		[] (const Metrics& m) { return m.frameRate.load(relaxed); }
+	);
+	writeFamily(
+		"zuazo_ndi_queue_depth", "gauge",
+		"Frames waiting to be captured",
+		[] (const Metrics& m) { return m.queueDepth.load(relaxed); }
+	);
+	writeFamily(
+		"zuazo_ndi_connections", "gauge",
+		"Connections of the receiver",
+		[] (const Metrics& m) { return m.connections.load(relaxed); }
+	);
+	writeFamily(
+		"zuazo_ndi_program_tally", "gauge",
+		"Whether the source is on program",
+		[] (const Metrics& m) { return static_cast<int>(m.programTally.load(relaxed)); }
+	);
+	writeFamily(
+		"zuazo_ndi_preview_tally", "gauge",
+		"Whether the source is on preview",
+		[] (const Metrics& m) { return static_cast<int>(m.previewTally.load(relaxed)); }
+	);
+}
+
+
+
+void Exporter::start(int socket) {
+	m_socket = socket;
+	m_exit.store(false);
+	m_thread = std::thread(&Exporter::threadFunc, this);
+}
+
+void Exporter::threadFunc() {
+	//Wake up periodically, so that exit requests are attended
+	while(!m_exit.load()) {
+		pollfd pfd = { m_socket, POLLIN, 0 };
+		if(poll(&pfd, 1, EXPORTER_POLL_TIMEOUT) <= 0) {
+			continue;
+		}
+
+		const auto connection = accept4(m_socket, nullptr, nullptr, SOCK_CLOEXEC);
+		if(connection >= 0) {
+			serve(connection);
+			close(connection);
+		}
+	}
+}
+
+void Exporter::serve(int connection) const {
+	//Scrapers are local and trusted, but a stalled one
+	//must not block the exporter forever
+	const timeval timeout = { 1, 0 };
+	setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	//Read until the end of the headers. The body is ignored
+	std::string request;
+	char buffer[512];
+	while(request.find("\r\n\r\n") == std::string::npos && request.size() < EXPORTER_MAX_REQUEST_SIZE) {
+		const auto received = recv(connection, buffer, sizeof(buffer), 0);
+		if(received <= 0) {
+			return;
+		}
+		request.append(buffer, received);
+	}
+
+	//Request line is in the form "GET /metrics HTTP/1.1"
+	const std::string_view requestLine(request.data(), std::min(request.find("\r\n"), request.size()));
+	const auto isGet = requestLine.substr(0, 4) == "GET ";
+	const auto target = isGet ? requestLine.substr(4, requestLine.find(' ', 4) - 4) : std::string_view();
+
+	std::ostringstream body;
+	std::string_view status;
+	std::string_view contentType;
+	if(!isGet) {
+		status = "405 Method Not Allowed";
+		contentType = "text/plain";
+	} else if(target == "/metrics" || target == "/") {
+		status = "200 OK";
+		contentType = CONTENT_TYPE;
+		write(body);
+	} else {
+		status = "404 Not Found";
+		contentType = "text/plain";
+	}
+
+	const auto content = body.str();
+	std::ostringstream header;
+	header << "HTTP/1.1 " << status << "\r\n";
+	header << "Content-Type: " << contentType << "\r\n";
+	header << "Content-Length: " << content.size() << "\r\n";
+	header << "Connection: close\r\n\r\n";
+
+	if(sendExporterData(connection, header.str())) {
+		sendExporterData(connection, content);
+	}
+}
+
+}
\ No newline at end of file
@@ -5,6 +5,8 @@
 
 #include <zuazo/Modules/NDI.h>
 
+#include <utility>
+
 namespace Zuazo::NDI {
 
 static_assert(sizeof(Finder) == sizeof(NDIlib_find_instance_t), "Sizes do not match");
@@ -25,7 +27,7 @@ static NDIlib_find_instance_t createFindInstance(	bool showLocalSources,
 }
 
 static void destroyFindInstance(NDIlib_find_instance_t instance) {
-	const auto& ndi = Modules::NDI::get().getNDI();
+	const auto& ndi = Modules::NDI::get().getLoadedNDI();
 	ndi.find_destroy(instance);
 }
 
@@ -56,20 +58,20 @@ Finder::~Finder() {
 }
 
 Finder&	Finder::operator=(Finder&& other) noexcept {
-	m_impl = other.m_impl;
-	other.m_impl = nullptr;
+	//Swap, so that the previous instance gets destroyed by other
+	std::swap(m_impl, other.m_impl);
 	return *this;
 }
 
 
 
 bool Finder::waitForSources(uint32_t timeo) const noexcept {
-	const auto& ndi = Modules::NDI::get().getNDI();
+	const auto& ndi = Modules::NDI::get().getLoadedNDI();
 	return ndi.find_wait_for_sources(m_impl, timeo);
 }
 
 Utils::BufferView<const Source>	Finder::getCurrentSources() const noexcept {
-	const auto& ndi = Modules::NDI::get().getNDI();
+	const auto& ndi = Modules::NDI::get().getLoadedNDI();
 	uint32_t count;
 	const auto sources = ndi.find_get_current_sources(m_impl, &count);
 	return Utils::BufferView<const Source>(
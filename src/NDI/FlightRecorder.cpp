@@ -0,0 +1,357 @@
+#include <zuazo/NDI/FlightRecorder.h>
+
+#include <zuazo/Exception.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <fstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#endif
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+namespace Zuazo::NDI {
+
+static_assert(sizeof(FlightRecorder::Record) == 32, "Records must be packed, as they are written as they are");
+
+static constexpr uint32_t FLIGHT_RECORDER_VERSION = 1;
+static constexpr uint32_t FLIGHT_RECORDER_MAX_SOURCE_NAME = 4096; //Way longer than any NDI name or URL
+
+/*
+ * FlightRecorder::Slot
+ */
+
+struct FlightRecorder::Slot {
+	//Every field is atomic, so that slots can be read while they are
+	//being overwritten. The sequence tells if the read was consistent
+	std::atomic<uint64_t>				sequence;	//2n+1 while writing the nth event, 2n+2 when done
+	std::atomic<uint64_t>				time;		//In ticks
+	std::atomic<uint64_t>				info;		//Event type on the high half, source on the low half
+	std::atomic<int64_t>				arg0;
+	std::atomic<int64_t>				arg1;
+};
+
+
+
+/*
+ * FlightRecorder
+ */
+
+//Write end of the pipe of the recorder attending signals. Only
+//async-signal-safe operations may be done on it by the handler
+static std::atomic<int> s_flightRecorderSignalPipe(-1);
+
+static void flightRecorderSignalHandler(int) {
+	const auto savedErrno = errno;
+	const auto fd = s_flightRecorderSignalPipe.load();
+	if(fd >= 0) {
+		const char c = 0;
+		[[maybe_unused]] const auto written = ::write(fd, &c, sizeof(c));
+	}
+	errno = savedErrno;
+}
+
+static uint64_t getFlightRecorderTime() noexcept {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(FlightRecorder::Clock::now().time_since_epoch()).count();
+}
+
+static uint64_t getFlightRecorderTicks() noexcept {
+	//The time stamp counter is several times cheaper to read than
+	//the steady clock. It is converted when dumping
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return getFlightRecorderTime();
+#endif
+}
+
+static size_t getFlightRecorderCapacity(size_t capacity) noexcept {
+	//Round up to a power of 2, so that indices can be masked
+	size_t result = 1;
+	while(result < capacity) {
+		result <<= 1;
+	}
+	return result;
+}
+
+template<typename T>
+static void writeFlightRecorderValue(std::ostream& os, const T& value) {
+	os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template<typename T>
+static T readFlightRecorderValue(std::istream& is) {
+	T result;
+	if(!is.read(reinterpret_cast<char*>(&result), sizeof(result))) {
+		throw Exception("Truncated flight recorder dump");
+	}
+	return result;
+}
+
+FlightRecorder::FlightRecorder(size_t capacity)
+	: m_originTicks(getFlightRecorderTicks())
+	, m_originTime(getFlightRecorderTime())
+	, m_slots(new Slot[getFlightRecorderCapacity(capacity)])
+	, m_mask(getFlightRecorderCapacity(capacity) - 1)
+	, m_head(0)
+	, m_tail(0)
+	, m_mutex()
+	, m_path()
+	, m_sources()
+	, m_signal(0)
+	, m_signalPipe{ -1, -1 }
+	, m_signalThread()
+{
+	for(size_t i = 0; i <= m_mask; ++i) {
+		m_slots[i].sequence.store(0, std::memory_order_relaxed);
+	}
+}
+
+FlightRecorder::~FlightRecorder() {
+	if(m_signalThread.joinable()) {
+		//Stop attending the signal. Closing the pipe ends the thread
+		signal(m_signal, SIG_DFL);
+		s_flightRecorderSignalPipe.store(-1);
+		close(m_signalPipe[1]);
+		m_signalThread.join();
+		close(m_signalPipe[0]);
+	}
+}
+
+
+
+void FlightRecorder::setPath(std::string path) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_path = std::move(path);
+}
+
+const std::string& FlightRecorder::getPath() const noexcept {
+	return m_path;
+}
+
+
+uint32_t FlightRecorder::getSourceId(std::string_view name) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	//Sources are few, a linear search is enough
+	const auto ite = std::find(m_sources.cbegin(), m_sources.cend(), name);
+	if(ite != m_sources.cend()) {
+		return static_cast<uint32_t>(std::distance(m_sources.cbegin(), ite));
+	}
+
+	m_sources.emplace_back(name);
+	return static_cast<uint32_t>(m_sources.size() - 1);
+}
+
+
+void FlightRecorder::record(Event event,
+							uint32_t source,
+							int64_t arg0,
+							int64_t arg1 ) noexcept
+{
+	const auto time = getFlightRecorderTicks();
+
+	//Claim a slot. Writers only collide when a whole lap is
+	//completed during a write, which is discarded when read
+	const auto n = m_head.fetch_add(1, std::memory_order_relaxed);
+	auto& slot = m_slots[n & m_mask];
+
+	slot.sequence.store(2*n + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.time.store(time, std::memory_order_relaxed);
+	slot.info.store((static_cast<uint64_t>(event) << 32) | source, std::memory_order_relaxed);
+	slot.arg0.store(arg0, std::memory_order_relaxed);
+	slot.arg1.store(arg1, std::memory_order_relaxed);
+	slot.sequence.store(2*n + 2, std::memory_order_release);
+}
+
+void FlightRecorder::clear() noexcept {
+	m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+
+void FlightRecorder::write(std::ostream& os) const {
+	const auto systemTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	const auto steadyTime = getFlightRecorderTime();
+	const auto ticks = getFlightRecorderTicks();
+
+	//Ticks are converted into nanoseconds, measuring their rate
+	//since the creation of the recorder
+	const auto rate = (ticks > m_originTicks && steadyTime > m_originTime) ?
+		static_cast<double>(steadyTime - m_originTime) / (ticks - m_originTicks) :
+		1.0 ;
+	const auto toTime = [this, rate] (uint64_t t) -> uint64_t {
+		return m_originTime + static_cast<int64_t>(static_cast<int64_t>(t - m_originTicks) * rate);
+	};
+
+	//Take a snapshot of the ring. Events being written are skipped
+	std::vector<Record> records;
+	const auto last = m_head.load(std::memory_order_acquire);
+	const auto capacity = m_mask + 1;
+	const auto first = std::max(m_tail.load(std::memory_order_relaxed), (last > capacity) ? last - capacity : 0);
+	records.reserve(last - first);
+
+	for(auto n = first; n < last; ++n) {
+		const auto& slot = m_slots[n & m_mask];
+
+		const auto sequence = slot.sequence.load(std::memory_order_acquire);
+		const auto info = slot.info.load(std::memory_order_relaxed);
+		const Record record = {
+			toTime(slot.time.load(std::memory_order_relaxed)),
+			static_cast<uint32_t>(info),
+			static_cast<Event>(info >> 32),
+			slot.arg0.load(std::memory_order_relaxed),
+			slot.arg1.load(std::memory_order_relaxed)
+		};
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if(sequence == 2*n + 2 && slot.sequence.load(std::memory_order_relaxed) == sequence) {
+			records.push_back(record);
+		}
+	}
+
+	//Slots are claimed after being timestamped, so order might not be strict
+	std::stable_sort(
+		records.begin(), records.end(),
+		[] (const Record& lhs, const Record& rhs) -> bool {
+			return lhs.time < rhs.time;
+		}
+	);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	//Header
+	os.write(MAGIC, sizeof(MAGIC));
+	writeFlightRecorderValue(os, FLIGHT_RECORDER_VERSION);
+	writeFlightRecorderValue(os, static_cast<uint32_t>(m_sources.size()));
+	writeFlightRecorderValue(os, static_cast<uint64_t>(records.size()));
+	writeFlightRecorderValue(os, static_cast<int64_t>(systemTime));
+	writeFlightRecorderValue(os, static_cast<uint64_t>(steadyTime));
+
+	//Source names, prefixed by their length
+	for(const auto& source : m_sources) {
+		writeFlightRecorderValue(os, static_cast<uint32_t>(source.size()));
+		os.write(source.data(), source.size());
+	}
+
+	//Records, as they are laid out in memory
+	os.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+}
+
+bool FlightRecorder::dump() const {
+	std::string path;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		path = m_path;
+	}
+
+	return !path.empty() && dump(path);
+}
+
+bool FlightRecorder::dump(const std::string& path) const {
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if(!file) {
+		return false;
+	}
+
+	write(file);
+	return static_cast<bool>(file);
+}
+
+void FlightRecorder::dumpOnSignal(int signal) {
+	if(m_signalThread.joinable()) {
+		throw Exception("Flight recorder is already attending a signal");
+	}
+
+	//The handler only notifies the thread, which dumps to the path
+	if(pipe2(m_signalPipe, O_CLOEXEC) < 0) {
+		throw Exception("Flight recorder signal pipe could not be created");
+	}
+	fcntl(m_signalPipe[1], F_SETFL, O_NONBLOCK);
+
+	m_signal = signal;
+	m_signalThread = std::thread(&FlightRecorder::signalThreadFunc, this);
+	s_flightRecorderSignalPipe.store(m_signalPipe[1]);
+
+	struct sigaction action = {};
+	action.sa_handler = flightRecorderSignalHandler;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	sigaction(signal, &action, nullptr);
+}
+
+
+FlightRecorder::Dump FlightRecorder::read(std::istream& is) {
+	char magic[sizeof(MAGIC)];
+	if(!is.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), MAGIC)) {
+		throw Exception("Not a flight recorder dump");
+	}
+	if(readFlightRecorderValue<uint32_t>(is) != FLIGHT_RECORDER_VERSION) {
+		throw Exception("Unsupported flight recorder dump version");
+	}
+
+	Dump result;
+	const auto sourceCount = readFlightRecorderValue<uint32_t>(is);
+	const auto recordCount = readFlightRecorderValue<uint64_t>(is);
+	result.systemTime = readFlightRecorderValue<int64_t>(is);
+	result.steadyTime = readFlightRecorderValue<uint64_t>(is);
+
+	for(uint32_t i = 0; i < sourceCount; ++i) {
+		//Lengths are checked, so that a corrupt one does not cause a huge allocation
+		const auto length = readFlightRecorderValue<uint32_t>(is);
+		if(length > FLIGHT_RECORDER_MAX_SOURCE_NAME) {
+			throw Exception("Corrupt flight recorder dump");
+		}
+
+		std::string source(length, '\0');
+		if(!is.read(source.data(), source.size())) {
+			throw Exception("Truncated flight recorder dump");
+		}
+		result.sources.push_back(std::move(source));
+	}
+
+	//Records are read one by one, so that a corrupt count does not
+	//cause a huge allocation
+	for(uint64_t i = 0; i < recordCount; ++i) {
+		result.records.push_back(readFlightRecorderValue<Record>(is));
+	}
+
+	return result;
+}
+
+std::string_view FlightRecorder::getEventName(Event event) noexcept {
+	switch(event) {
+	case Event::CAPTURE:			return "capture";
+	case Event::REPEAT:				return "repeat";
+	case Event::FORMAT_CHANGE:		return "format change";
+	case Event::CONVERSION:			return "conversion";
+	case Event::DROP:				return "drop";
+	case Event::POOL_EXHAUSTED:		return "pool exhausted";
+	case Event::TALLY:				return "tally";
+	case Event::RECONNECT:			return "reconnect";
+	case Event::CONNECTIONS:		return "connections";
+	default:						return "";
+	}
+}
+
+
+
+void FlightRecorder::signalThreadFunc() {
+	//Ends when the pipe is closed
+	char c;
+	while(true) {
+		const auto received = ::read(m_signalPipe[0], &c, sizeof(c));
+		if(received > 0) {
+			dump();
+		} else if(received == 0 || errno != EINTR) {
+			break;
+		}
+	}
+}
+
+}
\ No newline at end of file
@@ -5,6 +5,8 @@
 
 #include <zuazo/Modules/NDI.h>
 
+#include <utility>
+
 namespace Zuazo::NDI {
 
 static_assert(sizeof(FrameSync) == sizeof(NDIlib_framesync_instance_t), "Sizes do not match");
@@ -17,7 +19,7 @@ static NDIlib_framesync_instance_t createFrameSyncInstance(const Recv& recv)
 }
 
 static void destroyFrameSyncInstance(NDIlib_framesync_instance_t instance) {
-	const auto& ndi = Modules::NDI::get().getNDI();
+	const auto& ndi = Modules::NDI::get().getLoadedNDI();
 	ndi.framesync_destroy(instance);
 }
 
@@ -46,15 +48,20 @@ FrameSync::~FrameSync() {
 }
 
 FrameSync& FrameSync::operator=(FrameSync&& other) noexcept {
-	m_impl = other.m_impl;
-	other.m_impl = nullptr;
+	//Swap, so that the previous instance gets destroyed by other
+	std::swap(m_impl, other.m_impl);
 	return *this;
 }
 
 
+FrameSync::operator bool() const noexcept {
+	return m_impl;
+}
+
+
 
 void FrameSync::capture(VideoFrame& frame, VideoFrame::Format format) noexcept {
-	const auto& ndi = Modules::NDI::get().getNDI();
+	const auto& ndi = Modules::NDI::get().getLoadedNDI();
 	ndi.framesync_capture_video(
 		m_impl,
 		&static_cast<NDIlib_video_frame_v2_t&>(frame),
@@ -63,7 +70,7 @@ void FrameSync::capture(VideoFrame& frame, VideoFrame::Format format) noexcept {
 }
 
 void FrameSync::free(VideoFrame& frame) noexcept {
-	const auto& ndi = Modules::NDI::get().getNDI();
+	const auto& ndi = Modules::NDI::get().getLoadedNDI();
 	ndi.framesync_free_video(
 		m_impl,
 		&static_cast<NDIlib_video_frame_v2_t&>(frame)
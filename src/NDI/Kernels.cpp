@@ -0,0 +1,1262 @@
+#include "Kernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+namespace Zuazo::NDI {
+
+/*
+ * Samples are processed in 16 bits regardless of their storage depth.
+ * Filter weights are expressed in fixed point, adding up to WEIGHT_ONE
+ */
+
+static constexpr uint32_t WEIGHT_BITS = 14;
+static constexpr uint32_t WEIGHT_ONE = 1U << WEIGHT_BITS;
+static constexpr uint32_t WEIGHT_ROUND = WEIGHT_ONE / 2;
+
+static inline uint16_t loadSample(const std::byte* ptr, size_t depth) noexcept {
+	if(depth == sizeof(uint8_t)) {
+		const auto value = std::to_integer<uint16_t>(*ptr);
+		return (value << 8) | value;
+	} else {
+		assert(depth == sizeof(uint16_t));
+		uint16_t value;
+		std::memcpy(&value, ptr, sizeof(value));
+		return value;
+	}
+}
+
+static inline void storeSample(std::byte* ptr, size_t depth, uint16_t value) noexcept {
+	if(depth == sizeof(uint8_t)) {
+		*ptr = static_cast<std::byte>(value >> 8);
+	} else {
+		assert(depth == sizeof(uint16_t));
+		std::memcpy(ptr, &value, sizeof(value));
+	}
+}
+
+template<size_t srcDepth, size_t dstDepth>
+static void copySamples(const Channel& src, const Channel& dst) noexcept {
+	assert(src.depth == srcDepth);
+	assert(dst.depth == dstDepth);
+
+	for(size_t i = 0; i < dst.resolution.y; ++i) {
+		const auto* srcPtr = src.data + i*src.stride;
+		auto* dstPtr = dst.data + i*dst.stride;
+
+		for(size_t j = 0; j < dst.resolution.x; ++j) {
+			storeSample(dstPtr, dstDepth, loadSample(srcPtr, srcDepth));
+			srcPtr += src.step;
+			dstPtr += dst.step;
+		}
+	}
+}
+
+static void loadRow(const Channel& src, size_t row, uint16_t* dst) noexcept {
+	const auto* ptr = src.data + row*src.stride;
+	const size_t count = src.resolution.x;
+	size_t i = 0;
+
+	if(src.depth == sizeof(uint16_t) && src.step == sizeof(uint16_t)) {
+		//Already in the intermediate layout
+		std::memcpy(dst, ptr, count*sizeof(uint16_t));
+		return;
+	}
+
+#if defined(__SSE2__)
+	//Vectors of interleaved channels also span the samples of the
+	//other channels. Stop a sample earlier so that they do not read
+	//past the last sample of the row
+	if(src.depth == sizeof(uint8_t) && src.step == sizeof(uint8_t)) {
+		//Expand to 16 bits by duplicating the byte
+		for(; i + 16 <= count; i += 16) {
+			const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 0), _mm_unpacklo_epi8(v, v));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(v, v));
+		}
+	} else if(src.depth == sizeof(uint8_t) && src.step == 2*sizeof(uint8_t)) {
+		const auto mask = _mm_set1_epi16(0x00FF);
+		for(; i + 8 < count; i += 8) {
+			const auto v = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + 2*i)), mask);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(v, _mm_slli_epi16(v, 8)));
+		}
+	} else if(src.step == 4*sizeof(uint8_t)) {
+		//Keep the low part of each 32 bit lane. 16 bit samples are sign
+		//extended so that the signed pack preserves them
+		const auto isWide = src.depth == sizeof(uint16_t);
+		const auto mask = _mm_set1_epi32(0xFF);
+		const auto extract = [isWide, mask] (__m128i v) -> __m128i {
+			return isWide ? _mm_srai_epi32(_mm_slli_epi32(v, 16), 16) : _mm_and_si128(v, mask);
+		};
+
+		for(; i + 8 < count; i += 8) {
+			const auto* p = reinterpret_cast<const __m128i*>(ptr + 4*i);
+			auto v = _mm_packs_epi32(extract(_mm_loadu_si128(p + 0)), extract(_mm_loadu_si128(p + 1)));
+			if(!isWide) {
+				v = _mm_or_si128(v, _mm_slli_epi16(v, 8));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+		}
+	}
+#endif
+
+	for(ptr += i*src.step; i < count; ++i) {
+		dst[i] = loadSample(ptr, src.depth);
+		ptr += src.step;
+	}
+}
+
+static void storeRow(const Channel& dst, size_t row, const uint16_t* src) noexcept {
+	auto* ptr = dst.data + row*dst.stride;
+	const size_t count = dst.resolution.x;
+	size_t i = 0;
+
+	if(dst.depth == sizeof(uint16_t) && dst.step == sizeof(uint16_t)) {
+		std::memcpy(ptr, src, count*sizeof(uint16_t));
+		return;
+	}
+
+#if defined(__SSE2__)
+	//Samples of interleaved channels are merged into the vector of 
+	//the destination, leaving the other channels untouched. As in 
+	//loadRow, vectors must not go past the last sample
+	const auto merge = [] (std::byte* p, __m128i v, __m128i mask) {
+		const auto old = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_or_si128(_mm_andnot_si128(mask, old), v));
+	};
+
+	if(dst.depth == sizeof(uint8_t) && dst.step == sizeof(uint8_t)) {
+		for(; i + 16 <= count; i += 16) {
+			const auto v0 = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 0)), 8);
+			const auto v1 = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8)), 8);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(ptr + i), _mm_packus_epi16(v0, v1));
+		}
+	} else if(dst.depth == sizeof(uint8_t) && dst.step == 2*sizeof(uint8_t)) {
+		const auto mask = _mm_set1_epi16(0x00FF);
+		for(; i + 8 < count; i += 8) {
+			const auto v = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), 8);
+			merge(ptr + 2*i, v, mask);
+		}
+	} else if(dst.step == 4*sizeof(uint8_t)) {
+		const auto isWide = dst.depth == sizeof(uint16_t);
+		const auto zero = _mm_setzero_si128();
+		const auto mask = _mm_set1_epi32(isWide ? 0xFFFF : 0xFF);
+		for(; i + 8 < count; i += 8) {
+			auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			if(!isWide) {
+				v = _mm_srli_epi16(v, 8);
+			}
+			merge(ptr + 4*i + 0, _mm_unpacklo_epi16(v, zero), mask);
+			merge(ptr + 4*i + 16, _mm_unpackhi_epi16(v, zero), mask);
+		}
+	}
+#endif
+
+	for(ptr += i*dst.step; i < count; ++i) {
+		storeSample(ptr, dst.depth, src[i]);
+		ptr += dst.step;
+	}
+}
+
+static void accumulateRow(uint32_t* acc, const uint16_t* row, uint16_t weight, size_t count) noexcept {
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	//Widening multiply-add of 8 samples at a time
+	const auto w = _mm_set1_epi16(static_cast<short>(weight));
+	for(; i + 8 <= count; i += 8) {
+		const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+		const auto lo = _mm_mullo_epi16(v, w);
+		const auto hi = _mm_mulhi_epu16(v, w);
+
+		auto* a = reinterpret_cast<__m128i*>(acc + i);
+		_mm_storeu_si128(a + 0, _mm_add_epi32(_mm_loadu_si128(a + 0), _mm_unpacklo_epi16(lo, hi)));
+		_mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi16(lo, hi)));
+	}
+#endif
+
+	for(; i < count; ++i) {
+		acc[i] += static_cast<uint32_t>(row[i]) * weight;
+	}
+}
+
+static void normalizeRow(uint16_t* dst, const uint32_t* acc, size_t count) noexcept {
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	//There is no unsigned 32->16 pack in SSE2. Bias the values to use the signed one
+	const auto round = _mm_set1_epi32(WEIGHT_ROUND);
+	const auto bias = _mm_set1_epi32(0x8000);
+	const auto unbias = _mm_set1_epi16(static_cast<short>(0x8000));
+	for(; i + 8 <= count; i += 8) {
+		const auto* a = reinterpret_cast<const __m128i*>(acc + i);
+		const auto a0 = _mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(_mm_loadu_si128(a + 0), round), WEIGHT_BITS), bias);
+		const auto a1 = _mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(_mm_loadu_si128(a + 1), round), WEIGHT_BITS), bias);
+		const auto packed = _mm_xor_si128(_mm_packs_epi32(a0, a1), unbias);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+	}
+#endif
+
+	for(; i < count; ++i) {
+		dst[i] = static_cast<uint16_t>(std::min<uint32_t>((acc[i] + WEIGHT_ROUND) >> WEIGHT_BITS, 0xFFFF));
+	}
+}
+
+static void averageRows16(const uint16_t* a, const uint16_t* b, uint16_t* dst, size_t count) noexcept {
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	for(; i + 8 <= count; i += 8) {
+		const auto va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		const auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_avg_epu16(va, vb));
+	}
+#endif
+
+	for(; i < count; ++i) {
+		dst[i] = static_cast<uint16_t>((static_cast<uint32_t>(a[i]) + b[i] + 1) / 2);
+	}
+}
+
+static void averagePairs16(const uint16_t* src, uint16_t* dst, size_t count) noexcept {
+	//Averages consecutive pairs of samples. count refers to the output
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	//Split into even and odd samples and add them in 32 bits. There is
+	//no unsigned 32->16 pack in SSE2. Bias the values to use the signed one
+	const auto lowMask = _mm_set1_epi32(0xFFFF);
+	const auto one = _mm_set1_epi32(1);
+	const auto bias = _mm_set1_epi32(0x8000);
+	const auto unbias = _mm_set1_epi16(static_cast<short>(0x8000));
+	for(; i + 8 <= count; i += 8) {
+		const auto v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2*i));
+		const auto v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2*i + 8));
+		const auto s0 = _mm_add_epi32(_mm_and_si128(v0, lowMask), _mm_srli_epi32(v0, 16));
+		const auto s1 = _mm_add_epi32(_mm_and_si128(v1, lowMask), _mm_srli_epi32(v1, 16));
+		const auto a0 = _mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(s0, one), 1), bias);
+		const auto a1 = _mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(s1, one), 1), bias);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(_mm_packs_epi32(a0, a1), unbias));
+	}
+#endif
+
+	for(; i < count; ++i) {
+		dst[i] = static_cast<uint16_t>((static_cast<uint32_t>(src[2*i]) + src[2*i + 1] + 1) / 2);
+	}
+}
+
+
+namespace {
+
+/*
+ * Filter taps for each of the destination samples of a 1D resampling.
+ * Bilinear interpolation is used for upscaling and moderate downscaling,
+ * box filtering otherwise, so that all the source samples contribute.
+ * Every sample has the same amount of taps, so that they can be 
+ * evaluated in parallel. Unused taps have no weight. Taps are stored
+ * tap-major, so that the nth tap of consecutive samples is contiguous
+ */
+struct Taps {
+	size_t					size;		//Taps of each sample
+	size_t					length;		//Destination samples
+	std::vector<uint32_t>	count;		//Used taps of each sample, the first ones
+	std::vector<uint32_t>	indices;
+	std::vector<uint16_t>	weights;
+
+	uint32_t getIndex(size_t sample, size_t tap) const noexcept {
+		return indices[tap*length + sample];
+	}
+
+	uint16_t getWeight(size_t sample, size_t tap) const noexcept {
+		return weights[tap*length + sample];
+	}
+
+	void compute(size_t srcSize, size_t dstSize) {
+		assert(srcSize > 0);
+		const auto isBilinear = dstSize*2 > srcSize;
+
+		//Box filters span at most ceil(srcSize/dstSize) samples
+		size = isBilinear ? 2 : (srcSize + dstSize - 1) / dstSize;
+		length = dstSize;
+		count.resize(dstSize);
+		indices.resize(size*dstSize);
+		weights.resize(size*dstSize);
+
+		const auto setTaps = [this, srcSize] (size_t sample, size_t first, size_t n, auto&& getWeight) {
+			assert(n <= size);
+			count[sample] = n;
+			for(size_t j = 0; j < size; ++j) {
+				//Unused taps point to a valid sample
+				indices[j*length + sample] = std::min(first + j, srcSize - 1);
+				weights[j*length + sample] = (j < n) ? getWeight(j) : 0;
+			}
+		};
+
+		if(isBilinear) {
+			const auto scale = static_cast<double>(srcSize) / dstSize;
+			for(size_t i = 0; i < dstSize; ++i) {
+				const auto pos = std::clamp((i + 0.5)*scale - 0.5, 0.0, static_cast<double>(srcSize - 1));
+				const auto index = static_cast<size_t>(pos);
+				const auto w1 = static_cast<uint16_t>((pos - index) * WEIGHT_ONE + 0.5);
+				const auto n = (index + 1 < srcSize && w1 > 0) ? 2 : 1;
+
+				setTaps(
+					i, index, n,
+					[n, w1] (size_t j) -> uint16_t {
+						return (n == 1) ? WEIGHT_ONE : (j == 0 ? WEIGHT_ONE - w1 : w1);
+					}
+				);
+			}
+		} else {
+			for(size_t i = 0; i < dstSize; ++i) {
+				const auto begin = i*srcSize / dstSize;
+				const auto end = std::max(begin + 1, (i + 1)*srcSize / dstSize);
+				const auto n = end - begin;
+
+				setTaps(
+					i, begin, n,
+					[n] (size_t j) -> uint16_t {
+						//Distribute the remainder among the first taps
+						return WEIGHT_ONE/n + (j < WEIGHT_ONE%n ? 1 : 0);
+					}
+				);
+			}
+		}
+	}
+};
+
+}
+
+static void filterRow(const uint16_t* src, uint16_t* dst, const Taps& taps) noexcept {
+	//Evaluates the horizontal taps of a dense row
+	const size_t count = taps.length;
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	//8 samples at a time. Source samples are gathered for each tap, 
+	//as their positions are arbitrary. Same normalization as normalizeRow
+	const auto zero = _mm_setzero_si128();
+	const auto round = _mm_set1_epi32(WEIGHT_ROUND);
+	const auto bias = _mm_set1_epi32(0x8000);
+	const auto unbias = _mm_set1_epi16(static_cast<short>(0x8000));
+
+	for(; i + 8 <= count; i += 8) {
+		auto lo = zero;
+		auto hi = zero;
+
+		for(size_t j = 0; j < taps.size; ++j) {
+			const auto* index = taps.indices.data() + j*count + i;
+			const auto v = _mm_set_epi16(
+				static_cast<short>(src[index[7]]), static_cast<short>(src[index[6]]),
+				static_cast<short>(src[index[5]]), static_cast<short>(src[index[4]]),
+				static_cast<short>(src[index[3]]), static_cast<short>(src[index[2]]),
+				static_cast<short>(src[index[1]]), static_cast<short>(src[index[0]])
+			);
+			const auto w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(taps.weights.data() + j*count + i));
+
+			const auto pl = _mm_mullo_epi16(v, w);
+			const auto ph = _mm_mulhi_epu16(v, w);
+			lo = _mm_add_epi32(lo, _mm_unpacklo_epi16(pl, ph));
+			hi = _mm_add_epi32(hi, _mm_unpackhi_epi16(pl, ph));
+		}
+
+		lo = _mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(lo, round), WEIGHT_BITS), bias);
+		hi = _mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(hi, round), WEIGHT_BITS), bias);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(_mm_packs_epi32(lo, hi), unbias));
+	}
+#endif
+
+	for(; i < count; ++i) {
+		uint32_t sum = 0;
+		for(size_t j = 0; j < taps.size; ++j) {
+			sum += static_cast<uint32_t>(src[taps.getIndex(i, j)]) * taps.getWeight(i, j);
+		}
+		dst[i] = static_cast<uint16_t>(std::min<uint32_t>((sum + WEIGHT_ROUND) >> WEIGHT_BITS, 0xFFFF));
+	}
+}
+
+
+namespace {
+
+/*
+ * Resamples a channel one row at a time into dense 16 bit rows, so that
+ * they can be consumed without storing the whole resampled channel
+ */
+struct Resampler {
+	Channel					src;
+	Resolution				resolution;
+	Taps					horizontal;
+	Taps					vertical;
+	std::vector<uint16_t>	line;
+	std::vector<uint16_t>	row;
+	std::vector<uint32_t>	acc;
+
+	void setup(const Channel& channel, Resolution dst) {
+		assert(channel.resolution.x > 0 && channel.resolution.y > 0);
+		src = channel;
+		resolution = dst;
+
+		horizontal.compute(src.resolution.x, resolution.x);
+		vertical.compute(src.resolution.y, resolution.y);
+		line.resize(src.resolution.x);
+		row.resize(src.resolution.x);
+		acc.resize(src.resolution.x);
+	}
+
+	void getRow(size_t i, uint16_t* dst) noexcept {
+		//Vertical pass. Filter the source rows into a dense row. It is 
+		//the result when the width does not change
+		const size_t srcWidth = src.resolution.x;
+		const auto isScaled = srcWidth != resolution.x;
+		auto* vRow = isScaled ? row.data() : dst;
+		const auto vFirst = vertical.getIndex(i, 0);
+		const auto vCount = vertical.count[i];
+
+		if(vCount == 1) {
+			loadRow(src, vFirst, vRow);
+		} else {
+			std::fill(acc.begin(), acc.end(), 0);
+			for(size_t j = 0; j < vCount; ++j) {
+				loadRow(src, vFirst + j, line.data());
+				accumulateRow(acc.data(), line.data(), vertical.getWeight(i, j), srcWidth);
+			}
+			normalizeRow(vRow, acc.data(), srcWidth);
+		}
+
+		//Horizontal pass
+		if(isScaled) {
+			filterRow(vRow, dst, horizontal);
+		}
+	}
+};
+
+}
+
+
+
+void copyChannel(const Channel& src, const Channel& dst) noexcept {
+	assert(src.resolution == dst.resolution);
+
+	const size_t width = dst.resolution.x;
+	const size_t height = dst.resolution.y;
+	const auto isDense =
+		src.depth == dst.depth &&
+		src.step == src.depth &&
+		dst.step == dst.depth ;
+
+	if(isDense) {
+		//Copy line by line
+		for(size_t i = 0; i < height; ++i) {
+			std::memcpy(
+				dst.data + i*dst.stride,
+				src.data + i*src.stride,
+				width*dst.depth
+			);
+		}
+	} else {
+		//Copy sample by sample. Resolve the depths outside of the loop
+		if(src.depth == sizeof(uint8_t) && dst.depth == sizeof(uint8_t)) {
+			copySamples<sizeof(uint8_t), sizeof(uint8_t)>(src, dst);
+		} else if(src.depth == sizeof(uint8_t)) {
+			copySamples<sizeof(uint8_t), sizeof(uint16_t)>(src, dst);
+		} else if(dst.depth == sizeof(uint8_t)) {
+			copySamples<sizeof(uint16_t), sizeof(uint8_t)>(src, dst);
+		} else {
+			copySamples<sizeof(uint16_t), sizeof(uint16_t)>(src, dst);
+		}
+	}
+}
+
+void decimateChannel(const Channel& src, Channel half, Channel quarter) noexcept {
+	//Box filters by 2 and 4 reading the source once. The quarter is
+	//obtained from the rows of the half, which are exact box averages.
+	//Destinations which are not exactly a half/quarter of the source 
+	//are resampled on their own
+	const auto isExact = [&src] (const Channel& dst, size_t factor) -> bool {
+		return 	src.resolution.x == factor*dst.resolution.x &&
+				src.resolution.y == factor*dst.resolution.y ;
+	};
+
+	if(half && !isExact(half, 2)) {
+		resampleChannel(src, half);
+		half = Channel{};
+	}
+	if(quarter && !isExact(quarter, 4)) {
+		resampleChannel(src, quarter);
+		quarter = Channel{};
+	}
+	if(!half && !quarter) {
+		return;
+	}
+
+	const size_t halfWidth = half ? half.resolution.x : 2*quarter.resolution.x;
+	const size_t halfHeight = half ? half.resolution.y : 2*quarter.resolution.y;
+	const size_t quarterWidth = quarter ? quarter.resolution.x : 0;
+	const size_t quarterHeight = quarter ? quarter.resolution.y : 0;
+
+	//Reuse the scratch buffers between calls
+	thread_local std::vector<uint16_t> rows[2];
+	thread_local std::vector<uint16_t> vertical;
+	thread_local std::vector<uint16_t> halfRows[2];
+	thread_local std::vector<uint16_t> quarterRow;
+
+	rows[0].resize(src.resolution.x);
+	rows[1].resize(src.resolution.x);
+	vertical.resize(src.resolution.x);
+	halfRows[0].resize(halfWidth);
+	halfRows[1].resize(halfWidth);
+	quarterRow.resize(quarterWidth);
+
+	for(size_t i = 0; i < halfHeight; ++i) {
+		auto& halfRow = halfRows[i % 2];
+
+		//Box filter 2x2
+		loadRow(src, 2*i + 0, rows[0].data());
+		loadRow(src, 2*i + 1, rows[1].data());
+		averageRows16(rows[0].data(), rows[1].data(), vertical.data(), 2*halfWidth);
+		averagePairs16(vertical.data(), halfRow.data(), halfWidth);
+
+		if(half) {
+			storeRow(half, i, halfRow.data());
+		}
+
+		//Every 2 rows of the half, a row of the quarter can be produced
+		if(quarter && (i % 2) == 1 && i / 2 < quarterHeight) {
+			averageRows16(halfRows[0].data(), halfRows[1].data(), vertical.data(), 2*quarterWidth);
+			averagePairs16(vertical.data(), quarterRow.data(), quarterWidth);
+			storeRow(quarter, i / 2, quarterRow.data());
+		}
+	}
+}
+
+void fillChannel(const Channel& dst, uint16_t value) noexcept {
+	const size_t width = dst.resolution.x;
+	const size_t height = dst.resolution.y;
+
+	for(size_t i = 0; i < height; ++i) {
+		auto* ptr = dst.data + i*dst.stride;
+
+		if(dst.depth == sizeof(uint8_t) && dst.step == sizeof(uint8_t)) {
+			std::memset(ptr, value >> 8, width);
+		} else {
+			for(size_t j = 0; j < width; ++j) {
+				storeSample(ptr, dst.depth, value);
+				ptr += dst.step;
+			}
+		}
+	}
+}
+
+void resampleChannel(const Channel& src, const Channel& dst) noexcept {
+	if(src.resolution == dst.resolution) {
+		copyChannel(src, dst);
+		return;
+	}
+
+	const size_t srcWidth = src.resolution.x;
+	const size_t dstWidth = dst.resolution.x;
+	const size_t dstHeight = dst.resolution.y;
+	if(srcWidth == 0 || src.resolution.y == 0 || dstWidth == 0 || dstHeight == 0) {
+		return;
+	}
+
+	//Reuse the scratch buffers between calls
+	thread_local Resampler resampler;
+	thread_local std::vector<uint16_t> row;
+
+	resampler.setup(src, dst.resolution);
+	row.resize(dstWidth);
+
+	for(size_t i = 0; i < dstHeight; ++i) {
+		resampler.getRow(i, row.data());
+		storeRow(dst, i, row.data());
+	}
+}
+
+
+
+/*
+ * Deinterlacing. Rows are processed as a whole, regardless of the 
+ * channels they contain, as all the operations are element-wise
+ */
+
+static inline uint32_t loadRaw(const std::byte* ptr, size_t depth) noexcept {
+	//Unlike loadSample, the value is not expanded to 16 bits
+	return (depth == sizeof(uint8_t)) ? std::to_integer<uint32_t>(*ptr) : loadSample(ptr, depth);
+}
+
+static inline void storeRaw(std::byte* ptr, size_t depth, uint32_t value) noexcept {
+	if(depth == sizeof(uint8_t)) {
+		*ptr = static_cast<std::byte>(value);
+	} else {
+		storeSample(ptr, depth, static_cast<uint16_t>(value));
+	}
+}
+
+static void averageRows(const std::byte* above, 
+						const std::byte* below, 
+						std::byte* dst, 
+						size_t width, 
+						size_t depth ) noexcept
+{
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	for(; i + 16 <= width; i += 16) {
+		const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + i));
+		const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + i));
+		const auto avg = (depth == sizeof(uint8_t)) ? _mm_avg_epu8(a, b) : _mm_avg_epu16(a, b);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), avg);
+	}
+#endif
+
+	for(; i < width; i += depth) {
+		const uint32_t a = loadRaw(above + i, depth);
+		const uint32_t b = loadRaw(below + i, depth);
+		storeRaw(dst + i, depth, (a + b + 1) / 2);
+	}
+}
+
+static void adaptiveRow(const std::byte* cur,
+						const std::byte* prev,
+						const std::byte* above, 
+						const std::byte* below, 
+						std::byte* dst, 
+						size_t width, 
+						size_t depth,
+						uint8_t threshold ) noexcept
+{
+	//Static samples are weaved, moving ones are interpolated
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	const auto zero = _mm_setzero_si128();
+	if(depth == sizeof(uint8_t)) {
+		const auto thr = _mm_set1_epi8(static_cast<char>(threshold));
+		for(; i + 16 <= width; i += 16) {
+			const auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + i));
+			const auto p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i));
+			const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + i));
+			const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + i));
+
+			const auto diff = _mm_or_si128(_mm_subs_epu8(c, p), _mm_subs_epu8(p, c));
+			const auto isStatic = _mm_cmpeq_epi8(_mm_subs_epu8(diff, thr), zero);
+			const auto result = _mm_or_si128(_mm_and_si128(isStatic, c), _mm_andnot_si128(isStatic, _mm_avg_epu8(a, b)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), result);
+		}
+	} else {
+		const auto thr = _mm_set1_epi16(static_cast<short>(threshold << 8));
+		for(; i + 16 <= width; i += 16) {
+			const auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + i));
+			const auto p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i));
+			const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + i));
+			const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + i));
+
+			const auto diff = _mm_or_si128(_mm_subs_epu16(c, p), _mm_subs_epu16(p, c));
+			const auto isStatic = _mm_cmpeq_epi16(_mm_subs_epu16(diff, thr), zero);
+			const auto result = _mm_or_si128(_mm_and_si128(isStatic, c), _mm_andnot_si128(isStatic, _mm_avg_epu16(a, b)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), result);
+		}
+	}
+#endif
+
+	const uint32_t thr = (depth == sizeof(uint8_t)) ? threshold : (static_cast<uint32_t>(threshold) << 8);
+	for(; i < width; i += depth) {
+		const uint32_t c = loadRaw(cur + i, depth);
+		const uint32_t p = loadRaw(prev + i, depth);
+		const uint32_t diff = (c > p) ? c - p : p - c;
+
+		if(diff <= thr) {
+			storeRaw(dst + i, depth, c);
+		} else {
+			const uint32_t a = loadRaw(above + i, depth);
+			const uint32_t b = loadRaw(below + i, depth);
+			storeRaw(dst + i, depth, (a + b + 1) / 2);
+		}
+	}
+}
+
+template<typename F>
+static void deinterlaceRows(const Plane& src, const Plane& dst, size_t field, size_t first, F&& interpolate) noexcept {
+	//Only the rows of the source starting at first are written
+	assert(src.width == dst.width && first + dst.height <= src.height);
+	assert(field < 2);
+
+	for(size_t i = 0; i < dst.height; ++i) {
+		const auto row = first + i;
+		auto* dstRow = dst.data + i*dst.stride;
+
+		if((row & 1) == field || src.height < 2) {
+			//Row belongs to the field. Keep it
+			std::memcpy(dstRow, src.data + row*src.stride, dst.width);
+		} else {
+			//Row belongs to the other field. Use the neighbours, mirroring on the edges
+			const auto above = (row > 0) ? row - 1 : row + 1;
+			const auto below = (row + 1 < src.height) ? row + 1 : row - 1;
+			interpolate(row, src.data + above*src.stride, src.data + below*src.stride, dstRow);
+		}
+	}
+}
+
+void bobPlane(const Plane& src, const Plane& dst, size_t field, size_t first) noexcept {
+	deinterlaceRows(
+		src, dst, field, first,
+		[&dst] (size_t, const std::byte* above, const std::byte* below, std::byte* dstRow) {
+			averageRows(above, below, dstRow, dst.width, dst.depth);
+		}
+	);
+}
+
+void motionAdaptivePlane(	const Plane& src, 
+							const Plane& prev, 
+							const Plane& dst, 
+							size_t field,
+							size_t first,
+							uint8_t threshold ) noexcept
+{
+	assert(prev.width == src.width && prev.height == src.height);
+
+	deinterlaceRows(
+		src, dst, field, first,
+		[&src, &prev, &dst, threshold] (size_t row, const std::byte* above, const std::byte* below, std::byte* dstRow) {
+			adaptiveRow(
+				src.data + row*src.stride,
+				prev.data + row*prev.stride,
+				above, below, dstRow, 
+				dst.width, dst.depth,
+				threshold
+			);
+		}
+	);
+}
+
+
+
+/*
+ * Temporal blending. Weights are expressed in Q16
+ */
+
+static void blendRow(	const std::byte* a, 
+						const std::byte* b, 
+						std::byte* dst, 
+						size_t width, 
+						size_t depth,
+						uint32_t weight ) noexcept
+{
+	size_t i = 0;
+
+	if(depth == sizeof(uint8_t)) {
+		//Q8 is enough. Products fit in 16 bits
+		const uint32_t wb = (weight + 0x80) >> 8;
+		const uint32_t wa = 0x100 - wb;
+
+#if defined(__SSE2__)
+		const auto zero = _mm_setzero_si128();
+		const auto vwa = _mm_set1_epi16(static_cast<int16_t>(wa));
+		const auto vwb = _mm_set1_epi16(static_cast<int16_t>(wb));
+		const auto round = _mm_set1_epi16(0x80);
+
+		const auto blend = [&] (__m128i x, __m128i y) -> __m128i {
+			const auto sum = _mm_add_epi16(_mm_mullo_epi16(x, vwa), _mm_mullo_epi16(y, vwb));
+			return _mm_srli_epi16(_mm_add_epi16(sum, round), 8);
+		};
+
+		for(; i + 16 <= width; i += 16) {
+			const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+			const auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+			const auto lo = blend(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(y, zero));
+			const auto hi = blend(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(y, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+		}
+#endif
+
+		for(; i < width; ++i) {
+			const auto x = std::to_integer<uint32_t>(a[i]);
+			const auto y = std::to_integer<uint32_t>(b[i]);
+			dst[i] = static_cast<std::byte>((x*wa + y*wb + 0x80) >> 8);
+		}
+
+	} else {
+		//Q16 with 32 bit products
+		const uint32_t wb = std::min(weight, 0xFFFFU);
+		const uint32_t wa = 0x10000 - wb;
+
+#if defined(__SSE2__)
+		//Weights are split so that they fit in 16 bits: w = hi*2 + lo
+		const auto vwa = _mm_set1_epi16(static_cast<int16_t>(wa >> 1));
+		const auto vwb = _mm_set1_epi16(static_cast<int16_t>(wb >> 1));
+		const auto vwaLo = _mm_set1_epi32(wa & 1);
+		const auto vwbLo = _mm_set1_epi32(wb & 1);
+		const auto round = _mm_set1_epi32(0x8000);
+		const auto bias = _mm_set1_epi16(-0x8000);
+
+		const auto product = [] (__m128i x, __m128i w, __m128i& lo, __m128i& hi) {
+			const auto l = _mm_mullo_epi16(x, w);
+			const auto h = _mm_mulhi_epu16(x, w);
+			lo = _mm_unpacklo_epi16(l, h);
+			hi = _mm_unpackhi_epi16(l, h);
+		};
+
+		const auto zero = _mm_setzero_si128();
+		for(; i + 16 <= width; i += 16) {
+			const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+			const auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+
+			//x*wa + y*wb = 2*(x*(wa>>1) + y*(wb>>1)) + x*(wa&1) + y*(wb&1)
+			__m128i xLo, xHi, yLo, yHi;
+			product(x, vwa, xLo, xHi);
+			product(y, vwb, yLo, yHi);
+
+			const auto x32Lo = _mm_unpacklo_epi16(x, zero);
+			const auto x32Hi = _mm_unpackhi_epi16(x, zero);
+			const auto y32Lo = _mm_unpacklo_epi16(y, zero);
+			const auto y32Hi = _mm_unpackhi_epi16(y, zero);
+
+			auto lo = _mm_slli_epi32(_mm_add_epi32(xLo, yLo), 1);
+			auto hi = _mm_slli_epi32(_mm_add_epi32(xHi, yHi), 1);
+			lo = _mm_add_epi32(lo, _mm_add_epi32(_mm_and_si128(x32Lo, _mm_sub_epi32(zero, vwaLo)), _mm_and_si128(y32Lo, _mm_sub_epi32(zero, vwbLo))));
+			hi = _mm_add_epi32(hi, _mm_add_epi32(_mm_and_si128(x32Hi, _mm_sub_epi32(zero, vwaLo)), _mm_and_si128(y32Hi, _mm_sub_epi32(zero, vwbLo))));
+
+			//Round, normalize and bias for the signed pack
+			lo = _mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(lo, round), 16), round);
+			hi = _mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(hi, round), 16), round);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(_mm_packs_epi32(lo, hi), bias));
+		}
+#endif
+
+		for(; i < width; i += depth) {
+			const auto x = loadRaw(a + i, depth);
+			const auto y = loadRaw(b + i, depth);
+			storeRaw(dst + i, depth, (x*wa + y*wb + 0x8000) >> 16);
+		}
+
+	}
+}
+
+void blendPlane(const Plane& a, 
+				const Plane& b, 
+				const Plane& dst, 
+				uint32_t weight ) noexcept
+{
+	assert(a.width == dst.width && a.height == dst.height && a.depth == dst.depth);
+	assert(b.width == dst.width && b.height == dst.height && b.depth == dst.depth);
+	assert(weight <= (1U << 16));
+
+	for(size_t i = 0; i < dst.height; ++i) {
+		blendRow(
+			a.data + i*a.stride,
+			b.data + i*b.stride,
+			dst.data + i*dst.stride,
+			dst.width, dst.depth,
+			weight
+		);
+	}
+}
+
+
+YCbCrMatrix getYCbCrMatrix(ColorModel model, ColorRange range) noexcept {
+	//Luma weights of each model
+	double kr, kb;
+	switch(model) {
+	case ColorModel::bt601:		kr = 0.299;		kb = 0.114;		break;
+	case ColorModel::bt2020:	kr = 0.2627;	kb = 0.0593;	break;
+	default:					kr = 0.2126;	kb = 0.0722;	break; //BT.709
+	}
+	const auto kg = 1.0 - kr - kb;
+
+	//Limited range expands [16, 235] and [16, 240] to [0, 255]
+	const auto isFull = range == ColorRange::full;
+	const auto yScale = isFull ? 1.0 : 255.0 / 219.0;
+	const auto cScale = isFull ? 1.0 : 255.0 / 224.0;
+
+	const auto toFixed = [] (double x) -> int16_t {
+		return static_cast<int16_t>(std::lround(x * (1 << 13)));
+	};
+
+	YCbCrMatrix result;
+	result.y = toFixed(yScale);
+	result.crR = toFixed(2.0*(1.0 - kr) * cScale);
+	result.cbG = toFixed(-2.0*kb*(1.0 - kb)/kg * cScale);
+	result.crG = toFixed(-2.0*kr*(1.0 - kr)/kg * cScale);
+	result.cbB = toFixed(2.0*(1.0 - kb) * cScale);
+	result.yOffset = isFull ? 0 : (16 << 4);
+	return result;
+}
+
+template<bool isSubsampled>
+static void convertRowToRGBA(	const uint16_t* y, 
+								const uint16_t* cb, 
+								const uint16_t* cr, 
+								const uint16_t* a,
+								std::byte* dst,
+								size_t count,
+								bool bgra,
+								const YCbCrMatrix& m ) noexcept
+{
+	//Samples are reduced to 12 bits so that products fit in 32 bits.
+	//Results are in Q17 (12 bit input, Q13 coefficients). Horizontally
+	//subsampled chroma rows have half of the samples, plus a copy of 
+	//the last one. Co-sited samples are duplicated, the ones in between
+	//are averaged
+	constexpr int32_t CHROMA_OFFSET = 1 << 11;
+	constexpr int32_t SHIFT = 17;
+	constexpr int32_t ROUND = 1 << (SHIFT - 1);
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	const auto pair = [] (int16_t lo, int16_t hi) -> __m128i {
+		return _mm_set1_epi32(static_cast<int32_t>(static_cast<uint32_t>(static_cast<uint16_t>(hi)) << 16 | static_cast<uint16_t>(lo)));
+	};
+
+	const auto yOffset = _mm_set1_epi16(m.yOffset);
+	const auto cOffset = _mm_set1_epi16(CHROMA_OFFSET);
+	const auto round = _mm_set1_epi32(ROUND);
+	const auto zero = _mm_setzero_si128();
+	const auto opaque = _mm_set1_epi8(static_cast<char>(0xFF));
+	const auto kYCrR = pair(m.y, m.crR);
+	const auto kYCbG = pair(m.y, m.cbG);
+	const auto kCrG = pair(m.crG, 0);
+	const auto kYCbB = pair(m.y, m.cbB);
+
+	const auto loadChroma = [] (const uint16_t* c, size_t i) -> __m128i {
+		if(isSubsampled) {
+			const auto even = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(c + i/2));
+			const auto next = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(c + i/2 + 1));
+			return _mm_unpacklo_epi16(even, _mm_avg_epu16(even, next));
+		} else {
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + i));
+		}
+	};
+
+	const auto finish = [round] (__m128i lo, __m128i hi) -> __m128i {
+		lo = _mm_srai_epi32(_mm_add_epi32(lo, round), SHIFT);
+		hi = _mm_srai_epi32(_mm_add_epi32(hi, round), SHIFT);
+		const auto packed = _mm_packs_epi32(lo, hi);
+		return _mm_packus_epi16(packed, packed); //8 samples in the low half
+	};
+
+	for(; i + 8 <= count; i += 8) {
+		const auto yv = _mm_sub_epi16(_mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i)), 4), yOffset);
+		const auto cbv = _mm_sub_epi16(_mm_srli_epi16(loadChroma(cb, i), 4), cOffset);
+		const auto crv = _mm_sub_epi16(_mm_srli_epi16(loadChroma(cr, i), 4), cOffset);
+
+		const auto yCrLo = _mm_unpacklo_epi16(yv, crv);
+		const auto yCrHi = _mm_unpackhi_epi16(yv, crv);
+		const auto yCbLo = _mm_unpacklo_epi16(yv, cbv);
+		const auto yCbHi = _mm_unpackhi_epi16(yv, cbv);
+		const auto crLo = _mm_unpacklo_epi16(crv, zero);
+		const auto crHi = _mm_unpackhi_epi16(crv, zero);
+
+		const auto r = finish(_mm_madd_epi16(yCrLo, kYCrR), _mm_madd_epi16(yCrHi, kYCrR));
+		const auto g = finish(
+			_mm_add_epi32(_mm_madd_epi16(yCbLo, kYCbG), _mm_madd_epi16(crLo, kCrG)),
+			_mm_add_epi32(_mm_madd_epi16(yCbHi, kYCbG), _mm_madd_epi16(crHi, kCrG))
+		);
+		const auto b = finish(_mm_madd_epi16(yCbLo, kYCbB), _mm_madd_epi16(yCbHi, kYCbB));
+
+		__m128i alpha = opaque;
+		if(a) {
+			const auto av = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)), 8);
+			alpha = _mm_packus_epi16(av, av);
+		}
+
+		//Interleave as RGBA or BGRA
+		const auto first = bgra ? b : r;
+		const auto third = bgra ? r : b;
+		const auto fg = _mm_unpacklo_epi8(first, g);
+		const auto ta = _mm_unpacklo_epi8(third, alpha);
+		auto* ptr = reinterpret_cast<__m128i*>(dst + 4*i);
+		_mm_storeu_si128(ptr + 0, _mm_unpacklo_epi16(fg, ta));
+		_mm_storeu_si128(ptr + 1, _mm_unpackhi_epi16(fg, ta));
+	}
+#endif
+
+	const auto clamp = [] (int32_t x) -> std::byte {
+		return static_cast<std::byte>(std::clamp((x + ROUND) >> SHIFT, 0, 255));
+	};
+
+	const auto getChroma = [] (const uint16_t* c, size_t i) -> int32_t {
+		if(isSubsampled) {
+			const uint32_t even = c[i/2];
+			return (i & 1) ? (even + c[i/2 + 1] + 1) / 2 : even;
+		} else {
+			return c[i];
+		}
+	};
+
+	for(; i < count; ++i) {
+		const int32_t yv = (y[i] >> 4) - m.yOffset;
+		const int32_t cbv = (getChroma(cb, i) >> 4) - CHROMA_OFFSET;
+		const int32_t crv = (getChroma(cr, i) >> 4) - CHROMA_OFFSET;
+
+		const auto r = clamp(yv*m.y + crv*m.crR);
+		const auto g = clamp(yv*m.y + cbv*m.cbG + crv*m.crG);
+		const auto b = clamp(yv*m.y + cbv*m.cbB);
+
+		auto* ptr = dst + 4*i;
+		ptr[0] = bgra ? b : r;
+		ptr[1] = g;
+		ptr[2] = bgra ? r : b;
+		ptr[3] = a ? static_cast<std::byte>(a[i] >> 8) : std::byte(0xFF);
+	}
+}
+
+void convertChannelsToRGBA(	const Channel& y, 
+							const Channel& cb, 
+							const Channel& cr, 
+							const Channel& a,
+							const Channel& dst,
+							bool bgra,
+							const YCbCrMatrix& matrix ) noexcept
+{
+	assert(dst.step == 4 && dst.depth == sizeof(uint8_t));
+
+	const size_t width = dst.resolution.x;
+	const size_t height = dst.resolution.y;
+	if(width == 0 || height == 0 || cb.resolution.x == 0 || cb.resolution.y == 0) {
+		return;
+	}
+
+	//Channels are resampled to the destination one row at a time. Chroma
+	//keeps its subsampling, which is undone when converting. Vertically,
+	//chroma rows are shared by the luma rows they belong to
+	assert(y && cb && cr);
+	const auto isSubsampledX = cb.resolution.x < y.resolution.x;
+	const auto isSubsampledY = cb.resolution.y < y.resolution.y;
+	const Resolution chromaResolution(
+		isSubsampledX ? std::max<size_t>(width / 2, 1) : width,
+		isSubsampledY ? std::max<size_t>(height / 2, 1) : height
+	);
+
+	//Reuse the scratch buffers between calls
+	thread_local std::array<Resampler, 4> resamplers;
+	thread_local std::array<std::vector<uint16_t>, 4> rows;
+	const std::array<const Channel*, 4> channels = { &y, &cb, &cr, &a };
+
+	for(size_t i = 0; i < channels.size(); ++i) {
+		if(*channels[i]) {
+			const auto isChroma = channels[i] == &cb || channels[i] == &cr;
+			const auto resolution = isChroma ? chromaResolution : dst.resolution;
+			resamplers[i].setup(*channels[i], resolution);
+			rows[i].resize(resolution.x + 1); //Room for the copy of the last sample
+		}
+	}
+
+	size_t chromaRow = chromaResolution.y;
+	for(size_t i = 0; i < height; ++i) {
+		resamplers[0].getRow(i, rows[0].data());
+		if(a) {
+			resamplers[3].getRow(i, rows[3].data());
+		}
+
+		const auto nextChromaRow = std::min<size_t>(isSubsampledY ? i / 2 : i, chromaResolution.y - 1);
+		if(nextChromaRow != chromaRow) {
+			chromaRow = nextChromaRow;
+			for(size_t j = 1; j < 3; ++j) {
+				resamplers[j].getRow(chromaRow, rows[j].data());
+				rows[j][chromaResolution.x] = rows[j][chromaResolution.x - 1];
+			}
+		}
+
+		const auto convert = isSubsampledX ? convertRowToRGBA<true> : convertRowToRGBA<false>;
+		convert(
+			rows[0].data(),
+			rows[1].data(),
+			rows[2].data(),
+			a ? rows[3].data() : nullptr,
+			dst.data + i*dst.stride,
+			width,
+			bgra,
+			matrix
+		);
+	}
+}
+
+
+/*
+ * Alpha premultiplication. Color samples are scaled towards their
+ * black level (offset), so that they remain premultiplied once 
+ * converted to RGB. Alpha samples have the same depth as color
+ */
+
+static inline uint32_t premultiplySample(	uint32_t value, 
+											uint32_t alpha, 
+											uint32_t offset, 
+											size_t depth ) noexcept
+{
+	//(value*alpha + offset*(max-alpha)) / max, rounded. Division by 
+	//2^n-1 is done as in the SIMD version
+	const uint32_t shift = 8*depth;
+	const uint32_t max = (1U << shift) - 1;
+	const uint32_t x = value*alpha + offset*(max - alpha) + (1U << (shift-1));
+	return (x + (x >> shift)) >> shift;
+}
+
+void premultiplyRow(const std::byte* src, 
+					const std::byte* alpha, 
+					std::byte* dst, 
+					size_t count, 
+					size_t depth, 
+					uint16_t offset ) noexcept
+{
+	const size_t width = count*depth;
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	if(depth == sizeof(uint8_t)) {
+		const auto zero = _mm_setzero_si128();
+		const auto max = _mm_set1_epi16(0xFF);
+		const auto off = _mm_set1_epi16(static_cast<int16_t>(offset));
+		const auto round = _mm_set1_epi16(0x80);
+
+		const auto premultiply = [&] (__m128i v, __m128i a) -> __m128i {
+			//Products fit in 16 bits, as weights add up to 255
+			auto x = _mm_add_epi16(_mm_mullo_epi16(v, a), _mm_mullo_epi16(off, _mm_sub_epi16(max, a)));
+			x = _mm_add_epi16(x, round);
+			return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+		};
+
+		for(; i + 16 <= width; i += 16) {
+			const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(alpha + i));
+			const auto lo = premultiply(_mm_unpacklo_epi8(v, zero), _mm_unpacklo_epi8(a, zero));
+			const auto hi = premultiply(_mm_unpackhi_epi8(v, zero), _mm_unpackhi_epi8(a, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+		}
+	} else {
+		const auto max = _mm_set1_epi16(-1);
+		const auto off = _mm_set1_epi16(static_cast<int16_t>(offset));
+		const auto round = _mm_set1_epi32(0x8000);
+		const auto bias = _mm_set1_epi16(-0x8000);
+
+		const auto multiply = [] (__m128i a, __m128i b, __m128i& lo, __m128i& hi) {
+			//Full 32 bit products
+			const auto l = _mm_mullo_epi16(a, b);
+			const auto h = _mm_mulhi_epu16(a, b);
+			lo = _mm_unpacklo_epi16(l, h);
+			hi = _mm_unpackhi_epi16(l, h);
+		};
+
+		const auto normalize = [round] (__m128i x) -> __m128i {
+			x = _mm_add_epi32(x, round);
+			x = _mm_srli_epi32(_mm_add_epi32(x, _mm_srli_epi32(x, 16)), 16);
+			return _mm_sub_epi32(x, round); //Bias for the signed pack
+		};
+
+		for(; i + 16 <= width; i += 16) {
+			const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(alpha + i));
+
+			__m128i vLo, vHi, oLo, oHi;
+			multiply(v, a, vLo, vHi);
+			multiply(off, _mm_xor_si128(a, max), oLo, oHi);
+
+			const auto lo = normalize(_mm_add_epi32(vLo, oLo));
+			const auto hi = normalize(_mm_add_epi32(vHi, oHi));
+			const auto result = _mm_xor_si128(_mm_packs_epi32(lo, hi), bias);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), result);
+		}
+	}
+#endif
+
+	for(; i < width; i += depth) {
+		const auto value = loadRaw(src + i, depth);
+		const auto a = loadRaw(alpha + i, depth);
+		storeRaw(dst + i, depth, premultiplySample(value, a, offset, depth));
+	}
+}
+
+void premultiplyChromaRow(	const std::byte* src, 
+							const std::byte* alpha, 
+							std::byte* dst, 
+							size_t count, 
+							size_t depth, 
+							uint16_t offset ) noexcept
+{
+	//Both components of a CbCr pair are scaled by the average alpha of
+	//the two pixels they belong to
+	assert(count % 2 == 0);
+	thread_local std::vector<std::byte> pairAlpha;
+	const size_t width = count*depth;
+	pairAlpha.resize(width);
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	if(depth == sizeof(uint8_t)) {
+		const auto mask = _mm_set1_epi16(0x00FF);
+		const auto one = _mm_set1_epi16(1);
+		for(; i + 16 <= width; i += 16) {
+			const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(alpha + i));
+			const auto sum = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a, mask), _mm_srli_epi16(a, 8)), one);
+			const auto avg = _mm_srli_epi16(sum, 1);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pairAlpha.data() + i), _mm_or_si128(avg, _mm_slli_epi16(avg, 8)));
+		}
+	} else {
+		const auto mask = _mm_set1_epi32(0xFFFF);
+		const auto one = _mm_set1_epi32(1);
+		for(; i + 16 <= width; i += 16) {
+			const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(alpha + i));
+			const auto sum = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(a, mask), _mm_srli_epi32(a, 16)), one);
+			const auto avg = _mm_srli_epi32(sum, 1);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pairAlpha.data() + i), _mm_or_si128(avg, _mm_slli_epi32(avg, 16)));
+		}
+	}
+#endif
+
+	for(; i < width; i += 2*depth) {
+		const auto a0 = loadRaw(alpha + i, depth);
+		const auto a1 = loadRaw(alpha + i + depth, depth);
+		const auto avg = (a0 + a1 + 1) / 2;
+		storeRaw(pairAlpha.data() + i, depth, avg);
+		storeRaw(pairAlpha.data() + i + depth, depth, avg);
+	}
+
+	premultiplyRow(src, pairAlpha.data(), dst, count, depth, offset);
+}
+
+void premultiplyRGBARow(const std::byte* src, std::byte* dst, size_t count) noexcept {
+	//Alpha is the last component for both RGBA and BGRA
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	const auto zero = _mm_setzero_si128();
+	const auto round = _mm_set1_epi16(0x80);
+	const auto alphaMask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+
+	const auto premultiply = [&] (__m128i v) -> __m128i {
+		//Broadcast the alpha of each of the 2 pixels
+		const auto a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xFF), 0xFF);
+		auto x = _mm_add_epi16(_mm_mullo_epi16(v, a), round);
+		x = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+		return _mm_or_si128(_mm_andnot_si128(alphaMask, x), _mm_and_si128(alphaMask, v));
+	};
+
+	for(; i + 4 <= count; i += 4) {
+		const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4*i));
+		const auto lo = premultiply(_mm_unpacklo_epi8(v, zero));
+		const auto hi = premultiply(_mm_unpackhi_epi8(v, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4*i), _mm_packus_epi16(lo, hi));
+	}
+#endif
+
+	for(; i < count; ++i) {
+		const auto* srcPixel = src + 4*i;
+		auto* dstPixel = dst + 4*i;
+		const auto a = std::to_integer<uint32_t>(srcPixel[3]);
+		for(size_t j = 0; j < 3; ++j) {
+			const auto value = std::to_integer<uint32_t>(srcPixel[j]);
+			dstPixel[j] = static_cast<std::byte>(premultiplySample(value, a, 0, sizeof(uint8_t)));
+		}
+		dstPixel[3] = srcPixel[3];
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Channels.h"
+
+#include <cstdint>
+
+namespace Zuazo::NDI {
+
+void copyChannel(const Channel& src, const Channel& dst) noexcept;
+void fillChannel(const Channel& dst, uint16_t value) noexcept;
+void resampleChannel(const Channel& src, const Channel& dst) noexcept;
+void decimateChannel(const Channel& src, Channel half, Channel quarter) noexcept;
+
+void bobPlane(const Plane& src, const Plane& dst, size_t field, size_t first) noexcept;
+void motionAdaptivePlane(	const Plane& src, 
+							const Plane& prev, 
+							const Plane& dst, 
+							size_t field,
+							size_t first,
+							uint8_t threshold ) noexcept;
+void blendPlane(const Plane& a, 
+				const Plane& b, 
+				const Plane& dst, 
+				uint32_t weight ) noexcept;
+
+/*
+ * YCbCr to RGB matrix in fixed point. Coefficients are expressed in Q13,
+ * offsets in 12 bits
+ */
+struct YCbCrMatrix {
+	int16_t									y;
+	int16_t									crR;
+	int16_t									cbG;
+	int16_t									crG;
+	int16_t									cbB;
+	int16_t									yOffset;
+};
+
+YCbCrMatrix getYCbCrMatrix(ColorModel model, ColorRange range) noexcept;
+void convertChannelsToRGBA(	const Channel& y, 
+							const Channel& cb, 
+							const Channel& cr, 
+							const Channel& a,
+							const Channel& dst,
+							bool bgra,
+							const YCbCrMatrix& matrix ) noexcept;
+
+void premultiplyRow(const std::byte* src, 
+					const std::byte* alpha, 
+					std::byte* dst, 
+					size_t count, 
+					size_t depth, 
+					uint16_t offset ) noexcept;
+void premultiplyChromaRow(	const std::byte* src, 
+							const std::byte* alpha, 
+							std::byte* dst, 
+							size_t count, 
+							size_t depth, 
+							uint16_t offset ) noexcept;
+void premultiplyRGBARow(const std::byte* src, std::byte* dst, size_t count) noexcept;
+
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include <zuazo/NDI/LatencyHistogram.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace Zuazo::NDI {
+
+LatencyHistogram::LatencyHistogram()
+	: m_count(0)
+	, m_max(0)
+{
+	for(auto& bucket : m_buckets) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+}
+
+
+
+void LatencyHistogram::record(Duration duration) noexcept {
+	//Relaxed ordering is enough, as buckets are independent counters
+	constexpr uint64_t maxValue = (uint64_t(1) << MAX_BITS) - 1;
+	const auto value = std::min(static_cast<uint64_t>(std::max(duration.count(), Duration::rep(0))), maxValue);
+
+	m_buckets[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+
+	auto max = m_max.load(std::memory_order_relaxed);
+	while(value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed));
+}
+
+void LatencyHistogram::reset() noexcept {
+	for(auto& bucket : m_buckets) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	m_count.store(0, std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+
+
+uint64_t LatencyHistogram::getCount() const noexcept {
+	return m_count.load(std::memory_order_relaxed);
+}
+
+LatencyHistogram::Duration LatencyHistogram::getPercentile(double percentile) const noexcept {
+	//Buckets may be written meanwhile, so the total is
+	//computed from the same values that are walked
+	std::array<uint64_t, BUCKET_COUNT> buckets;
+	uint64_t total = 0;
+	for(size_t i = 0; i < BUCKET_COUNT; ++i) {
+		buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+		total += buckets[i];
+	}
+
+	if(total == 0) {
+		return Duration(0);
+	}
+
+	//Rank of the requested sample, 1 based
+	const auto rank = std::max(
+		static_cast<uint64_t>(std::clamp(percentile, 0.0, 100.0) / 100.0 * total + 0.5),
+		uint64_t(1)
+	);
+
+	uint64_t accumulated = 0;
+	for(size_t i = 0; i < BUCKET_COUNT; ++i) {
+		accumulated += buckets[i];
+		if(accumulated >= rank) {
+			//Never report more than the actual maximum
+			return Duration(std::min(getBucketValue(i), m_max.load(std::memory_order_relaxed)));
+		}
+	}
+
+	return getMax();
+}
+
+LatencyHistogram::Duration LatencyHistogram::getMax() const noexcept {
+	return Duration(m_max.load(std::memory_order_relaxed));
+}
+
+LatencyHistogram::Summary LatencyHistogram::getSummary() const noexcept {
+	return Summary {
+		getCount(),
+		getPercentile(50.0),
+		getPercentile(90.0),
+		getPercentile(99.0),
+		getMax()
+	};
+}
+
+
+
+size_t LatencyHistogram::getBucketIndex(uint64_t value) noexcept {
+	//Small values are stored as they are. Otherwise, keep the
+	//SUB_BUCKET_BITS most significant bits of the value
+	if(value < SUB_BUCKET_COUNT) {
+		return value;
+	}
+
+	const size_t msb = 63 - __builtin_clzll(value);
+	const size_t shift = msb - SUB_BUCKET_BITS;
+	const auto index = (shift + 1) * SUB_BUCKET_COUNT + ((value >> shift) - SUB_BUCKET_COUNT);
+	assert(index < BUCKET_COUNT);
+	return index;
+}
+
+uint64_t LatencyHistogram::getBucketValue(size_t index) noexcept {
+	//Highest value of the bucket
+	if(index < SUB_BUCKET_COUNT) {
+		return index;
+	}
+
+	const size_t shift = index / SUB_BUCKET_COUNT - 1;
+	const uint64_t mantissa = SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT;
+	return ((mantissa + 1) << shift) - 1;
+}
+
+}
\ No newline at end of file
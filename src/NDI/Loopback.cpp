@@ -0,0 +1,775 @@
+#include <zuazo/NDI/Loopback.h>
+
+#include <zuazo/NDI/Source.h>
+
+#include "Channels.h"
+
+#include <cstddef>
+#include "../Processing.NDI/Processing.NDI.Lib.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Zuazo::NDI {
+
+using LoopbackClock = std::chrono::steady_clock;
+using LoopbackDuration = std::chrono::duration<int64_t, std::ratio<1, 10000000>>; //100ns units, as NDI
+
+static constexpr size_t LOOPBACK_MAX_SPARE_BUFFERS = 4;
+static constexpr auto LOOPBACK_MAX_DELAY = std::chrono::seconds(1);
+
+using LoopbackSenderRef = std::shared_ptr<const Loopback::Sender>;
+
+/*
+ * Virtual senders. Entries are immutable, so that receivers can
+ * keep using them after being removed
+ */
+struct LoopbackRegistry {
+	std::mutex								mutex;
+	std::condition_variable					changed;
+	std::map<std::string, LoopbackSenderRef, std::less<>> senders;
+	uint64_t								changeCount = 0;
+	uint32_t								nextPort = 5961;
+};
+
+static LoopbackRegistry& getLoopbackRegistry() {
+	static LoopbackRegistry registry;
+	return registry;
+}
+
+static LoopbackSenderRef findLoopbackSender(std::string_view name, std::string_view url) {
+	auto& registry = getLoopbackRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	//As the SDK, prefer the address when provided
+	if(!url.empty()) {
+		for(const auto& sender : registry.senders) {
+			if(sender.second->url == url) {
+				return sender.second;
+			}
+		}
+	}
+
+	const auto ite = registry.senders.find(name);
+	return (ite != registry.senders.cend()) ? ite->second : nullptr;
+}
+
+
+
+/*
+ * Synthetic pattern generation
+ */
+
+static int getLoopbackStride(FourCC fourCC, uint32_t width) noexcept {
+	switch(fourCC) {
+	case FourCC::UYVY:
+	case FourCC::UYVA:
+	case FourCC::P216:
+	case FourCC::PA16:
+		return width * 2;
+
+	case FourCC::YV12:
+	case FourCC::I420:
+	case FourCC::NV12:
+		return width;
+
+	default:
+		return width * 4;
+	}
+}
+
+static size_t getLoopbackFrameSize(const VideoFrame& frame) noexcept {
+	const size_t stride = frame.getStride();
+	const size_t height = frame.getResolution().y;
+
+	switch(frame.getFourCC()) {
+	case FourCC::UYVA:	return stride*height + (stride/2)*height;
+	case FourCC::P216:	return 2*stride*height;
+	case FourCC::PA16:	return 3*stride*height;
+	case FourCC::YV12:
+	case FourCC::I420:	return stride*height + 2*(stride/2)*(height/2);
+	case FourCC::NV12:	return stride*height + stride*(height/2);
+	default:			return stride*height;
+	}
+}
+
+static FourCC getLoopbackFourCC(FourCC native, NDIlib_recv_color_format_e format) noexcept {
+	//Emulate the conversions done by the SDK
+	const auto alpha = hasAlpha(native);
+	switch(format) {
+	case NDIlib_recv_color_format_BGRX_BGRA:	return alpha ? FourCC::BGRA : FourCC::BGRX;
+	case NDIlib_recv_color_format_RGBX_RGBA:	return alpha ? FourCC::RGBA : FourCC::RGBX;
+	case NDIlib_recv_color_format_UYVY_BGRA:	return alpha ? FourCC::BGRA : FourCC::UYVY;
+	case NDIlib_recv_color_format_UYVY_RGBA:	return alpha ? FourCC::RGBA : FourCC::UYVY;
+	default:									return native;
+	}
+}
+
+static void writeLoopbackSample(const Channel& channel, size_t x, size_t y, uint16_t value) noexcept {
+	//Values are expressed in 16 bits
+	auto* const sample = channel.data + y*channel.stride + x*channel.step;
+	if(channel.depth == sizeof(uint16_t)) {
+		std::memcpy(sample, &value, sizeof(value));
+	} else {
+		*sample = static_cast<std::byte>(value >> 8);
+	}
+}
+
+static void fillLoopbackPattern(const VideoFrame& frame) noexcept {
+	//75% colour bars, BT.709. Alpha is a horizontal ramp
+	static constexpr size_t BAR_COUNT = 8;
+	static constexpr std::array<std::array<uint8_t, 3>, BAR_COUNT> YCBCR_BARS = {{
+		{ 180, 128, 128 }, { 168, 44, 136 }, { 145, 147, 44 }, { 134, 63, 52 },
+		{ 63, 193, 204 }, { 51, 109, 212 }, { 28, 212, 120 }, { 16, 128, 128 }
+	}};
+	static constexpr std::array<std::array<uint8_t, 3>, BAR_COUNT> RGB_BARS = {{
+		{ 191, 191, 191 }, { 191, 191, 0 }, { 0, 191, 191 }, { 0, 191, 0 },
+		{ 191, 0, 191 }, { 191, 0, 0 }, { 0, 0, 191 }, { 0, 0, 0 }
+	}};
+
+	const auto channels = getChannels(frame);
+	const auto& bars = (channels.family == Channels::YCBCR) ? YCBCR_BARS : RGB_BARS;
+	const auto alpha = hasAlpha(frame.getFourCC());
+
+	for(size_t i = 0; i < channels.channels.size(); ++i) {
+		const auto& channel = channels.channels[i];
+		if(!channel) {
+			continue;
+		}
+
+		const size_t width = channel.resolution.x;
+		for(size_t y = 0; y < channel.resolution.y; ++y) {
+			for(size_t x = 0; x < width; ++x) {
+				uint16_t value;
+				if(i == Channels::A) {
+					value = alpha ? static_cast<uint16_t>(x * 0xFFFF / std::max<size_t>(width - 1, 1)) : 0xFFFF;
+				} else {
+					value = bars[x * BAR_COUNT / width][i] << 8;
+				}
+
+				writeLoopbackSample(channel, x, y, value);
+			}
+		}
+	}
+}
+
+static void drawLoopbackMarker(const VideoFrame& frame, uint64_t index) noexcept {
+	//A white bar sweeping the frame, so that consecutive frames differ
+	static constexpr size_t MARKER_WIDTH = 4;
+	static constexpr size_t MARKER_SPEED = 8;
+
+	const auto channels = getChannels(frame);
+	const auto isYCbCr = channels.family == Channels::YCBCR;
+	const auto white = static_cast<uint16_t>((isYCbCr ? 235 : 255) << 8);
+	const size_t count = isYCbCr ? 1 : 3;
+
+	for(size_t i = 0; i < count; ++i) {
+		const auto& channel = channels.channels[i];
+		if(!channel || channel.resolution.x < MARKER_WIDTH) {
+			continue;
+		}
+
+		const size_t x0 = (index * MARKER_SPEED) % (channel.resolution.x - MARKER_WIDTH + 1);
+		for(size_t y = 0; y < channel.resolution.y; ++y) {
+			for(size_t x = x0; x < x0 + MARKER_WIDTH; ++x) {
+				writeLoopbackSample(channel, x, y, white);
+			}
+		}
+	}
+}
+
+static uint64_t getLoopbackHash(uint64_t x) noexcept {
+	//splitmix64, so that the jitter is reproducible
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+
+
+/*
+ * SDK objects
+ */
+
+struct LoopbackFind {
+	uint64_t								changeCount = 0;
+	std::vector<LoopbackSenderRef>			senders;	//Keeps the strings alive
+	std::vector<Source>						sources;
+};
+
+struct LoopbackRecv {
+	std::mutex								mutex;
+	std::string								name;
+	std::string								url;
+	NDIlib_recv_color_format_e				colorFormat;
+	bool									allowFields;
+	bool									pgmTally = false;
+	bool									pvwTally = false;
+
+	//Timing of the virtual sender
+	LoopbackSenderRef						sender;
+	bool									started = false;
+	uint64_t								index = 0;		//Next frame to be sent
+	int64_t									timecode = 0;	//Of the next frame
+	LoopbackClock::time_point				nextTime;
+
+	//Last frame that has been sent
+	bool									sent = false;
+	uint64_t								lastIndex = 0;
+	int64_t									lastTimecode = 0;
+
+	//Statistics, since the receiver was created
+	int64_t									totalFrames = 0;
+	int64_t									droppedFrames = 0;
+
+	//Replayed frames are not copied. Keep their recordings alive
+	std::vector<std::shared_ptr<const Recording>> recordings;
+	std::vector<const std::byte*>			replayedFrames;
+
+	//Pre-rendered pattern of the current format
+	VideoFrame								patternFrame;
+	std::vector<std::byte>					pattern;
+	std::vector<std::unique_ptr<std::byte[]>> spareBuffers;
+};
+
+static const Loopback::Format& getLoopbackFormat(const Loopback::Sender& sender, uint64_t index) noexcept {
+	assert(!sender.formats.empty());
+	const auto period = sender.formatPeriod ? sender.formatPeriod : std::numeric_limits<uint64_t>::max();
+	return sender.formats[(index / period) % sender.formats.size()];
+}
+
+static LoopbackDuration getLoopbackPeriod(Math::Rational<int> rate) noexcept {
+	return (rate.getNumerator() > 0)
+		? LoopbackDuration(LoopbackDuration::period::den * rate.getDenominator() / rate.getNumerator())
+		: LoopbackDuration(std::chrono::seconds(1));
+}
+
+static LoopbackDuration getLoopbackPeriod(const Loopback::Sender& sender, uint64_t index) noexcept {
+	if(sender.recording) {
+		const auto& recording = *sender.recording;
+		return getLoopbackPeriod(recording[index % recording.size()].getFrameRate());
+	} else {
+		return getLoopbackPeriod(getLoopbackFormat(sender, index).frameRate);
+	}
+}
+
+static LoopbackClock::duration getLoopbackDelay(const Loopback::Sender& sender, uint64_t index) noexcept {
+	if(sender.jitter <= 0) {
+		return LoopbackClock::duration::zero();
+	}
+
+	const auto delay = getLoopbackHash(index) % static_cast<uint64_t>(sender.jitter + 1);
+	return std::chrono::duration_cast<LoopbackClock::duration>(LoopbackDuration(delay));
+}
+
+static bool updateLoopbackSender(LoopbackRecv& recv, LoopbackClock::time_point now) {
+	auto sender = findLoopbackSender(recv.name, recv.url);
+	if(sender != recv.sender) {
+		//New connection, start from scratch
+		recv.sender = std::move(sender);
+		recv.started = false;
+	}
+
+	//Senders without frames are ignored
+	if(recv.sender) {
+		const auto& recording = recv.sender->recording;
+		if(recording ? recording->empty() : recv.sender->formats.empty()) {
+			recv.sender = nullptr;
+		}
+	}
+
+	if(recv.sender && recv.sender->recording) {
+		const auto& recording = recv.sender->recording;
+		if(std::find(recv.recordings.cbegin(), recv.recordings.cend(), recording) == recv.recordings.cend()) {
+			recv.recordings.push_back(recording);
+		}
+	}
+
+	if(recv.sender && !recv.started) {
+		recv.started = true;
+		recv.index = 0;
+		recv.timecode = 0;
+		recv.nextTime = now;
+		recv.sent = false;
+	}
+
+	return static_cast<bool>(recv.sender);
+}
+
+static void advanceLoopbackSender(LoopbackRecv& recv, LoopbackClock::time_point now) noexcept {
+	assert(recv.sender);
+	recv.sent = true;
+	recv.lastIndex = recv.index;
+	recv.lastTimecode = recv.timecode;
+
+	const auto period = getLoopbackPeriod(*recv.sender, recv.index);
+	recv.nextTime += period;
+	recv.timecode += period.count();
+	++recv.index;
+	++recv.totalFrames;
+
+	//Skip frames if the receiver has fallen too far behind. As the
+	//SDK does, they are accounted as received but dropped
+	if(now - recv.nextTime > LOOPBACK_MAX_DELAY) {
+		const auto skipped = std::chrono::duration_cast<LoopbackDuration>(now - recv.nextTime);
+		const auto skippedFrames = skipped / period;
+		recv.timecode += skipped.count();
+		recv.nextTime = now;
+		recv.totalFrames += skippedFrames;
+		recv.droppedFrames += skippedFrames;
+	}
+}
+
+static void generateLoopbackFrame(	LoopbackRecv& recv,
+									NDIlib_frame_format_type_e fieldType,
+									VideoFrame& frame )
+{
+	assert(recv.sender);
+	assert(recv.sent);
+	const auto index = recv.lastIndex;
+	const auto timecode = recv.lastTimecode;
+	const auto delay = std::chrono::duration_cast<LoopbackDuration>(getLoopbackDelay(*recv.sender, index));
+
+	if(recv.sender->recording) {
+		//Serve the mapped frame as it is. Timing is rewritten, 
+		//so that it remains monotonic when looping
+		const auto& recording = *recv.sender->recording;
+		frame = recording[index % recording.size()];
+		frame.setTimecode(timecode);
+		frame.setTimestamp(timecode + delay.count());
+		recv.replayedFrames.push_back(frame.getData());
+		return;
+	}
+
+	const auto& format = getLoopbackFormat(*recv.sender, index);
+	const auto fourCC = getLoopbackFourCC(format.fourCC, recv.colorFormat);
+	const auto interlaced = 	format.field == VideoFrame::Format::INTERLEAVED &&
+								recv.allowFields &&
+								fieldType != NDIlib_frame_format_type_progressive;
+
+	//Timecodes are nominal, timestamps suffer the jitter
+	frame = VideoFrame(
+		format.resolution,
+		fourCC,
+		format.frameRate,
+		0.0f,	//Square pixels
+		interlaced ? VideoFrame::Format::INTERLEAVED : VideoFrame::Format::PROGRESSIVE,
+		timecode,
+		nullptr,
+		getLoopbackStride(fourCC, format.resolution.x),
+		nullptr,
+		timecode + delay.count()
+	);
+
+	//Render the pattern if the format has changed
+	const auto& pattern = recv.patternFrame;
+	if(	pattern.getResolution() != frame.getResolution() ||
+		pattern.getFourCC() != frame.getFourCC() ||
+		recv.pattern.empty() )
+	{
+		recv.patternFrame = frame;
+		recv.pattern.resize(getLoopbackFrameSize(frame));
+		recv.patternFrame.setData(recv.pattern.data());
+		fillLoopbackPattern(recv.patternFrame);
+
+		//Old buffers have a different size
+		recv.spareBuffers.clear();
+	}
+
+	//Reuse a previously freed buffer when possible
+	std::unique_ptr<std::byte[]> buffer;
+	if(!recv.spareBuffers.empty()) {
+		buffer = std::move(recv.spareBuffers.back());
+		recv.spareBuffers.pop_back();
+	} else {
+		buffer = std::make_unique<std::byte[]>(recv.pattern.size());
+	}
+
+	std::memcpy(buffer.get(), recv.pattern.data(), recv.pattern.size());
+	frame.setData(buffer.release());
+	drawLoopbackMarker(frame, index);
+}
+
+static void freeLoopbackFrame(LoopbackRecv& recv, const VideoFrame& frame) {
+	//Replayed frames belong to the recording
+	const auto replayed = std::find(recv.replayedFrames.cbegin(), recv.replayedFrames.cend(), frame.getData());
+	if(replayed != recv.replayedFrames.cend()) {
+		recv.replayedFrames.erase(replayed);
+		return;
+	}
+
+	std::unique_ptr<std::byte[]> buffer(frame.getData());
+	if(!buffer) {
+		return;
+	}
+
+	//Keep it if it matches the current format
+	if(	getLoopbackFrameSize(frame) == recv.pattern.size() &&
+		recv.spareBuffers.size() < LOOPBACK_MAX_SPARE_BUFFERS )
+	{
+		recv.spareBuffers.push_back(std::move(buffer));
+	}
+}
+
+
+
+/*
+ * Entry points
+ */
+
+static bool loopbackInitialize() {
+	return true;
+}
+
+static void loopbackDestroy() {
+}
+
+static const char* loopbackVersion() {
+	return "Loopback";
+}
+
+static bool loopbackIsSupportedCPU() {
+	return true;
+}
+
+
+static NDIlib_find_instance_t loopbackFindCreate(const NDIlib_find_create_t*) {
+	return new LoopbackFind;
+}
+
+static void loopbackFindDestroy(NDIlib_find_instance_t instance) {
+	delete static_cast<LoopbackFind*>(instance);
+}
+
+static bool loopbackFindWaitForSources(NDIlib_find_instance_t instance, uint32_t timeo) {
+	auto& find = *static_cast<LoopbackFind*>(instance);
+	auto& registry = getLoopbackRegistry();
+
+	std::unique_lock<std::mutex> lock(registry.mutex);
+	return registry.changed.wait_for(
+		lock,
+		std::chrono::milliseconds(timeo),
+		[&registry, &find] () -> bool {
+			return registry.changeCount != find.changeCount;
+		}
+	);
+}
+
+static const NDIlib_source_t* loopbackFindGetCurrentSources(NDIlib_find_instance_t instance, uint32_t* count) {
+	auto& find = *static_cast<LoopbackFind*>(instance);
+	auto& registry = getLoopbackRegistry();
+
+	{
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		find.changeCount = registry.changeCount;
+		find.senders.clear();
+		for(const auto& sender : registry.senders) {
+			find.senders.push_back(sender.second);
+		}
+	}
+
+	find.sources.clear();
+	for(const auto& sender : find.senders) {
+		find.sources.emplace_back(sender->name.c_str(), sender->url.c_str());
+	}
+
+	if(count) {
+		*count = find.sources.size();
+	}
+	return find.sources.empty() ? nullptr : &static_cast<const NDIlib_source_t&>(find.sources.front());
+}
+
+
+static void loopbackRecvConnect(NDIlib_recv_instance_t instance, const NDIlib_source_t* source) {
+	auto& recv = *static_cast<LoopbackRecv*>(instance);
+	std::lock_guard<std::mutex> lock(recv.mutex);
+
+	recv.name = (source && source->p_ndi_name) ? source->p_ndi_name : "";
+	recv.url = (source && source->p_url_address) ? source->p_url_address : "";
+}
+
+static NDIlib_recv_instance_t loopbackRecvCreate(const NDIlib_recv_create_v3_t* createInfo) {
+	auto recv = std::make_unique<LoopbackRecv>();
+	recv->colorFormat = createInfo ? createInfo->color_format : NDIlib_recv_color_format_UYVY_BGRA;
+	recv->allowFields = createInfo ? createInfo->allow_video_fields : true;
+	loopbackRecvConnect(recv.get(), createInfo ? &createInfo->source_to_connect_to : nullptr);
+	return recv.release();
+}
+
+static void loopbackRecvDestroy(NDIlib_recv_instance_t instance) {
+	delete static_cast<LoopbackRecv*>(instance);
+}
+
+static NDIlib_frame_type_e loopbackRecvCapture(	NDIlib_recv_instance_t instance,
+												NDIlib_video_frame_v2_t* video,
+												NDIlib_audio_frame_v3_t*,
+												NDIlib_metadata_frame_t*,
+												uint32_t timeo )
+{
+	auto& recv = *static_cast<LoopbackRecv*>(instance);
+	const auto deadline = LoopbackClock::now() + std::chrono::milliseconds(timeo);
+	std::unique_lock<std::mutex> lock(recv.mutex);
+
+	//Wait until the next frame is sent
+	if(!updateLoopbackSender(recv, LoopbackClock::now())) {
+		lock.unlock();
+		std::this_thread::sleep_until(deadline);
+		return NDIlib_frame_type_none;
+	}
+
+	const auto sendTime = recv.nextTime + getLoopbackDelay(*recv.sender, recv.index);
+	if(sendTime > deadline) {
+		lock.unlock();
+		std::this_thread::sleep_until(deadline);
+		return NDIlib_frame_type_none;
+	}
+
+	lock.unlock();
+	std::this_thread::sleep_until(sendTime);
+	lock.lock();
+
+	//Sender might have been changed meanwhile
+	if(!recv.sender || !video) {
+		return NDIlib_frame_type_none;
+	}
+
+	advanceLoopbackSender(recv, LoopbackClock::now());
+	generateLoopbackFrame(recv, NDIlib_frame_format_type_interleaved, reinterpret_cast<VideoFrame&>(*video));
+	return NDIlib_frame_type_video;
+}
+
+static void loopbackRecvFreeVideo(NDIlib_recv_instance_t instance, const NDIlib_video_frame_v2_t* video) {
+	auto& recv = *static_cast<LoopbackRecv*>(instance);
+	std::lock_guard<std::mutex> lock(recv.mutex);
+	if(video) {
+		freeLoopbackFrame(recv, reinterpret_cast<const VideoFrame&>(*video));
+	}
+}
+
+static bool loopbackRecvSetTally(NDIlib_recv_instance_t instance, const NDIlib_tally_t* tally) {
+	auto& recv = *static_cast<LoopbackRecv*>(instance);
+	std::lock_guard<std::mutex> lock(recv.mutex);
+	if(tally) {
+		recv.pgmTally = tally->on_program;
+		recv.pvwTally = tally->on_preview;
+	}
+	return true;
+}
+
+
+static void loopbackRecvGetPerformance(	NDIlib_recv_instance_t instance,
+										NDIlib_recv_performance_t* total,
+										NDIlib_recv_performance_t* dropped )
+{
+	auto& recv = *static_cast<LoopbackRecv*>(instance);
+	std::lock_guard<std::mutex> lock(recv.mutex);
+
+	//Only video is sent
+	if(total) {
+		total->video_frames = recv.totalFrames;
+		total->audio_frames = 0;
+		total->metadata_frames = 0;
+	}
+	if(dropped) {
+		dropped->video_frames = recv.droppedFrames;
+		dropped->audio_frames = 0;
+		dropped->metadata_frames = 0;
+	}
+}
+
+static void loopbackRecvGetQueue(NDIlib_recv_instance_t instance, NDIlib_recv_queue_t* queue) {
+	auto& recv = *static_cast<LoopbackRecv*>(instance);
+	std::lock_guard<std::mutex> lock(recv.mutex);
+
+	//Frames whose send time has passed are waiting to be captured.
+	//Beyond the maximum delay, they will be dropped
+	int queued = 0;
+	if(recv.sender && recv.started) {
+		const auto now = LoopbackClock::now();
+		if(now >= recv.nextTime) {
+			const auto period = getLoopbackPeriod(*recv.sender, recv.index);
+			const auto delay = std::min(
+				std::chrono::duration_cast<LoopbackDuration>(now - recv.nextTime),
+				std::chrono::duration_cast<LoopbackDuration>(LOOPBACK_MAX_DELAY)
+			);
+			queued = 1 + static_cast<int>(delay / period);
+		}
+	}
+
+	if(queue) {
+		queue->video_frames = queued;
+		queue->audio_frames = 0;
+		queue->metadata_frames = 0;
+	}
+}
+
+static int loopbackRecvGetNoConnections(NDIlib_recv_instance_t instance) {
+	auto& recv = *static_cast<LoopbackRecv*>(instance);
+	std::lock_guard<std::mutex> lock(recv.mutex);
+	return findLoopbackSender(recv.name, recv.url) ? 1 : 0;
+}
+
+
+static NDIlib_framesync_instance_t loopbackFrameSyncCreate(NDIlib_recv_instance_t recv) {
+	//Frame-syncs drive their receiver
+	return recv;
+}
+
+static void loopbackFrameSyncDestroy(NDIlib_framesync_instance_t) {
+}
+
+static void loopbackFrameSyncCapture(	NDIlib_framesync_instance_t instance,
+										NDIlib_video_frame_v2_t* video,
+										NDIlib_frame_format_type_e fieldType )
+{
+	auto& recv = *static_cast<LoopbackRecv*>(instance);
+	auto& frame = reinterpret_cast<VideoFrame&>(*video);
+	std::lock_guard<std::mutex> lock(recv.mutex);
+	const auto now = LoopbackClock::now();
+
+	//Never blocks. Returns the latest frame that has been sent
+	if(updateLoopbackSender(recv, now)) {
+		while(now >= recv.nextTime + getLoopbackDelay(*recv.sender, recv.index)) {
+			advanceLoopbackSender(recv, now);
+		}
+	}
+
+	//As the SDK, return an empty frame if nothing has been received
+	if(recv.sender && recv.sent) {
+		generateLoopbackFrame(recv, fieldType, frame);
+	} else {
+		frame = VideoFrame();
+	}
+}
+
+static void loopbackFrameSyncFree(NDIlib_framesync_instance_t instance, NDIlib_video_frame_v2_t* video) {
+	loopbackRecvFreeVideo(instance, video);
+}
+
+
+
+static NDIlib_v4 createLoopbackInterface() noexcept {
+	NDIlib_v4 result;
+	std::memset(&result, 0, sizeof(result));
+
+	result.initialize = loopbackInitialize;
+	result.destroy = loopbackDestroy;
+	result.version = loopbackVersion;
+	result.is_supported_CPU = loopbackIsSupportedCPU;
+
+	result.find_create_v2 = loopbackFindCreate;
+	result.find_destroy = loopbackFindDestroy;
+	result.find_wait_for_sources = loopbackFindWaitForSources;
+	result.find_get_current_sources = loopbackFindGetCurrentSources;
+
+	result.recv_create_v3 = loopbackRecvCreate;
+	result.recv_destroy = loopbackRecvDestroy;
+	result.recv_connect = loopbackRecvConnect;
+	result.recv_capture_v3 = loopbackRecvCapture;
+	result.recv_free_video_v2 = loopbackRecvFreeVideo;
+	result.recv_set_tally = loopbackRecvSetTally;
+	result.recv_get_performance = loopbackRecvGetPerformance;
+	result.recv_get_queue = loopbackRecvGetQueue;
+	result.recv_get_no_connections = loopbackRecvGetNoConnections;
+
+	result.framesync_create = loopbackFrameSyncCreate;
+	result.framesync_destroy = loopbackFrameSyncDestroy;
+	result.framesync_capture_video = loopbackFrameSyncCapture;
+	result.framesync_free_video = loopbackFrameSyncFree;
+
+	return result;
+}
+
+
+
+/*
+ * Loopback
+ */
+
+void Loopback::addSender(Sender sender) {
+	auto& registry = getLoopbackRegistry();
+
+	{
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		if(sender.url.empty()) {
+			sender.url = "127.0.0.1:" + std::to_string(registry.nextPort++);
+		}
+
+		auto name = sender.name;
+		registry.senders[std::move(name)] = std::make_shared<const Sender>(std::move(sender));
+		++registry.changeCount;
+	}
+
+	registry.changed.notify_all();
+}
+
+void Loopback::removeSender(std::string_view name) {
+	auto& registry = getLoopbackRegistry();
+
+	{
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		const auto ite = registry.senders.find(name);
+		if(ite == registry.senders.cend()) {
+			return;
+		}
+
+		registry.senders.erase(ite);
+		++registry.changeCount;
+	}
+
+	registry.changed.notify_all();
+}
+
+void Loopback::clear() {
+	auto& registry = getLoopbackRegistry();
+
+	{
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		registry.senders.clear();
+		++registry.changeCount;
+	}
+
+	registry.changed.notify_all();
+}
+
+size_t Loopback::size() {
+	auto& registry = getLoopbackRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	return registry.senders.size();
+}
+
+
+std::vector<Loopback::Format> Loopback::getAllFormats(	Resolution resolution,
+														Math::Rational<int> frameRate )
+{
+	static constexpr std::array<FourCC, 11> FOURCCS = {
+		FourCC::UYVY, FourCC::UYVA, FourCC::P216, FourCC::PA16,
+		FourCC::YV12, FourCC::I420, FourCC::NV12,
+		FourCC::BGRA, FourCC::BGRX, FourCC::RGBA, FourCC::RGBX
+	};
+
+	std::vector<Format> result;
+	result.reserve(FOURCCS.size());
+	for(const auto fourCC : FOURCCS) {
+		result.push_back(Format{ resolution, fourCC, frameRate, VideoFrame::Format::PROGRESSIVE });
+	}
+
+	return result;
+}
+
+const NDIlib_v4& Loopback::getInterface() noexcept {
+	static const NDIlib_v4 ndi = createLoopbackInterface();
+	return ndi;
+}
+
+}
\ No newline at end of file
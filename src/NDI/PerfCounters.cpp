@@ -0,0 +1,274 @@
+#include <zuazo/NDI/PerfCounters.h>
+
+#include <cstring>
+#include <tuple>
+
+#if defined(__linux__)
+	#include <linux/perf_event.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
+namespace Zuazo::NDI {
+
+static constexpr size_t PERF_COUNTER_COUNT = static_cast<size_t>(PerfCounters::Counter::COUNT);
+
+/*
+ * PerfCounters::Totals
+ */
+
+double PerfCounters::Totals::getBytesPerCycle() const noexcept {
+	//Only the calls where cycles were counted are considered
+	const auto cycles = values[static_cast<size_t>(Counter::CYCLES)];
+	const auto measuredCalls = measured[static_cast<size_t>(Counter::CYCLES)];
+	return (cycles && calls) ? static_cast<double>(bytes) * measuredCalls / calls / cycles : 0.0;
+}
+
+double PerfCounters::Totals::getInstructionsPerCycle() const noexcept {
+	const auto cycles = values[static_cast<size_t>(Counter::CYCLES)];
+	const auto instructions = values[static_cast<size_t>(Counter::INSTRUCTIONS)];
+	const auto bothMeasured =
+		measured[static_cast<size_t>(Counter::CYCLES)] == measured[static_cast<size_t>(Counter::INSTRUCTIONS)];
+	return (cycles && bothMeasured) ? static_cast<double>(instructions) / cycles : 0.0;
+}
+
+double PerfCounters::Totals::getPerCall(Counter counter) const noexcept {
+	const auto index = static_cast<size_t>(counter);
+	return measured[index] ? static_cast<double>(values[index]) / measured[index] : 0.0;
+}
+
+
+
+/*
+ * PerfCounters::Group
+ */
+
+struct PerfCounters::Group {
+	//A group is read at once, so that all of its counters refer to
+	//the same interval. Only the leader is read
+	Group()
+		: fds()
+		, positions()
+		, size(0)
+	{
+		fds.fill(-1);
+		positions.fill(-1);
+
+#if defined(__linux__)
+		static constexpr uint64_t CONFIGS[PERF_COUNTER_COUNT] = {
+			PERF_COUNT_HW_CPU_CYCLES,
+			PERF_COUNT_HW_INSTRUCTIONS,
+			PERF_COUNT_HW_CACHE_MISSES
+		};
+
+		for(size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = CONFIGS[i];
+			attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			attr.exclude_kernel = 1; //Allowed with the default perf_event_paranoid
+			attr.exclude_hv = 1;
+
+			//Only the calling thread is counted, on any CPU. Unsupported
+			//counters are skipped, the first available one leads the group
+			const auto leader = getLeader();
+			const auto fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, PERF_FLAG_FD_CLOEXEC));
+			if(fd >= 0) {
+				fds[i] = fd;
+				positions[i] = size++;
+			}
+		}
+#endif
+	}
+
+	~Group() {
+#if defined(__linux__)
+		for(const auto fd : fds) {
+			if(fd >= 0) {
+				close(fd);
+			}
+		}
+#endif
+	}
+
+	int getLeader() const noexcept {
+		for(const auto fd : fds) {
+			if(fd >= 0) {
+				return fd;
+			}
+		}
+		return -1;
+	}
+
+	std::array<int, PERF_COUNTER_COUNT>	fds;
+	std::array<int, PERF_COUNTER_COUNT>	positions; //In the group read
+	int									size;
+};
+
+
+
+/*
+ * PerfCounters
+ */
+
+static std::atomic<uint64_t> s_perfCountersCount(0);
+
+PerfCounters::PerfCounters()
+	: m_id(++s_perfCountersCount)
+	, m_enabled(false)
+	, m_mutex()
+	, m_groups()
+	, m_totals()
+{
+}
+
+PerfCounters::~PerfCounters() = default;
+
+
+
+void PerfCounters::setEnabled(bool enabled) noexcept {
+	m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool PerfCounters::isEnabled() const noexcept {
+	return m_enabled.load(std::memory_order_relaxed);
+}
+
+bool PerfCounters::isSupported() noexcept {
+	const auto* group = getGroup();
+	return group && group->size > 0;
+}
+
+
+PerfCounters::Reading PerfCounters::begin() noexcept {
+	Reading result;
+	result.valid = isEnabled();
+	if(result.valid) {
+		read(result);
+		result.time = Clock::now(); //Last, so that reading is not timed
+	}
+	return result;
+}
+
+void PerfCounters::end(const Key& key, const Reading& begin, size_t bytes) noexcept {
+	if(!begin.valid) {
+		return;
+	}
+
+	//Same as begin, in reverse order
+	Reading end;
+	end.time = Clock::now();
+	read(end);
+
+	//Counters are scaled when they have been multiplexed
+	//with others, as done by perf
+	const auto enabled = end.enabled - begin.enabled;
+	const auto running = end.running - begin.running;
+	const auto scale = (running > 0 && running < enabled) ? static_cast<double>(enabled) / running : 1.0;
+
+	try {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto& totals = m_totals[key];
+		++totals.calls;
+		totals.bytes += bytes;
+		totals.time += std::chrono::duration_cast<std::chrono::nanoseconds>(end.time - begin.time).count();
+		for(size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+			if(begin.measured[i] && end.measured[i] && running > 0) {
+				totals.values[i] += static_cast<uint64_t>((end.values[i] - begin.values[i]) * scale);
+				++totals.measured[i];
+			}
+		}
+	} catch(...) {
+		//Out of memory. The measurement is lost
+	}
+}
+
+
+PerfCounters::Results PerfCounters::getResults() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return Results(m_totals.cbegin(), m_totals.cend());
+}
+
+void PerfCounters::reset() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_totals.clear();
+}
+
+
+std::string_view PerfCounters::getCounterName(Counter counter) noexcept {
+	switch(counter) {
+	case Counter::CYCLES:		return "cycles";
+	case Counter::INSTRUCTIONS:	return "instructions";
+	case Counter::CACHE_MISSES:	return "LLC misses";
+	default:					return "";
+	}
+}
+
+
+
+bool PerfCounters::KeyCompare::operator()(const Key& lhs, const Key& rhs) const noexcept {
+	return 	std::tie(lhs.source, lhs.format, lhs.subsampling) <
+			std::tie(rhs.source, rhs.format, rhs.subsampling) ;
+}
+
+PerfCounters::Group* PerfCounters::getGroup() noexcept {
+	//Counters are opened per thread, as they only count the thread
+	//that opened them. Groups are owned by this object, as in Tracer
+	struct Cache {
+		uint64_t	perfCountersId = 0;
+		Group*		group = nullptr;
+	};
+	thread_local Cache cache;
+
+	if(cache.perfCountersId != m_id) {
+		try {
+			auto group = std::make_unique<Group>();
+			std::lock_guard<std::mutex> lock(m_mutex);
+			cache.group = group.get();
+			cache.perfCountersId = m_id;
+			m_groups.push_back(std::move(group));
+		} catch(...) {
+			return nullptr;
+		}
+	}
+
+	return cache.group;
+}
+
+bool PerfCounters::read(Reading& reading) noexcept {
+	reading.enabled = 0;
+	reading.running = 0;
+	reading.values.fill(0);
+	reading.measured.fill(false);
+
+#if defined(__linux__)
+	const auto* group = getGroup();
+	if(!group || group->size == 0) {
+		return false;
+	}
+
+	//Layout of PERF_FORMAT_GROUP: nr, time enabled, time running, values
+	uint64_t buffer[3 + PERF_COUNTER_COUNT];
+	const auto size = ::read(group->getLeader(), buffer, sizeof(buffer));
+	if(size < static_cast<ssize_t>(3*sizeof(uint64_t)) || buffer[0] != static_cast<uint64_t>(group->size)) {
+		return false;
+	}
+
+	reading.enabled = buffer[1];
+	reading.running = buffer[2];
+	for(size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+		if(group->positions[i] >= 0) {
+			reading.values[i] = buffer[3 + group->positions[i]];
+			reading.measured[i] = true;
+		}
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include <zuazo/NDI/Recorder.h>
+
+#include "../Hostname.h"
+
+namespace Zuazo::NDI {
+
+static Recv createRecorderReceiver(const Source& source, Recv::Bandwidth bandwidth) {
+	//Get receiver name
+	auto recvIdentifier = getHostname();
+	recvIdentifier += " (recorder)";
+
+	return Recv(
+		source,
+		Recv::ColorFormat::BEST, //Frames are recorded as they are sent
+		bandwidth,
+		true, //Fields are recorded as they are sent
+		recvIdentifier.c_str()
+	);
+}
+
+
+
+Recorder::Recorder(	const Source& source,
+					const std::string& path,
+					Recv::Bandwidth bandwidth )
+	: m_writer(path)
+	, m_receiver(createRecorderReceiver(source, bandwidth))
+	, m_frameCount(0)
+	, m_exit(false)
+	, m_thread(&Recorder::threadFunc, this)
+{
+}
+
+Recorder::~Recorder() {
+	m_exit.store(true);
+	m_thread.join();
+	m_writer.flush();
+}
+
+
+
+size_t Recorder::getFrameCount() const noexcept {
+	return m_frameCount.load();
+}
+
+
+
+void Recorder::threadFunc() {
+	//Capture returns on timeout, so that exit requests are attended periodically
+	while(!m_exit.load()) {
+		VideoFrame frame;
+		if(m_receiver.capture(frame, DEFAULT_CAPTURE_TIMEOUT) == Recv::FrameType::VIDEO) {
+			//Frames are written in the capture thread, as the
+			//SDK buffers them meanwhile
+			try {
+				m_writer.write(frame);
+				++m_frameCount;
+			} catch(...) {
+				//Disk is full or similar. Stop recording
+				m_exit.store(true);
+			}
+
+			m_receiver.free(frame);
+		}
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,263 @@
+#include <zuazo/NDI/Recording.h>
+
+#include "Channels.h"
+
+#include <zuazo/Exception.h>
+
+#include <array>
+#include <cassert>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Zuazo::NDI {
+
+/*
+ * On-disk layout. All values are stored in host byte order
+ */
+static constexpr std::array<char, 8> RECORDING_MAGIC = { 'Z', 'N', 'D', 'I', 'R', 'E', 'C', '\0' };
+static constexpr uint32_t RECORDING_FRAME_MAGIC = 0x4D415246; //"FRAM"
+
+struct RecordingFileHeader {
+	std::array<char, 8>						magic;
+	uint32_t								version;
+	uint32_t								alignment;
+};
+
+struct RecordingFrameHeader {
+	uint32_t								magic;
+	uint32_t								fourCC;
+	uint32_t								width;
+	uint32_t								height;
+	int32_t									frameRateNum;
+	int32_t									frameRateDen;
+	float									pictureAspectRatio;
+	uint32_t								format;
+	int32_t									stride;
+	uint32_t								reserved;
+	int64_t									timecode;
+	int64_t									timestamp;
+	uint64_t								dataSize;
+};
+
+static_assert(sizeof(RecordingFileHeader) <= Recording::ALIGNMENT, "File header must fit in a page");
+static_assert(sizeof(RecordingFrameHeader) <= Recording::ALIGNMENT, "Frame header must fit in a page");
+
+static constexpr size_t alignRecordingOffset(size_t offset) noexcept {
+	return (offset + Recording::ALIGNMENT - 1) / Recording::ALIGNMENT * Recording::ALIGNMENT;
+}
+
+static bool isValidRecordingFrame(const VideoFrame& frame, uint64_t dataSize) noexcept {
+	//Rows must not overlap and every plane implied by the FourCC 
+	//and the resolution must fit in the data
+	if(frame.getStride() <= 0) {
+		return false;
+	}
+
+	//Checked first, so that the plane offsets can not overflow
+	const auto stride = static_cast<uint64_t>(frame.getStride());
+	if(stride*frame.getResolution().y > dataSize) {
+		return false;
+	}
+
+	const auto planes = getPlanes(frame);
+	for(const auto& plane : planes) {
+		if(plane && plane.width > plane.stride) {
+			return false;
+		}
+	}
+
+	const auto frameSize = getFrameSize(frame);
+	return frameSize > 0 && frameSize <= dataSize;
+}
+
+
+
+/*
+ * Recording::Writer
+ */
+
+Recording::Writer::Writer(const std::string& path)
+	: m_file(path, std::ios::binary | std::ios::trunc)
+	, m_frameCount(0)
+{
+	if(!m_file) {
+		throw Exception("Recording could not be created");
+	}
+
+	const RecordingFileHeader header = {
+		RECORDING_MAGIC,
+		VERSION,
+		ALIGNMENT
+	};
+	m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	pad();
+}
+
+
+
+void Recording::Writer::write(const VideoFrame& frame) {
+	const auto dataSize = getFrameSize(frame);
+	if(dataSize == 0) {
+		//Would not be accepted when read
+		throw Exception("Frame can not be recorded");
+	}
+
+	const auto resolution = frame.getResolution();
+	const auto frameRate = frame.getFrameRate();
+
+	const RecordingFrameHeader header = {
+		RECORDING_FRAME_MAGIC,
+		static_cast<uint32_t>(frame.getFourCC()),
+		resolution.x,
+		resolution.y,
+		frameRate.getNumerator(),
+		frameRate.getDenominator(),
+		frame.getPictureAspectRatio(),
+		static_cast<uint32_t>(frame.getFormat()),
+		frame.getStride(),
+		0,
+		frame.getTimecode(),
+		frame.getTimestamp(),
+		dataSize
+	};
+
+	//Both the header and the data start on a page boundary
+	m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	pad();
+	m_file.write(reinterpret_cast<const char*>(frame.getData()), dataSize);
+	pad();
+
+	if(!m_file) {
+		throw Exception("Recording could not be written");
+	}
+
+	++m_frameCount;
+}
+
+void Recording::Writer::flush() {
+	m_file.flush();
+}
+
+size_t Recording::Writer::size() const noexcept {
+	return m_frameCount;
+}
+
+
+void Recording::Writer::pad() {
+	static const std::array<char, ALIGNMENT> zeros = {};
+
+	const size_t offset = m_file.tellp();
+	m_file.write(zeros.data(), alignRecordingOffset(offset) - offset);
+}
+
+
+
+/*
+ * Recording
+ */
+
+Recording::Recording(const std::string& path)
+	: m_data(nullptr)
+	, m_size(0)
+	, m_frames()
+{
+	const auto fd = open(path.c_str(), O_RDONLY);
+	if(fd < 0) {
+		throw Exception("Recording could not be opened");
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < ALIGNMENT) {
+		close(fd);
+		throw Exception("Recording is not valid");
+	}
+
+	//Map the whole file. Pages are loaded on demand, so this
+	//scales to recordings larger than the available memory
+	m_size = st.st_size;
+	m_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); //Mapping remains valid
+	if(m_data == MAP_FAILED) {
+		m_data = nullptr;
+		throw Exception("Recording could not be mapped");
+	}
+	madvise(m_data, m_size, MADV_SEQUENTIAL);
+
+	const auto* base = static_cast<std::byte*>(m_data);
+	RecordingFileHeader fileHeader;
+	std::memcpy(&fileHeader, base, sizeof(fileHeader));
+	if(	fileHeader.magic != RECORDING_MAGIC ||
+		fileHeader.version != VERSION ||
+		fileHeader.alignment != ALIGNMENT )
+	{
+		munmap(m_data, m_size);
+		throw Exception("Recording is not valid");
+	}
+
+	//Index the frames. A truncated trailing frame is ignored,
+	//as it is likely to be an interrupted recording
+	size_t offset = ALIGNMENT;
+	while(offset + ALIGNMENT <= m_size) {
+		RecordingFrameHeader header;
+		std::memcpy(&header, base + offset, sizeof(header));
+		if(header.magic != RECORDING_FRAME_MAGIC) {
+			break;
+		}
+
+		const auto dataOffset = offset + ALIGNMENT;
+		if(dataOffset + header.dataSize > m_size) {
+			break;
+		}
+
+		const VideoFrame frame(
+			Resolution(header.width, header.height),
+			static_cast<FourCC>(header.fourCC),
+			Math::Rational<int>(header.frameRateNum, header.frameRateDen),
+			header.pictureAspectRatio,
+			static_cast<VideoFrame::Format>(header.format),
+			header.timecode,
+			const_cast<std::byte*>(base + dataOffset), //Must not be written
+			header.stride,
+			nullptr,
+			header.timestamp
+		);
+
+		//Unlike a truncated one, a frame with less data than its
+		//layout implies would be read out of bounds
+		if(!isValidRecordingFrame(frame, header.dataSize)) {
+			munmap(m_data, m_size);
+			throw Exception("Recording is not valid");
+		}
+
+		m_frames.push_back(frame);
+
+		offset = alignRecordingOffset(dataOffset + header.dataSize);
+	}
+}
+
+Recording::~Recording() {
+	if(m_data) {
+		munmap(m_data, m_size);
+	}
+}
+
+
+
+size_t Recording::size() const noexcept {
+	return m_frames.size();
+}
+
+bool Recording::empty() const noexcept {
+	return m_frames.empty();
+}
+
+const VideoFrame& Recording::operator[](size_t index) const noexcept {
+	assert(index < m_frames.size());
+	return m_frames[index];
+}
+
+}
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <zuazo/Modules/NDI.h>
 
 #include <type_traits>
+#include <utility>
 
 namespace Zuazo::NDI {
 
@@ -49,7 +50,7 @@ static NDIlib_recv_instance_t createRecvInstance(	const Source& source,
 }
 
 static void destroyRecvInstance(NDIlib_recv_instance_t instance) {
-	const auto& ndi = Modules::NDI::get().getNDI();
+	const auto& ndi = Modules::NDI::get().getLoadedNDI();
 	ndi.recv_destroy(instance);
 }
 
@@ -82,15 +83,20 @@ Recv::~Recv() {
 }
 
 Recv& Recv::operator=(Recv&& other) noexcept {
-	m_impl = other.m_impl;
-	other.m_impl = nullptr;
+	//Swap, so that the previous instance gets destroyed by other
+	std::swap(m_impl, other.m_impl);
 	return *this;
 }
 
 
+Recv::operator bool() const noexcept {
+	return m_impl;
+}
+
+
 
 void Recv::connect(const Source& source) noexcept {
-	const auto& ndi = Modules::NDI::get().getNDI();
+	const auto& ndi = Modules::NDI::get().getLoadedNDI();
 	ndi.recv_connect(
 		m_impl, 
 		&static_cast<const NDIlib_source_t&>(source)
@@ -99,7 +105,7 @@ void Recv::connect(const Source& source) noexcept {
 
 
 Recv::FrameType	Recv::capture(VideoFrame& frame, uint32_t timeo) const noexcept {
-	const auto& ndi = Modules::NDI::get().getNDI();
+	const auto& ndi = Modules::NDI::get().getLoadedNDI();
 	const auto result = ndi.recv_capture_v3(
 		m_impl,
 		&static_cast<NDIlib_video_frame_v2_t&>(frame),
@@ -111,7 +117,7 @@ Recv::FrameType	Recv::capture(VideoFrame& frame, uint32_t timeo) const noexcept
 }
 
 void Recv::free(VideoFrame& frame) const noexcept {
-	const auto& ndi = Modules::NDI::get().getNDI();
+	const auto& ndi = Modules::NDI::get().getLoadedNDI();
 	ndi.recv_free_video_v2(
 		m_impl,
 		&static_cast<NDIlib_video_frame_v2_t&>(frame)
@@ -121,9 +127,37 @@ void Recv::free(VideoFrame& frame) const noexcept {
 
 
 bool Recv::setTally(bool pgm, bool pvw) noexcept {
-	const auto& ndi = Modules::NDI::get().getNDI();
+	const auto& ndi = Modules::NDI::get().getLoadedNDI();
 	const NDIlib_tally_t tally(pgm, pvw);
 	return ndi.recv_set_tally(m_impl, &tally);
 }
 
+
+
+void Recv::getPerformance(Performance* total, Performance* dropped) const noexcept {
+	const auto& ndi = Modules::NDI::get().getLoadedNDI();
+	NDIlib_recv_performance_t ndiTotal;
+	NDIlib_recv_performance_t ndiDropped;
+	ndi.recv_get_performance(m_impl, &ndiTotal, &ndiDropped);
+
+	if(total) {
+		*total = Performance{ ndiTotal.video_frames, ndiTotal.audio_frames, ndiTotal.metadata_frames };
+	}
+	if(dropped) {
+		*dropped = Performance{ ndiDropped.video_frames, ndiDropped.audio_frames, ndiDropped.metadata_frames };
+	}
+}
+
+Recv::Queue Recv::getQueue() const noexcept {
+	const auto& ndi = Modules::NDI::get().getLoadedNDI();
+	NDIlib_recv_queue_t queue;
+	ndi.recv_get_queue(m_impl, &queue);
+	return Queue{ queue.video_frames, queue.audio_frames, queue.metadata_frames };
+}
+
+int32_t Recv::getConnectionCount() const noexcept {
+	const auto& ndi = Modules::NDI::get().getLoadedNDI();
+	return ndi.recv_get_no_connections(m_impl);
+}
+
 }
\ No newline at end of file
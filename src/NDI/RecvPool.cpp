@@ -0,0 +1,139 @@
+#include <zuazo/NDI/RecvPool.h>
+
+#include "../Hostname.h"
+
+#include <cassert>
+
+namespace Zuazo::NDI {
+
+static Recv createStandbyReceiver(const Source& source, Recv::Bandwidth bandwidth) {
+	//Get receiver name
+	auto recvIdentifier = getHostname();
+	recvIdentifier += " (standby)";
+
+	return Recv(
+		source,
+		Recv::ColorFormat::BEST, //Must match the one used by Sources::NDI
+		bandwidth,
+		true, //Must match the one used by Sources::NDI
+		recvIdentifier.c_str()
+	);
+}
+
+
+
+RecvPool::RecvPool() = default;
+
+RecvPool::~RecvPool() = default;
+
+
+
+void RecvPool::addSource(const Source& source, Recv::Bandwidth bandwidth) {
+	auto key = getKey(source);
+
+	//Check if it is already pooled
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_entries.count(key)) {
+			return;
+		}
+	}
+
+	//Create the entry in an unlocked environment, as connecting may take a while
+	Entry entry = {
+		bandwidth,
+		createStandbyReceiver(source, bandwidth)
+	};
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries.emplace(std::move(key), std::move(entry)); //No-op if someone inserted it meanwhile
+}
+
+void RecvPool::removeSource(const Source& source) {
+	Recv removed(nullptr);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const auto ite = m_entries.find(getKey(source));
+		if(ite != m_entries.cend()) {
+			removed = std::move(ite->second.standby);
+			m_entries.erase(ite);
+		}
+	}
+
+	//Receiver gets destroyed here, in an unlocked environment
+}
+
+void RecvPool::clear() {
+	Entries removed;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		removed = std::move(m_entries);
+		m_entries.clear();
+	}
+
+	//Receivers get destroyed here, in an unlocked environment
+}
+
+
+bool RecvPool::isPooled(const Source& source) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.count(getKey(source));
+}
+
+size_t RecvPool::size() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.size();
+}
+
+
+RecvPool::Standby RecvPool::acquire(const Source& source) {
+	Standby result(Recv(nullptr), Recv::Bandwidth::HIGHEST);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const auto ite = m_entries.find(getKey(source));
+	if(ite != m_entries.cend()) {
+		//Take over the receiver. It will be empty if someone else owns it
+		result.first = std::move(ite->second.standby);
+		result.second = ite->second.bandwidth;
+	}
+
+	return result;
+}
+
+void RecvPool::release(const Source& source, Recv recv) {
+	if(!recv) {
+		return;
+	}
+
+	//Clear the tally, as it does not belong to any element anymore
+	recv.setTally(false, false);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const auto ite = m_entries.find(getKey(source));
+	if(ite != m_entries.cend() && !ite->second.standby) {
+		//Put it back into standby
+		ite->second.standby = std::move(recv);
+	}
+
+	//If it was not accepted, receiver gets destroyed here
+}
+
+
+
+std::string RecvPool::getKey(const Source& source) {
+	//Sources are identified by their name. Fallback to the URL
+	const auto* name = source.getName();
+	const auto* url = source.getURL();
+
+	if(name && *name) {
+		return std::string(name);
+	} else if(url) {
+		return std::string(url);
+	} else {
+		return std::string();
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include <zuazo/NDI/Sampler.h>
+
+namespace Zuazo::NDI {
+
+Sampler::Sampler()
+	: m_mutex()
+	, m_changed()
+	, m_interval(DEFAULT_INTERVAL)
+	, m_exit(false)
+	, m_callbackMutex()
+	, m_callbacks()
+	, m_thread()
+{
+}
+
+Sampler::~Sampler() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exit = true;
+	}
+	m_changed.notify_all();
+
+	if(m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+
+
+void Sampler::setInterval(std::chrono::milliseconds interval) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_interval = interval;
+	}
+	m_changed.notify_all();
+}
+
+std::chrono::milliseconds Sampler::getInterval() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_interval;
+}
+
+
+
+Sampler::Handle Sampler::subscribe(Callback callback) {
+	Handle result;
+	{
+		std::lock_guard<std::mutex> lock(m_callbackMutex);
+		result = m_callbacks.emplace(m_callbacks.cend(), std::move(callback));
+	}
+
+	//Start sampling on the first subscription
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(!m_thread.joinable()) {
+		m_thread = std::thread(&Sampler::threadFunc, this);
+	}
+
+	return result;
+}
+
+void Sampler::unsubscribe(Handle handle) {
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	m_callbacks.erase(handle);
+}
+
+
+
+void Sampler::threadFunc() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto next = std::chrono::steady_clock::now() + m_interval;
+
+	while(!m_exit) {
+		//Wake up early if the interval changes, so that it is applied
+		if(m_changed.wait_until(lock, next) == std::cv_status::no_timeout) {
+			next = std::chrono::steady_clock::now() + m_interval;
+			continue;
+		}
+		next += m_interval;
+
+		lock.unlock();
+		{
+			std::lock_guard<std::mutex> callbackLock(m_callbackMutex);
+			for(const auto& callback : m_callbacks) {
+				callback();
+			}
+		}
+		lock.lock();
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,253 @@
+#include <zuazo/NDI/SourceCache.h>
+
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+
+namespace Zuazo::NDI {
+
+SourceCache::SourceCache()
+	: m_mutex()
+	, m_path()
+	, m_entries()
+	, m_dirty(false)
+	, m_lastSave()
+	, m_saveMutex()
+	, m_discovery(nullptr)
+	, m_discoveryHandle()
+	, m_callbackMutex()
+	, m_callbacks()
+{
+}
+
+SourceCache::~SourceCache() {
+	detach();
+	flush(true);
+}
+
+
+
+void SourceCache::setPath(std::string path) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_path = std::move(path);
+	}
+
+	//Merge the persisted entries with the ones already known
+	load();
+}
+
+const std::string& SourceCache::getPath() const noexcept {
+	return m_path;
+}
+
+
+void SourceCache::attach(Discovery& discovery) {
+	detach();
+
+	m_discovery = &discovery;
+	m_discoveryHandle = m_discovery->subscribe(
+		[this] (Discovery::Event event, const Discovery::EntryRef& entry) {
+			assert(entry);
+
+			//Removed sources are kept, as they are likely to come back
+			//at the same location
+			if(event != Discovery::Event::REMOVED) {
+				update(entry->getName(), entry->getURL());
+			}
+		}
+	);
+
+	//Sources may have been already discovered
+	for(const auto& entry : m_discovery->getSources()) {
+		update(entry->getName(), entry->getURL());
+	}
+	flush(true);
+}
+
+void SourceCache::detach() {
+	if(m_discovery) {
+		m_discovery->unsubscribe(m_discoveryHandle);
+		m_discovery = nullptr;
+		flush(true); //Batched changes
+	}
+}
+
+
+std::string SourceCache::lookup(std::string_view name) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const auto ite = m_entries.find(std::string(name));
+	return (ite != m_entries.cend()) ? ite->second : std::string();
+}
+
+void SourceCache::update(std::string_view name, std::string_view url) {
+	if(name.empty() || url.empty()) {
+		return; //Nothing to remember
+	}
+
+	bool moved;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto& entry = m_entries[std::string(name)];
+		if(entry == url) {
+			return; //Already up to date
+		}
+
+		//Newly learnt sources have not moved. Nobody is connected
+		//to their old location
+		moved = !entry.empty();
+		entry = url;
+		m_dirty = true;
+	}
+
+	flush(false);
+
+	//Notify in an unlocked environment, so that the cache can be queried
+	if(moved) {
+		notify(std::string(name), std::string(url));
+	}
+}
+
+void SourceCache::remove(std::string_view name) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(!m_entries.erase(std::string(name))) {
+			return;
+		}
+		m_dirty = true;
+	}
+
+	flush(false);
+}
+
+void SourceCache::clear() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_entries.clear();
+		m_dirty = true;
+	}
+
+	flush(false);
+}
+
+size_t SourceCache::size() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.size();
+}
+
+
+bool SourceCache::load() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_path.empty()) {
+		return false;
+	}
+
+	std::ifstream file(m_path);
+	if(!file) {
+		return false;
+	}
+
+	//Each line contains a name and its URL, separated by a tab
+	std::string line;
+	while(std::getline(file, line)) {
+		const auto separator = line.find('\t');
+		if(separator == std::string::npos || separator == 0 || separator + 1 == line.size()) {
+			continue; //Malformed line
+		}
+
+		//Entries learnt from the discovery are more recent
+		m_entries.emplace(line.substr(0, separator), line.substr(separator + 1));
+	}
+
+	return true;
+}
+
+bool SourceCache::save() const {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_dirty = true; //Written even if up to date
+	}
+
+	return flush(true);
+}
+
+
+SourceCache::Handle SourceCache::subscribe(Callback callback) {
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	return m_callbacks.insert(m_callbacks.cend(), std::move(callback));
+}
+
+void SourceCache::unsubscribe(Handle handle) {
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	m_callbacks.erase(handle);
+}
+
+
+
+bool SourceCache::flush(bool force) const {
+	//Serialized, so that an older snapshot never replaces a newer one
+	std::lock_guard<std::mutex> saveLock(m_saveMutex);
+
+	//Written from a snapshot, so that lookups and updates are
+	//not blocked by the file system
+	std::string path;
+	Entries entries;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const auto now = Clock::now();
+		if(m_path.empty() || !m_dirty) {
+			return false; //Not persistent or nothing to write
+		}
+		if(!force && now - m_lastSave < std::chrono::milliseconds(SAVE_INTERVAL)) {
+			return false; //Batched with the following changes
+		}
+
+		path = m_path;
+		entries = m_entries;
+		m_dirty = false;
+		m_lastSave = now;
+	}
+
+	if(!write(path, entries)) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_dirty = true; //Retried on the next change
+		return false;
+	}
+
+	return true;
+}
+
+bool SourceCache::write(const std::string& path, const Entries& entries) {
+	//Write to a temporary file and replace the old one, so that
+	//a crash never leaves a truncated cache
+	const auto tmpPath = path + ".tmp";
+	{
+		std::ofstream file(tmpPath, std::ios::trunc);
+		if(!file) {
+			return false;
+		}
+
+		for(const auto& entry : entries) {
+			file << entry.first << '\t' << entry.second << '\n';
+		}
+
+		file.flush();
+		if(!file) {
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+	}
+
+	return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+void SourceCache::notify(const std::string& name, const std::string& url) {
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	for(const auto& callback : m_callbacks) {
+		if(callback) {
+			callback(name, url);
+		}
+	}
+}
+
+}
\ No newline at end of file
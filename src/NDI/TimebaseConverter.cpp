@@ -0,0 +1,136 @@
+#include <zuazo/NDI/TimebaseConverter.h>
+
+#include "Channels.h"
+#include "Kernels.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace Zuazo::NDI {
+
+TimebaseConverter::TimebaseConverter(Mode mode)
+	: m_mode(mode)
+	, m_outputPeriod(0)
+	, m_output()
+	, m_outputData()
+	, m_lastTime(-1)
+	, m_time(0)
+	, m_hasTime(false)
+{
+}
+
+
+
+void TimebaseConverter::setMode(Mode mode) noexcept {
+	if(m_mode != mode) {
+		m_mode = mode;
+		reset();
+	}
+}
+
+TimebaseConverter::Mode TimebaseConverter::getMode() const noexcept {
+	return m_mode;
+}
+
+
+void TimebaseConverter::setOutputPeriod(int64_t period) noexcept {
+	m_outputPeriod = period;
+}
+
+int64_t TimebaseConverter::getOutputPeriod() const noexcept {
+	return m_outputPeriod;
+}
+
+
+
+uint32_t TimebaseConverter::process(const VideoFrame& frame, const VideoFrame& previous) {
+	//Returns the weight of the frame when blending it with the previous one
+	const auto currentTime = getTime(frame);
+	if(!frame.getData() || m_mode == Mode::NEAREST || m_outputPeriod <= 0 || currentTime < 0) {
+		return FULL_WEIGHT;
+	}
+
+	//The same frame may be delivered several times when the output
+	//rate is higher. Only correct the estimation when a new one arrives
+	const auto isNewFrame = currentTime != m_lastTime;
+	m_lastTime = currentTime;
+
+	const auto previousTime = getTime(previous);
+	const auto isSameLayout =
+		previous.getData() &&
+		previous.getResolution() == frame.getResolution() &&
+		previous.getFourCC() == frame.getFourCC() &&
+		previous.getStride() == frame.getStride() ;
+	if(!isSameLayout || previousTime < 0 || currentTime <= previousTime) {
+		return FULL_WEIGHT; //Not enough history yet
+	}
+
+	//Estimate the current time of the source, advancing at the output 
+	//rate. It is slowly corrected with the arrival of new frames, so that
+	//it does not drift. Resynchronize if it is too far away
+	const auto interval = currentTime - previousTime;
+	m_time += m_outputPeriod;
+	if(isNewFrame) {
+		const auto error = currentTime - m_time;
+		if(!m_hasTime || error > interval || error < -interval) {
+			m_time = currentTime;
+			m_hasTime = true;
+		} else {
+			m_time += error / 8; //Smooth out the jitter
+		}
+	}
+
+	//Output a source frame behind, so that it lays between the last two
+	const auto outputTime = m_time - interval;
+	const auto elapsed = std::clamp<int64_t>(outputTime - previousTime, 0, interval);
+	return static_cast<uint32_t>(std::min<int64_t>((elapsed << 16) / interval, FULL_WEIGHT));
+}
+
+const VideoFrame& TimebaseConverter::blend(const VideoFrame& frame, const VideoFrame& previous, uint32_t weight) {
+	//Used when the frames can not be blended while converting them
+	if(weight >= FULL_WEIGHT) {
+		return frame;
+	}
+
+	//Prepare the output frame with the same layout
+	m_outputData.resize(getFrameSize(frame));
+	m_output = frame;
+	m_output.setData(m_outputData.data());
+
+	const auto previousPlanes = getPlanes(previous);
+	const auto currentPlanes = getPlanes(frame);
+	const auto dstPlanes = getPlanes(m_output);
+	for(size_t i = 0; i < dstPlanes.size(); ++i) {
+		if(dstPlanes[i]) {
+			blendPlane(previousPlanes[i], currentPlanes[i], dstPlanes[i], weight);
+		}
+	}
+
+	return m_output;
+}
+
+void TimebaseConverter::reset() noexcept {
+	m_lastTime = -1;
+	m_hasTime = false;
+}
+
+
+
+int64_t TimebaseConverter::getTime(const VideoFrame& frame) noexcept {
+	//Prefer the timestamp, as the timecode may be synthesized 
+	//by the receiver. Undefined timestamps are set to the maximum
+	constexpr auto undefined = std::numeric_limits<int64_t>::max();
+	const auto timestamp = frame.getTimestamp();
+	const auto timecode = frame.getTimecode();
+
+	if(timestamp != undefined && timestamp != 0) {
+		return timestamp;
+	} else if(timecode != undefined) {
+		return timecode;
+	} else {
+		return -1;
+	}
+}
+
+}
\ No newline at end of file
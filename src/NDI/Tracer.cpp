@@ -0,0 +1,332 @@
+#include <zuazo/NDI/Tracer.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+
+#include <pthread.h>
+
+namespace Zuazo::NDI {
+
+/*
+ * Tracer::Ring
+ */
+
+struct Tracer::Ring {
+	//Every field is atomic, so that slots can be read while they are
+	//being overwritten. The sequence tells if the read was consistent
+	struct Slot {
+		std::atomic<uint64_t>				sequence;	//2n+1 while writing the nth event, 2n+2 when done
+		std::atomic<uint64_t>				begin;		//Since the origin, in nanoseconds
+		std::atomic<uint64_t>				duration;	//In nanoseconds
+		std::atomic<int64_t>				timestamp;	//NDI timestamp, in 100ns units
+		std::atomic<uint64_t>				info;		//Event type on the high half, source on the low half
+	};
+
+	struct Entry {
+		uint64_t							begin;
+		uint64_t							duration;
+		int64_t								timestamp;
+		Event								event;
+		uint32_t							source;
+	};
+
+	Ring(size_t capacity, uint32_t threadId, std::string threadName)
+		: slots(new Slot[capacity])
+		, mask(capacity - 1)
+		, head(0)
+		, tail(0)
+		, threadId(threadId)
+		, threadName(std::move(threadName))
+	{
+		assert((capacity & mask) == 0); //Power of 2
+		for(size_t i = 0; i < capacity; ++i) {
+			slots[i].sequence.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	void push(uint64_t begin, uint64_t duration, int64_t timestamp, Event event, uint32_t source) noexcept {
+		//Only written by its thread
+		const auto n = head.load(std::memory_order_relaxed);
+		auto& slot = slots[n & mask];
+
+		slot.sequence.store(2*n + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.begin.store(begin, std::memory_order_relaxed);
+		slot.duration.store(duration, std::memory_order_relaxed);
+		slot.timestamp.store(timestamp, std::memory_order_relaxed);
+		slot.info.store((static_cast<uint64_t>(event) << 32) | source, std::memory_order_relaxed);
+		slot.sequence.store(2*n + 2, std::memory_order_release);
+
+		head.store(n + 1, std::memory_order_release);
+	}
+
+	void read(std::vector<Entry>& result) const {
+		const auto last = head.load(std::memory_order_acquire);
+		const auto capacity = mask + 1;
+		auto first = std::max(tail.load(std::memory_order_relaxed), (last > capacity) ? last - capacity : 0);
+
+		for(auto n = first; n < last; ++n) {
+			const auto& slot = slots[n & mask];
+
+			const auto sequence = slot.sequence.load(std::memory_order_acquire);
+			const Entry entry = {
+				slot.begin.load(std::memory_order_relaxed),
+				slot.duration.load(std::memory_order_relaxed),
+				slot.timestamp.load(std::memory_order_relaxed),
+				static_cast<Event>(slot.info.load(std::memory_order_relaxed) >> 32),
+				static_cast<uint32_t>(slot.info.load(std::memory_order_relaxed))
+			};
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			//Discard the ones overwritten meanwhile
+			if(sequence == 2*n + 2 && slot.sequence.load(std::memory_order_relaxed) == sequence) {
+				result.push_back(entry);
+			}
+		}
+	}
+
+	void clear() noexcept {
+		tail.store(head.load(std::memory_order_acquire), std::memory_order_relaxed);
+	}
+
+	std::unique_ptr<Slot[]>				slots;
+	size_t								mask;
+	std::atomic<uint64_t>				head;
+	std::atomic<uint64_t>				tail;	//Events before it have been cleared
+
+	uint32_t							threadId;
+	std::string							threadName;
+};
+
+
+
+/*
+ * Tracer
+ */
+
+static std::atomic<uint64_t> s_tracerCount(0);
+
+static size_t getTracerCapacity(size_t capacity) noexcept {
+	//Round up to a power of 2, so that indices can be masked
+	size_t result = 1;
+	while(result < capacity) {
+		result <<= 1;
+	}
+	return result;
+}
+
+static void writeTracerString(std::ostream& os, std::string_view str) {
+	os << '"';
+	for(const auto c : str) {
+		switch(c) {
+		case '"':	os << "\\\""; break;
+		case '\\':	os << "\\\\"; break;
+		default:
+			if(static_cast<unsigned char>(c) < 0x20) {
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+				os << escaped;
+			} else {
+				os << c;
+			}
+			break;
+		}
+	}
+	os << '"';
+}
+
+Tracer::Tracer(size_t capacity)
+	: m_id(++s_tracerCount)
+	, m_capacity(getTracerCapacity(capacity))
+	, m_origin(Clock::now())
+	, m_enabled(false)
+	, m_path()
+	, m_mutex()
+	, m_rings()
+	, m_sources()
+{
+}
+
+Tracer::~Tracer() = default;
+
+
+
+void Tracer::setEnabled(bool enabled) noexcept {
+	m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Tracer::isEnabled() const noexcept {
+	return m_enabled.load(std::memory_order_relaxed);
+}
+
+
+void Tracer::setPath(std::string path) {
+	m_path = std::move(path);
+}
+
+const std::string& Tracer::getPath() const noexcept {
+	return m_path;
+}
+
+
+uint32_t Tracer::getSourceId(std::string_view name) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	//Sources are few, a linear search is enough
+	const auto ite = std::find(m_sources.cbegin(), m_sources.cend(), name);
+	if(ite != m_sources.cend()) {
+		return static_cast<uint32_t>(std::distance(m_sources.cbegin(), ite));
+	}
+
+	m_sources.emplace_back(name);
+	return static_cast<uint32_t>(m_sources.size() - 1);
+}
+
+
+void Tracer::record(Event event,
+					uint32_t source,
+					Clock::time_point begin,
+					Clock::time_point end,
+					int64_t timestamp ) noexcept
+{
+	if(isEnabled()) {
+		auto* ring = getRing();
+		if(ring) {
+			ring->push(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(begin - m_origin).count(),
+				std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count(),
+				timestamp,
+				event,
+				source
+			);
+		}
+	}
+}
+
+void Tracer::record(Event event,
+					uint32_t source,
+					Clock::time_point time,
+					int64_t timestamp ) noexcept
+{
+	record(event, source, time, time, timestamp);
+}
+
+void Tracer::clear() noexcept {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for(const auto& ring : m_rings) {
+		ring->clear();
+	}
+}
+
+
+void Tracer::write(std::ostream& os) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	//Durations are written as complete events, instants as thread scoped
+	//instant events. Timestamps are expressed in microseconds
+	const auto flags = os.flags();
+	const auto precision = os.precision();
+	os << std::fixed << std::setprecision(3); //Nanosecond resolution
+	os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+	bool first = true;
+	const auto separate = [&os, &first] {
+		if(!first) os << ",\n";
+		first = false;
+	};
+
+	std::vector<Ring::Entry> entries;
+	for(const auto& ring : m_rings) {
+		separate();
+		os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->threadId << ",\"args\":{\"name\":";
+		writeTracerString(os, ring->threadName);
+		os << "}}";
+
+		entries.clear();
+		ring->read(entries);
+		for(const auto& entry : entries) {
+			separate();
+			os << "{\"name\":";
+			writeTracerString(os, getEventName(entry.event));
+			os << ",\"cat\":\"ndi\"";
+			if(entry.event == Event::FORMAT_CHANGE) {
+				os << ",\"ph\":\"i\",\"s\":\"t\"";
+			} else {
+				os << ",\"ph\":\"X\",\"dur\":" << entry.duration / 1e3;
+			}
+			os << ",\"ts\":" << entry.begin / 1e3;
+			os << ",\"pid\":1,\"tid\":" << ring->threadId;
+			os << ",\"args\":{\"source\":";
+			writeTracerString(os, entry.source < m_sources.size() ? std::string_view(m_sources[entry.source]) : std::string_view());
+			os << ",\"timestamp\":" << entry.timestamp << "}}";
+		}
+	}
+
+	os << "\n]}\n";
+	os.flags(flags);
+	os.precision(precision);
+}
+
+bool Tracer::dump() const {
+	return dump(m_path);
+}
+
+bool Tracer::dump(const std::string& path) const {
+	std::ofstream file(path, std::ios::trunc);
+	if(!file) {
+		return false;
+	}
+
+	write(file);
+	return static_cast<bool>(file);
+}
+
+
+std::string_view Tracer::getEventName(Event event) noexcept {
+	switch(event) {
+	case Event::CAPTURE:		return "capture";
+	case Event::FORMAT_CHANGE:	return "format change";
+	case Event::ACQUIRE:		return "acquire";
+	case Event::COPY:			return "copy";
+	case Event::FLUSH:			return "flush";
+	case Event::PUSH:			return "push";
+	case Event::FREE:			return "free";
+	default:					return "";
+	}
+}
+
+
+
+Tracer::Ring* Tracer::getRing() noexcept {
+	//Rings are owned by the tracer, so that they outlive their
+	//threads. The cached pointer is only valid for the same tracer
+	struct Cache {
+		uint64_t	tracerId = 0;
+		Ring*		ring = nullptr;
+	};
+	thread_local Cache cache;
+
+	if(cache.tracerId != m_id) {
+		try {
+			char threadName[16] = {};
+			pthread_getname_np(pthread_self(), threadName, sizeof(threadName));
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			const auto threadId = static_cast<uint32_t>(m_rings.size() + 1);
+			auto ring = std::make_shared<Ring>(m_capacity, threadId, threadName);
+			cache.ring = ring.get();
+			cache.tracerId = m_id;
+			m_rings.push_back(std::move(ring));
+		} catch(...) {
+			//Out of memory. Events of this thread are lost
+			return nullptr;
+		}
+	}
+
+	return cache.ring;
+}
+
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include <zuazo/NDI/VideoFrame.h>
 
+#include <cassert>
 #include <cstddef>
 #include "../Processing.NDI/Processing.NDI.Lib.h"
 
@@ -145,8 +146,9 @@ std::byte* VideoFrame::getData() const noexcept {
 VideoFrame::SlicedData VideoFrame::getSlicedData() const noexcept {
 	SlicedData result = {};
 
+	//Stride is expressed in bytes and refers to the first plane
 	const auto data = getData();
-	const auto planeSize = getStride()*getResolution().width;
+	const auto planeSize = getStride()*getResolution().height;
 
 	switch(getFourCC()) {
 	case FourCC::BGRX:
@@ -155,45 +157,42 @@ VideoFrame::SlicedData VideoFrame::getSlicedData() const noexcept {
 	case FourCC::RGBA:
 	case FourCC::UYVY:
 		result = {
-			SlicedData::value_type(data, planeSize*sizeof(uint8_t))
+			SlicedData::value_type(data, planeSize)
 		};
 		break;
 
 	case FourCC::UYVA:
+		//Alpha plane has half of the stride
 		result = {
-			SlicedData::value_type(data + 0*planeSize*sizeof(uint8_t), planeSize*sizeof(uint8_t)),
-			SlicedData::value_type(data + 1*planeSize*sizeof(uint8_t), planeSize*sizeof(uint8_t) / 2),
+			SlicedData::value_type(data, planeSize),
+			SlicedData::value_type(data + planeSize, planeSize / 2),
 		};
 		break;
 
 	case FourCC::YV12:
 	case FourCC::I420:
+		//Chroma planes have half of the stride and height
 		result = {
-			SlicedData::value_type(data, planeSize*sizeof(uint8_t)),
-			SlicedData::value_type(data + planeSize*sizeof(uint8_t),  planeSize*sizeof(uint8_t) / 4),
-			SlicedData::value_type(data + planeSize*sizeof(uint8_t) + planeSize*sizeof(uint8_t) / 4, planeSize*sizeof(uint8_t) / 4),
+			SlicedData::value_type(data, planeSize),
+			SlicedData::value_type(data + planeSize, planeSize / 4),
+			SlicedData::value_type(data + planeSize + planeSize / 4, planeSize / 4),
 		};
 		break;
 	
 	case FourCC::NV12:
-		result = {
-			SlicedData::value_type(data + 0*planeSize*sizeof(uint8_t), planeSize*sizeof(uint8_t)),
-			SlicedData::value_type(data + 1*planeSize*sizeof(uint8_t), planeSize*sizeof(uint8_t)),
-		};
-		break;
-
 	case FourCC::P216:
+		//Chroma plane has the same stride
 		result = {
-			SlicedData::value_type(data + 0*planeSize*sizeof(uint16_t), planeSize*sizeof(uint16_t)),
-			SlicedData::value_type(data + 1*planeSize*sizeof(uint16_t), planeSize*sizeof(uint16_t)),
+			SlicedData::value_type(data, planeSize),
+			SlicedData::value_type(data + planeSize, planeSize * (getFourCC() == FourCC::NV12 ? 1 : 2) / 2),
 		};
 		break;	
 
 	case FourCC::PA16:
 		result = {
-			SlicedData::value_type(data + 0*planeSize*sizeof(uint16_t), planeSize*sizeof(uint16_t)),
-			SlicedData::value_type(data + 1*planeSize*sizeof(uint16_t), planeSize*sizeof(uint16_t)),
-			SlicedData::value_type(data + 2*planeSize*sizeof(uint16_t), planeSize*sizeof(uint16_t) / 2),
+			SlicedData::value_type(data + 0*planeSize, planeSize),
+			SlicedData::value_type(data + 1*planeSize, planeSize),
+			SlicedData::value_type(data + 2*planeSize, planeSize),
 		};
 		break;
 
@@ -1,16 +1,22 @@
 #include <zuazo/Sources/NDI.h>
 
+#include "NDIReceiver.h"
 #include "../Hostname.h"
 
 #include <zuazo/NDI/Recv.h>
-#include <zuazo/NDI/FrameSync.h>
 #include <zuazo/NDI/Conversions.h>
-#include <zuazo/Graphics/StagedFramePool.h>
+#include <zuazo/NDI/Tracer.h>
+#include <zuazo/Modules/NDI.h>
 #include <zuazo/Signal/Output.h>
 
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <utility>
 #include <memory>
+#include <vector>
 
 namespace Zuazo::Sources {
 
@@ -19,138 +25,413 @@ namespace Zuazo::Sources {
  */
 
 struct NDIImpl {
-	struct Open {
-		typedef void (*copy_fn)(const Zuazo::NDI::VideoFrame&, Zuazo::Graphics::StagedFrame&);
-
-		Zuazo::NDI::Recv							receiver;
-		Zuazo::NDI::FrameSync						frameSync;
-		Zuazo::NDI::VideoFrame						ndiFrame;
-		std::unique_ptr<Graphics::StagedFramePool>	framePool;
-		std::shared_ptr<Graphics::StagedFrame>		uploadedFrame;
-		copy_fn										copyCallback;
+	using Deinterlacing = NDI::Deinterlacing;
+	using Region = Zuazo::NDI::Region;
+	using Timebase = NDI::Timebase;
+	static constexpr size_t DECIMATION_COUNT = static_cast<size_t>(NDI::Decimation::COUNT);
+	static constexpr size_t STAGE_COUNT = static_cast<size_t>(NDI::Stage::COUNT);
 
+	using Clock = std::chrono::steady_clock;
+	using Latencies = std::array<Zuazo::NDI::LatencyHistogram, STAGE_COUNT>;
 
-		Open(	Zuazo::NDI::Source source, 
+	struct Open {
+		std::string									receiverName;
+		std::shared_ptr<NDIReceiver>				receiver;
+		NDIReceiver::Handle							subscription;
+		Zuazo::NDI::VideoFrame						ndiFrame;
+		std::shared_ptr<NDIReceiver::Upload>		upload;
+		Deinterlacing								deinterlacing;
+		bool										fieldRate;
+		NDIReceiver::Field							field;
+		std::array<bool, DECIMATION_COUNT>			decimations;
+		Region										crop;
+		bool										premultiply;
+		bool										analysis;
+		Timebase									timebase;
+		int64_t										outputPeriod;
+		Latencies*									latencies;
+		const std::atomic<bool>*					latenciesEnabled;
+		bool										measuring;
+		Clock::time_point							captureTime;
+		Video										lastVideo;
+		uint32_t									traceSource;
+
+
+		Open(	const NDI::Source& source, 
 				const std::string& name,
-				bool pgmTally, bool pvwTally)
-			: receiver(createReceiver(source, name))
-			, frameSync(receiver)
+				bool pgmTally, bool pvwTally,
+				Zuazo::NDI::Recv::Bandwidth bandwidth,
+				Deinterlacing deinterlacing,
+				bool fieldRate,
+				const std::array<bool, DECIMATION_COUNT>& decimations,
+				const Region& crop,
+				bool premultiply,
+				bool analysis,
+				Timebase timebase )
+			: receiverName(createReceiverName(name))
+			, receiver(NDIReceiver::get(source, receiverName))
+			, subscription(receiver->subscribe(pgmTally, pvwTally, bandwidth, wantsFields(deinterlacing)))
 			, ndiFrame()
-			, framePool()
-			, uploadedFrame()
-			, copyCallback(nullptr)
+			, upload()
+			, deinterlacing(deinterlacing)
+			, fieldRate(fieldRate)
+			, field(NDIReceiver::Field::FIELD0)
+			, decimations(decimations)
+			, crop(crop)
+			, premultiply(premultiply)
+			, analysis(analysis)
+			, timebase(timebase)
+			, outputPeriod(0)
+			, latencies(nullptr)
+			, latenciesEnabled(nullptr)
+			, measuring(false)
+			, captureTime()
+			, lastVideo()
+			, traceSource(getTraceSource(source))
 		{
-			receiver.setTally(pgmTally, pvwTally);
 		}
 
-		~Open() = default;
+		~Open() {
+			lastVideo.reset();
+			setUpload(nullptr);
+			receiver->unsubscribe(subscription);
+		}
 
-		VideoMode getSupportedVideoMode(const Graphics::Vulkan& vulkan) {
+		std::vector<VideoMode> getSupportedVideoModes(const Graphics::Vulkan& vulkan) const {
 			//Convert everything
-			const auto frameRate = ndiFrame.getFrameRate();
-			const auto resolution = ndiFrame.getResolution();
-			const auto pixelAspectRatio = getPixelAspectRatio(resolution, ndiFrame.getPictureAspectRatio());
-			const auto [ycbcrColorModel, colorPrimaries] = getColorimetry(resolution);
-			const auto [colorFormat, colorSubsampling, colorModel] = fromFourCC(ndiFrame.getFourCC(), ycbcrColorModel);
+			const auto fourCC = ndiFrame.getFourCC();
+			const auto frameRate = isFieldRate() ? ndiFrame.getFrameRate() * Math::Rational<int>(2, 1) : ndiFrame.getFrameRate();
+			const auto frameResolution = ndiFrame.getResolution();
+			const auto resolution = getRegion().resolution; //Cropping does not alter the pixels
+			const auto pixelAspectRatio = getPixelAspectRatio(frameResolution, ndiFrame.getPictureAspectRatio());
+			const auto colorimetry = Zuazo::NDI::getColorimetry(frameResolution);
 			constexpr auto colorTransferFunction = ColorTransferFunction::bt1886; //Equivalent for 601, 709, 2020
-			constexpr auto colorRange = ColorRange::ituNarrowFullAlpha;
 
-			//TODO add alternative formats
+			//Rank all the formats the frames can be converted to. Alpha
+			//preserving formats go first. Ties keep the preference order
+			auto targets = std::vector<Zuazo::NDI::ConversionTarget>(
+				Zuazo::NDI::getConversionTargets(fourCC).begin(),
+				Zuazo::NDI::getConversionTargets(fourCC).end()
+			);
+			const auto srcHasAlpha = Zuazo::NDI::hasAlpha(fourCC);
+			std::stable_sort(
+				targets.begin(), targets.end(),
+				[fourCC, resolution, srcHasAlpha] (const auto& a, const auto& b) -> bool {
+					const auto aKeepsAlpha = !srcHasAlpha || hasAlpha(a.first);
+					const auto bKeepsAlpha = !srcHasAlpha || hasAlpha(b.first);
+					if(aKeepsAlpha != bKeepsAlpha) {
+						return aKeepsAlpha;
+					}
+
+					const auto aCost = Zuazo::NDI::estimateConversionCost(fourCC, resolution, a.first, a.second);
+					const auto bCost = Zuazo::NDI::estimateConversionCost(fourCC, resolution, b.first, b.second);
+					return aCost.cpu + aCost.upload < bCost.cpu + bCost.upload;
+				}
+			);
+
+			//When blending, frames can be output at any rate
+			const auto frameRateLimit = (timebase == Timebase::BLEND) ? 
+				Utils::Limit<Rate>(Utils::Any<Rate>()) :
+				Utils::Limit<Rate>(Utils::MustBe<Rate>(frameRate)) ;
+
+			//Advertise the ones supported by the GPU
 			const auto formatCompatibility = Graphics::StagedFrame::getSupportedFormats(vulkan);
-			return VideoMode(
-				Utils::MustBe<Rate>(frameRate),
-				Utils::MustBe<Resolution>(resolution),
-				Utils::MustBe<AspectRatio>(pixelAspectRatio),
-				Utils::MustBe<ColorPrimaries>(colorPrimaries),
-				Utils::MustBe<ColorModel>(colorModel),
-				Utils::MustBe<ColorTransferFunction>(colorTransferFunction),
-				Utils::MustBe<ColorSubsampling>(colorSubsampling),
-				Utils::MustBe<ColorRange>(colorRange),
-				formatCompatibility.intersect(Utils::MustBe<ColorFormat>(colorFormat))
+			std::vector<VideoMode> result;
+			result.reserve(targets.size());
+			for(const auto& target : targets) {
+				//RGB frames are always full range
+				const auto isRGB = isRGBFormat(target.first);
+				const auto colorModel = isRGB ? ColorModel::rgb : colorimetry.model;
+				const auto colorRange = isRGB ? ColorRange::full : colorimetry.range;
+
+				VideoMode videoMode(
+					frameRateLimit,
+					Utils::MustBe<Resolution>(resolution),
+					Utils::MustBe<AspectRatio>(pixelAspectRatio),
+					Utils::MustBe<ColorPrimaries>(colorimetry.primaries),
+					Utils::MustBe<ColorModel>(colorModel),
+					Utils::MustBe<ColorTransferFunction>(colorTransferFunction),
+					Utils::MustBe<ColorSubsampling>(target.second),
+					Utils::MustBe<ColorRange>(colorRange),
+					formatCompatibility.intersect(Utils::MustBe<ColorFormat>(target.first))
+				);
+
+				if(static_cast<bool>(videoMode)) {
+					result.emplace_back(std::move(videoMode));
+				}
+			}
+
+			return result;
+		}
+
+		Zuazo::NDI::ConversionCost estimateConversionCost(const VideoMode& videoMode) const {
+			const auto descriptor = videoMode.getFrameDescriptor();
+			return Zuazo::NDI::estimateConversionCost(
+				ndiFrame.getFourCC(),
+				getRegion().resolution,
+				descriptor.getColorFormat(),
+				descriptor.getColorSubsampling()
 			);
 		}
 
 		void recreate(	const Graphics::Vulkan& vulkan, 
-						const Graphics::Frame::Descriptor& desc )
+						const Graphics::Frame::Descriptor& desc,
+						Rate rate )
 		{
-			if(framePool) {
-				*framePool = Graphics::StagedFramePool(vulkan, desc);
-			} else {
-				framePool = Utils::makeUnique<Graphics::StagedFramePool>(vulkan, desc);
-			}
+			//Timestamps are expressed in 100ns units
+			using TimestampDuration = std::chrono::duration<int64_t, std::ratio<1, 10000000>>;
+			outputPeriod = std::chrono::duration_cast<TimestampDuration>(getPeriod(rate)).count();
 
-			copyCallback = selectCopyFunction(ndiFrame.getFourCC(), desc.getColorFormat());
+			setUpload(receiver->getUpload(vulkan, desc, ndiFrame.getFourCC(), crop, deinterlacing, premultiply, timebase, outputPeriod));
 		}
 
 		void recreate() {
-			framePool.reset();
-			copyCallback = nullptr;
+			setUpload(nullptr);
+		}
+
+		void setSource(	const NDI::Source& src,
+						bool pgmTally, bool pvwTally,
+						Zuazo::NDI::Recv::Bandwidth bandwidth )
+		{
+			//Subscribe to the new source before leaving the old one,
+			//so that a shared receiver is not destroyed in between
+			auto newReceiver = NDIReceiver::get(src, receiverName);
+			const auto newSubscription = newReceiver->subscribe(pgmTally, pvwTally, bandwidth, wantsFields(deinterlacing));
+
+			//Migrate the upload with the same parameters
+			auto newUpload = upload ? newReceiver->getUpload(upload->vulkan, upload->descriptor, upload->fourCC, crop, deinterlacing, premultiply, timebase, outputPeriod) : nullptr;
+			setUpload(nullptr);
+
+			receiver->unsubscribe(subscription);
+			receiver = std::move(newReceiver);
+			subscription = newSubscription;
+			setUpload(std::move(newUpload));
+			traceSource = getTraceSource(src);
+		}
+
+		void setTally(bool pgm, bool pvw) {
+			receiver->setTally(subscription, pgm, pvw);
+		}
+
+		void setBandwidth(Zuazo::NDI::Recv::Bandwidth bandwidth) {
+			receiver->setBandwidth(subscription, bandwidth);
+		}
+
+		void setDeinterlacing(Deinterlacing mode) {
+			deinterlacing = mode;
+			receiver->setFields(subscription, wantsFields(deinterlacing));
+
+			//Deinterlacer lives in the upload
+			if(upload) {
+				setUpload(receiver->getUpload(upload->vulkan, upload->descriptor, upload->fourCC, crop, deinterlacing, premultiply, timebase, outputPeriod));
+			}
 		}
 
-		void setSource(const Zuazo::NDI::Source& src) {
-			receiver.connect(src);
+		void setDecimation(size_t index, bool enabled) {
+			if(decimations[index] != enabled) {
+				decimations[index] = enabled;
+
+				if(upload) {
+					if(enabled) {
+						receiver->enableDecimation(*upload, getDecimationFactor(index));
+					} else {
+						receiver->disableDecimation(*upload, getDecimationFactor(index));
+					}
+				}
+			}
+		}
+
+		void setFieldRate(bool enabled) {
+			fieldRate = enabled;
+		}
+
+		void setCrop(const Region& region) {
+			crop = region;
+
+			//Crop is applied by the upload
+			if(upload) {
+				setUpload(receiver->getUpload(upload->vulkan, upload->descriptor, upload->fourCC, crop, deinterlacing, premultiply, timebase, outputPeriod));
+			}
+		}
+
+		void setPremultiply(bool enabled) {
+			premultiply = enabled;
+
+			//Premultiplication is done by the upload
+			if(upload) {
+				setUpload(receiver->getUpload(upload->vulkan, upload->descriptor, upload->fourCC, crop, deinterlacing, premultiply, timebase, outputPeriod));
+			}
+		}
+
+		void setAnalysis(bool enabled) {
+			if(analysis != enabled) {
+				analysis = enabled;
+
+				if(upload) {
+					if(analysis) {
+						receiver->enableAnalysis(*upload);
+					} else {
+						receiver->disableAnalysis(*upload);
+					}
+				}
+			}
+		}
+
+		Zuazo::NDI::Analyzer::Result getAnalysis() const {
+			//Computed by the upload
+			return upload ? receiver->getAnalysis(*upload) : Zuazo::NDI::Analyzer::Result{};
+		}
+
+		NDI::Statistics getStatistics() const {
+			//Sampled by the receiver
+			return receiver->getStatistics();
+		}
+
+		void setTimebase(Timebase mode) {
+			timebase = mode;
+
+			//Timebase conversion is done by the upload
+			if(upload) {
+				setUpload(receiver->getUpload(upload->vulkan, upload->descriptor, upload->fourCC, crop, deinterlacing, premultiply, timebase, outputPeriod));
+			}
+		}
+
+		Region getRegion() const noexcept {
+			return Zuazo::NDI::getEffectiveRegion(crop, ndiFrame.getResolution());
 		}
 
 		bool pullFrame() {
+			//At field rate, the second field of the last frame is shown
+			//before pulling a new one
+			if(isFieldRate() && field == NDIReceiver::Field::FIELD0) {
+				field = NDIReceiver::Field::FIELD1;
+				return false;
+			}
+			field = NDIReceiver::Field::FIELD0;
+
 			//Preserve a copy to check if it changes
 			const auto prevFrame = ndiFrame;
 
-			//If there is data associated to the last frame, free it
-			if(ndiFrame.getData()) {
-				frameSync.free(ndiFrame);
+			//Obtain the latest frame from the (maybe shared) receiver.
+			//Time is only measured when requested. The flag is sampled
+			//once, so that the whole frame is measured or not
+			measuring = latenciesEnabled->load(std::memory_order_relaxed);
+			const auto t0 = measuring ? Clock::now() : Clock::time_point();
+			ndiFrame = receiver->pull(subscription);
+			if(measuring) {
+				captureTime = Clock::now();
+				record(NDI::Stage::CAPTURE, captureTime - t0);
 			}
 
-			//Write a new frame to it
-			frameSync.capture(ndiFrame, Zuazo::NDI::VideoFrame::Format::PROGRESSIVE);
-
-			//Force uploading
-			uploadedFrame.reset();
-
 			//Check if the parameters have changed
 			return 	prevFrame.getResolution() != ndiFrame.getResolution() ||
 					prevFrame.getFourCC() != ndiFrame.getFourCC() ||
 					prevFrame.getFrameRate() != ndiFrame.getFrameRate() ||
-					prevFrame.getPictureAspectRatio() != ndiFrame.getPictureAspectRatio() ;
+					prevFrame.getPictureAspectRatio() != ndiFrame.getPictureAspectRatio() ||
+					prevFrame.getFormat() != ndiFrame.getFormat() ;
+		}
+
+		bool isFieldRate() const noexcept {
+			//Only interlaced frames being interpolated can be output at field rate
+			return 	fieldRate &&
+					ndiFrame.getFormat() == Zuazo::NDI::VideoFrame::Format::INTERLEAVED &&
+					(deinterlacing == Deinterlacing::BOB || deinterlacing == Deinterlacing::MOTION_ADAPTIVE);
+		}
+
+		bool canKeepVideoMode() const {
+			//The negotiated mode can be kept as long as the frames
+			//can be scaled into it
+			return 	upload &&
+					(	!ndiFrame.getData() || 
+						Zuazo::NDI::canResample(ndiFrame.getFourCC(), upload->descriptor.getColorFormat()) );
 		}
 
 		Video uploadFrame() {
-			//Only upload if valid and modified
-			if(!uploadedFrame && framePool && ndiFrame.getData()) {
-				uploadedFrame = framePool->acquireFrame();
-				assert(uploadedFrame);
-				
-				//In order to copy "normally"
-				assert(ndiFrame.getFormat() == Zuazo::NDI::VideoFrame::Format::PROGRESSIVE);
-
-				//Copy the data from one frame to the other
-				assert(copyCallback);
-				copyCallback(ndiFrame, *uploadedFrame);
-				uploadedFrame->flush();
-
-				//Its data is not needed anymore. Return it
-				frameSync.free(ndiFrame);
-			} else if(!framePool) {
-				uploadedFrame.reset();
+			//Frames are only converted once for all the elements sharing the upload
+			auto result = upload ? receiver->upload(*upload, field) : Video();
+
+			if(measuring) {
+				//Timings are only meaningful when a new frame has been converted
+				if(result && result != lastVideo) {
+					const auto& timings = upload->timings;
+					record(NDI::Stage::ACQUIRE, timings.acquire);
+					record(NDI::Stage::COPY, timings.copy);
+					record(NDI::Stage::FLUSH, timings.flush);
+					record(NDI::Stage::QUEUE, Clock::now() - captureTime);
+				}
+				lastVideo = result;
+			} else {
+				lastVideo.reset();
 			}
 
-			return uploadedFrame;
+			return result;
+		}
+
+		void setLatencies(Latencies* lat, const std::atomic<bool>* enabled) {
+			latencies = lat;
+			latenciesEnabled = enabled;
+			measuring = false;
+			lastVideo.reset();
+		}
+
+		Video uploadDecimatedFrame(size_t index) {
+			//Computed alongside the main frame
+			return (upload && decimations[index]) ? receiver->uploadDecimated(*upload, field, getDecimationFactor(index)) : Video();
 		}
 
 	private:
-		static Zuazo::NDI::Recv createReceiver(Zuazo::NDI::Source source, const std::string& name) {
+		void setUpload(std::shared_ptr<NDIReceiver::Upload> newUpload) {
+			//Decimations and analysis are requested on a per-upload basis. 
+			//Enable them on the new one before releasing the old one
+			if(newUpload) {
+				for(size_t i = 0; i < decimations.size(); ++i) {
+					if(decimations[i]) {
+						receiver->enableDecimation(*newUpload, getDecimationFactor(i));
+					}
+				}
+				if(analysis) {
+					receiver->enableAnalysis(*newUpload);
+				}
+			}
+
+			if(upload) {
+				for(size_t i = 0; i < decimations.size(); ++i) {
+					if(decimations[i]) {
+						receiver->disableDecimation(*upload, getDecimationFactor(i));
+					}
+				}
+				if(analysis) {
+					receiver->disableAnalysis(*upload);
+				}
+			}
+
+			upload = std::move(newUpload);
+		}
+
+		void record(NDI::Stage stage, Clock::duration duration) noexcept {
+			assert(latencies);
+			(*latencies)[static_cast<size_t>(stage)].record(
+				std::chrono::duration_cast<Zuazo::NDI::LatencyHistogram::Duration>(duration)
+			);
+		}
+
+		static uint32_t getTraceSource(const NDI::Source& source) {
+			//Same as the receiver's
+			auto& tracer = Modules::NDI::get().getTracer();
+			return tracer.getSourceId(source.getName().empty() ? source.getURL() : source.getName());
+		}
+
+		static uint32_t getDecimationFactor(size_t index) noexcept {
+			return 2U << index; //2, 4
+		}
+
+		static std::string createReceiverName(const std::string& name) {
 			//Get receiver name
 			auto recvIdentifier = getHostname();
 			recvIdentifier += " (";
 			recvIdentifier += name;
 			recvIdentifier += ")";
-
-			return Zuazo::NDI::Recv(
-				source,
-				Zuazo::NDI::Recv::ColorFormat::BEST, //TODO maybe choose between fastest/best
-				Zuazo::NDI::Recv::Bandwidth::HIGHEST, //TODO maybe choose between lowest/highest
-				false,
-				recvIdentifier.c_str()
-			);
+			return recvIdentifier;
 		}
 
 		static AspectRatio getPixelAspectRatio(Resolution res, float dar) {
@@ -167,82 +448,24 @@ struct NDIImpl {
 			return result;
 		}
 
-		static std::tuple<ColorModel, ColorPrimaries> getColorimetry(Resolution res) {
-			//This has been elaborated according to the NDI SDK doc.
-			std::tuple<ColorModel, ColorPrimaries> result;
-
-			if(res.x>1920 || res.y>1080) {
-				result = { ColorModel::bt2020, ColorPrimaries::bt2020 };
-			} else if(res.x>720 || res.y>576) {
-				result = { ColorModel::bt709, ColorPrimaries::bt709 };
-			} else {
-				result = { ColorModel::bt601, ColorPrimaries::bt601_625 };
-			}
-
-			return result;
+		static bool wantsFields(Deinterlacing deinterlacing) noexcept {
+			return deinterlacing != Deinterlacing::NONE;
 		}
 
-		static copy_fn selectCopyFunction(FourCC src, ColorFormat dst) {
-			copy_fn result = nullptr;
-
-			switch(src) {
-			case FourCC::RGBA:
-			case FourCC::RGBX:
-				assert(dst == ColorFormat::R8G8B8A8);
-				result = Zuazo::NDI::copyRGBA;
-				break;
-
-			case FourCC::BGRA:
-			case FourCC::BGRX:
-				assert(dst == ColorFormat::B8G8R8A8);
-				result = Zuazo::NDI::copyRGBA;
-				break;
-
-			case FourCC::UYVY:
-				if(dst == ColorFormat::B8G8R8G8) {
-					result = Zuazo::NDI::copyUYVY;
-				} else { 
-					assert(dst == ColorFormat::G8_B8R8);
-					result = Zuazo::NDI::copyUYVYtoNV16;
-				}
-				break;
-
-			case FourCC::UYVA:
-				assert(dst == ColorFormat::G8_B8R8_A8);
-				result = Zuazo::NDI::copyUYVAtoPA8;
-				break;
-
-			case FourCC::P216:
-				assert(dst == ColorFormat::G8_B8R8);
-				result = Zuazo::NDI::copyP216;
-				break;
-
-			case FourCC::PA16:
-				assert(dst == ColorFormat::G8_B8R8_A8);
-				result = Zuazo::NDI::copyPA16;
-				break;
-
-			case FourCC::I420:
-				assert(dst == ColorFormat::G8_B8_R8);
-				result = Zuazo::NDI::copyI420;
-				break;
-
-			case FourCC::YV12:
-				assert(dst == ColorFormat::G8_B8_R8);
-				result = Zuazo::NDI::copyYV12toI420;
-				break;
-
-			case FourCC::NV12:
-				assert(dst == ColorFormat::G8_B8R8);
-				result = Zuazo::NDI::copyNV12;
-				break;
-
+		static bool hasAlpha(ColorFormat format) noexcept {
+			switch(format) {
+			case ColorFormat::G8_B8R8_A8:
+			case ColorFormat::G16_B16R16_A16:
+			case ColorFormat::R8G8B8A8:
+			case ColorFormat::B8G8R8A8:
+				return true;
 			default:
-				break;
+				return false;
 			}
+		}
 
-			assert(result);
-			return result;
+		static bool isRGBFormat(ColorFormat format) noexcept {
+			return format == ColorFormat::R8G8B8A8 || format == ColorFormat::B8G8R8A8;
 		}
 	};
 
@@ -251,19 +474,46 @@ struct NDIImpl {
 	std::reference_wrapper<NDI>	owner;
 
 	Output						videoOut;
+	std::array<Output, DECIMATION_COUNT> decimatedOuts;
 
 	NDI::Source					source;
 	bool						pgmTally;
 	bool						pvwTally;
+	Zuazo::NDI::Recv::Bandwidth	bandwidth;
+	bool						videoModeLocked;
+	Deinterlacing				deinterlacing;
+	bool						fieldRate;
+	std::array<bool, DECIMATION_COUNT> decimatedOutputs;
+	Region						crop;
+	bool						premultipliedAlpha;
+	bool						analysis;
+	Timebase					timebase;
+	std::unique_ptr<Latencies>	latencies; //Allocated for the whole lifetime, as Open records into them
+	std::atomic<bool>			latenciesEnabled;
 
 	std::unique_ptr<Open>		opened;
 
 	NDIImpl(NDI& ndi, NDI::Source source)
 		: owner(ndi)
 		, videoOut(ndi, std::string(Signal::makeOutputName<Video>()))
+		, decimatedOuts{
+			Output(ndi, std::string(NDI::getDecimatedOutputName(NDI::Decimation::HALF))),
+			Output(ndi, std::string(NDI::getDecimatedOutputName(NDI::Decimation::QUARTER)))
+		}
 		, source(std::move(source))
 		, pgmTally(false)
 		, pvwTally(false)
+		, bandwidth(Zuazo::NDI::Recv::Bandwidth::HIGHEST)
+		, videoModeLocked(false)
+		, deinterlacing(Deinterlacing::NONE)
+		, fieldRate(false)
+		, decimatedOutputs{}
+		, crop{}
+		, premultipliedAlpha(false)
+		, analysis(false)
+		, timebase(Timebase::NEAREST)
+		, latencies(Utils::makeUnique<Latencies>())
+		, latenciesEnabled(false)
 		, opened()
 	{
 	}
@@ -274,6 +524,9 @@ struct NDIImpl {
 	void moved(ZuazoBase& base) {
 		owner = static_cast<NDI&>(base);
 		videoOut.setLayout(base);
+		for(auto& output : decimatedOuts) {
+			output.setLayout(base);
+		}
 	}
 
 	void open(ZuazoBase& base, std::unique_lock<Instance>* lock = nullptr) {
@@ -286,14 +539,26 @@ struct NDIImpl {
 		auto newOpened = Utils::makeUnique<Open>(
 			source,
 			ndiSrc.getName(),
-			pgmTally, pvwTally
+			pgmTally, pvwTally,
+			bandwidth,
+			deinterlacing,
+			fieldRate,
+			decimatedOutputs,
+			crop,
+			premultipliedAlpha,
+			analysis,
+			timebase
 		);
 		if(lock) lock->lock();
 
 		//Write changes after locking back
 		opened = std::move(newOpened);
+		opened->setLatencies(latencies.get(), &latenciesEnabled);
 		ndiSrc.enableRegularUpdate(Instance::sourcePriority); //At this moment we do not know the rate
 		videoOut.setPullCallback(std::bind(&NDIImpl::pullCallback, this));
+		for(size_t i = 0; i < decimatedOuts.size(); ++i) {
+			decimatedOuts[i].setPullCallback(std::bind(&NDIImpl::decimatedPullCallback, this, i));
+		}
 
 		assert(opened);
 	}
@@ -311,12 +576,18 @@ struct NDIImpl {
 		
 		//Remove all possible calls to update
 		videoOut.setPullCallback(Output::PullCallback());
+		for(auto& output : decimatedOuts) {
+			output.setPullCallback(Output::PullCallback());
+		}
 		ndiSrc.disablePeriodicUpdate();
 		ndiSrc.disableRegularUpdate();
 		ndiSrc.setVideoModeCompatibility({});
 
 		//Write changes
 		videoOut.reset();
+		for(auto& output : decimatedOuts) {
+			output.reset();
+		}
 		auto oldOpened = std::move(opened);
 
 		//Reset in a unlocked environment
@@ -339,10 +610,11 @@ struct NDIImpl {
 		//When update is called, a new frame will be pulled from the source
 		assert(opened);
 		if(opened->pullFrame()) {
-			//Videomode has changed. Update it
-			auto& ndiSrc = owner.get();
-			const auto& vulkan = ndiSrc.getInstance().getVulkan();
-			ndiSrc.setVideoModeCompatibility({ opened->getSupportedVideoMode(vulkan) });
+			//Videomode has changed. Update it, unless it is locked
+			//and frames can be scaled into the current one
+			if(!videoModeLocked || !opened->canKeepVideoMode()) {
+				updateVideoModeCompatibility();
+			}
 		}
 	}
 
@@ -357,7 +629,7 @@ struct NDIImpl {
 
 			if(static_cast<bool>(videoMode)) {
 				//The videomode is valid
-				opened->recreate(ndiSrc.getInstance().getVulkan(), videoMode.getFrameDescriptor());
+				opened->recreate(ndiSrc.getInstance().getVulkan(), videoMode.getFrameDescriptor(), videoMode.getFrameRateValue());
 				ndiSrc.enablePeriodicUpdate(Instance::sourcePriority, getPeriod(videoMode.getFrameRateValue()));
 			} else {
 				//Reset the uploader
@@ -371,7 +643,7 @@ struct NDIImpl {
 		this->source = std::move(source);
 
 		if(opened) {
-			opened->setSource(this->source);
+			opened->setSource(this->source, pgmTally, pvwTally, bandwidth);
 		}
 	}
 
@@ -385,7 +657,7 @@ struct NDIImpl {
 			pgmTally = tally;
 
 			if(opened) {
-				opened->receiver.setTally(pgmTally, pvwTally);
+				opened->setTally(pgmTally, pvwTally);
 			}
 		}
 	}
@@ -400,7 +672,7 @@ struct NDIImpl {
 			pvwTally = tally;
 
 			if(opened) {
-				opened->receiver.setTally(pgmTally, pvwTally);
+				opened->setTally(pgmTally, pvwTally);
 			}
 		}
 	}
@@ -410,11 +682,217 @@ struct NDIImpl {
 	}
 
 
+	void setBandwidth(Zuazo::NDI::Recv::Bandwidth bw) {
+		if(bandwidth != bw) {
+			bandwidth = bw;
+
+			if(opened) {
+				opened->setBandwidth(bandwidth);
+			}
+		}
+	}
+
+	Zuazo::NDI::Recv::Bandwidth getBandwidth() const noexcept {
+		return bandwidth;
+	}
+
+
+	void setVideoModeLocked(bool locked) {
+		if(videoModeLocked != locked) {
+			videoModeLocked = locked;
+
+			if(opened && !videoModeLocked) {
+				//Advertise the actual video mode of the source
+				updateVideoModeCompatibility();
+			}
+		}
+	}
+
+	bool getVideoModeLocked() const noexcept {
+		return videoModeLocked;
+	}
+
+
+	void setDeinterlacing(Deinterlacing mode) {
+		if(deinterlacing != mode) {
+			deinterlacing = mode;
+
+			if(opened) {
+				opened->setDeinterlacing(deinterlacing);
+				updateVideoModeCompatibility(); //Frame rate may change
+			}
+		}
+	}
+
+	Deinterlacing getDeinterlacing() const noexcept {
+		return deinterlacing;
+	}
+
+
+	void setFieldRate(bool enabled) {
+		if(fieldRate != enabled) {
+			fieldRate = enabled;
+
+			if(opened) {
+				opened->setFieldRate(fieldRate);
+				updateVideoModeCompatibility(); //Frame rate may change
+			}
+		}
+	}
+
+	bool getFieldRate() const noexcept {
+		return fieldRate;
+	}
+
+
+	void setDecimatedOutputEnabled(NDI::Decimation decimation, bool enabled) {
+		const auto index = static_cast<size_t>(decimation);
+		assert(index < decimatedOutputs.size());
+
+		if(decimatedOutputs[index] != enabled) {
+			decimatedOutputs[index] = enabled;
+
+			if(opened) {
+				opened->setDecimation(index, enabled);
+			}
+		}
+	}
+
+	bool getDecimatedOutputEnabled(NDI::Decimation decimation) const noexcept {
+		const auto index = static_cast<size_t>(decimation);
+		assert(index < decimatedOutputs.size());
+		return decimatedOutputs[index];
+	}
+
+
+	void setCrop(const Region& region) {
+		if(crop != region) {
+			crop = region;
+
+			if(opened) {
+				opened->setCrop(crop);
+				updateVideoModeCompatibility(); //Resolution may change
+			}
+		}
+	}
+
+	const Region& getCrop() const noexcept {
+		return crop;
+	}
+
+
+	void setAlphaPremultiplied(bool enabled) {
+		if(premultipliedAlpha != enabled) {
+			premultipliedAlpha = enabled;
+
+			if(opened) {
+				opened->setPremultiply(premultipliedAlpha);
+			}
+		}
+	}
+
+	bool getAlphaPremultiplied() const noexcept {
+		return premultipliedAlpha;
+	}
+
+
+	void setAnalysisEnabled(bool enabled) {
+		if(analysis != enabled) {
+			analysis = enabled;
+
+			if(opened) {
+				opened->setAnalysis(analysis);
+			}
+		}
+	}
+
+	bool getAnalysisEnabled() const noexcept {
+		return analysis;
+	}
+
+	Zuazo::NDI::Analyzer::Result getAnalysis() const {
+		return opened ? opened->getAnalysis() : Zuazo::NDI::Analyzer::Result{};
+	}
+
+
+	void setTimebaseConversion(Timebase mode) {
+		if(timebase != mode) {
+			timebase = mode;
+
+			if(opened) {
+				opened->setTimebase(timebase);
+				updateVideoModeCompatibility(); //Frame rate may change
+			}
+		}
+	}
+
+	Timebase getTimebaseConversion() const noexcept {
+		return timebase;
+	}
+
+
+	Zuazo::NDI::ConversionCost estimateConversionCost(const VideoMode& videoMode) const {
+		return opened ? opened->estimateConversionCost(videoMode) : Zuazo::NDI::ConversionCost{0, 0};
+	}
+
+
+	void setLatencyStatisticsEnabled(bool enabled) {
+		//Histograms are never swapped, as the pull callback
+		//might be recording into them. Only the flag is toggled
+		if(latenciesEnabled.exchange(enabled, std::memory_order_relaxed) != enabled && enabled) {
+			//Start afresh
+			resetLatencyStatistics();
+		}
+	}
+
+	bool getLatencyStatisticsEnabled() const noexcept {
+		return latenciesEnabled.load(std::memory_order_relaxed);
+	}
+
+	Zuazo::NDI::LatencyHistogram::Summary getLatency(NDI::Stage stage) const noexcept {
+		const auto index = static_cast<size_t>(stage);
+		assert(index < STAGE_COUNT);
+		return getLatencyStatisticsEnabled() ? (*latencies)[index].getSummary() : Zuazo::NDI::LatencyHistogram::Summary{};
+	}
+
+	NDI::Statistics getStatistics() const {
+		return opened ? opened->getStatistics() : NDI::Statistics{};
+	}
+
+	void resetLatencyStatistics() noexcept {
+		for(auto& histogram : *latencies) {
+			histogram.reset();
+		}
+	}
+
+
 private:
+	void updateVideoModeCompatibility() {
+		assert(opened);
+		auto& ndiSrc = owner.get();
+		const auto& vulkan = ndiSrc.getInstance().getVulkan();
+		ndiSrc.setVideoModeCompatibility(opened->getSupportedVideoModes(vulkan));
+	}
+
 	void pullCallback() {
 		//Only upload when needed
 		assert(opened);
-		videoOut.push(opened->uploadFrame());
+		auto frame = opened->uploadFrame();
+
+		auto& tracer = Modules::NDI::get().getTracer();
+		if(tracer.isEnabled()) {
+			const auto t0 = Clock::now();
+			videoOut.push(std::move(frame));
+			const auto t1 = Clock::now();
+			tracer.record(Zuazo::NDI::Tracer::Event::PUSH, opened->traceSource, t0, t1, opened->ndiFrame.getTimestamp());
+		} else {
+			videoOut.push(std::move(frame));
+		}
+	}
+
+	void decimatedPullCallback(size_t index) {
+		assert(opened);
+		decimatedOuts[index].push(opened->uploadDecimatedFrame(index));
 	}
 
 };
@@ -432,7 +910,11 @@ NDI::NDI(	Instance& instance,
 	, ZuazoBase(
 		instance, 
 		std::move(name),
-		PadRef((*this)->videoOut),
+		{ 
+			PadRef((*this)->videoOut), 
+			PadRef((*this)->decimatedOuts[0]), 
+			PadRef((*this)->decimatedOuts[1]) 
+		},
 		std::bind(&NDIImpl::moved, std::ref(**this), std::placeholders::_1),
 		std::bind(&NDIImpl::open, std::ref(**this), std::placeholders::_1, nullptr),
 		std::bind(&NDIImpl::asyncOpen, std::ref(**this), std::placeholders::_1, std::placeholders::_2),
@@ -479,4 +961,135 @@ bool NDI::getPreviewTally() const noexcept {
 	return (*this)->getPreviewTally();
 }
 
+
+void NDI::setBandwidth(Zuazo::NDI::Recv::Bandwidth bandwidth) {
+	(*this)->setBandwidth(bandwidth);
+}
+
+Zuazo::NDI::Recv::Bandwidth NDI::getBandwidth() const noexcept {
+	return (*this)->getBandwidth();
+}
+
+
+void NDI::setVideoModeLocked(bool locked) {
+	(*this)->setVideoModeLocked(locked);
+}
+
+bool NDI::getVideoModeLocked() const noexcept {
+	return (*this)->getVideoModeLocked();
+}
+
+
+void NDI::setDeinterlacing(Deinterlacing mode) {
+	(*this)->setDeinterlacing(mode);
+}
+
+NDI::Deinterlacing NDI::getDeinterlacing() const noexcept {
+	return (*this)->getDeinterlacing();
+}
+
+
+void NDI::setFieldRate(bool enabled) {
+	(*this)->setFieldRate(enabled);
+}
+
+bool NDI::getFieldRate() const noexcept {
+	return (*this)->getFieldRate();
+}
+
+
+void NDI::setDecimatedOutputEnabled(Decimation decimation, bool enabled) {
+	(*this)->setDecimatedOutputEnabled(decimation, enabled);
+}
+
+bool NDI::getDecimatedOutputEnabled(Decimation decimation) const noexcept {
+	return (*this)->getDecimatedOutputEnabled(decimation);
+}
+
+std::string_view NDI::getDecimatedOutputName(Decimation decimation) noexcept {
+	switch(decimation) {
+	case Decimation::HALF:		return "videoOutHalf";
+	case Decimation::QUARTER:	return "videoOutQuarter";
+	default:					return "";
+	}
+}
+
+
+void NDI::setCrop(const Zuazo::NDI::Region& region) {
+	(*this)->setCrop(region);
+}
+
+const Zuazo::NDI::Region& NDI::getCrop() const noexcept {
+	return (*this)->getCrop();
+}
+
+
+void NDI::setAlphaPremultiplied(bool enabled) {
+	(*this)->setAlphaPremultiplied(enabled);
+}
+
+bool NDI::getAlphaPremultiplied() const noexcept {
+	return (*this)->getAlphaPremultiplied();
+}
+
+
+void NDI::setAnalysisEnabled(bool enabled) {
+	(*this)->setAnalysisEnabled(enabled);
+}
+
+bool NDI::getAnalysisEnabled() const noexcept {
+	return (*this)->getAnalysisEnabled();
+}
+
+Zuazo::NDI::Analyzer::Result NDI::getAnalysis() const {
+	return (*this)->getAnalysis();
+}
+
+
+void NDI::setTimebaseConversion(Timebase mode) {
+	(*this)->setTimebaseConversion(mode);
+}
+
+NDI::Timebase NDI::getTimebaseConversion() const noexcept {
+	return (*this)->getTimebaseConversion();
+}
+
+
+Zuazo::NDI::ConversionCost NDI::estimateConversionCost(const VideoMode& videoMode) const {
+	return (*this)->estimateConversionCost(videoMode);
+}
+
+
+void NDI::setLatencyStatisticsEnabled(bool enabled) {
+	(*this)->setLatencyStatisticsEnabled(enabled);
+}
+
+bool NDI::getLatencyStatisticsEnabled() const noexcept {
+	return (*this)->getLatencyStatisticsEnabled();
+}
+
+Zuazo::NDI::LatencyHistogram::Summary NDI::getLatency(Stage stage) const noexcept {
+	return (*this)->getLatency(stage);
+}
+
+void NDI::resetLatencyStatistics() noexcept {
+	(*this)->resetLatencyStatistics();
+}
+
+std::string_view NDI::getStageName(Stage stage) noexcept {
+	switch(stage) {
+	case Stage::CAPTURE:	return "capture";
+	case Stage::ACQUIRE:	return "acquire";
+	case Stage::COPY:		return "copy";
+	case Stage::FLUSH:		return "flush";
+	case Stage::QUEUE:		return "queue";
+	default:				return "";
+	}
+}
+
+
+NDI::Statistics NDI::getStatistics() const {
+	return (*this)->getStatistics();
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,863 @@
+#include "NDIReceiver.h"
+
+#include <zuazo/NDI/Conversions.h>
+#include <zuazo/NDI/RecvPool.h>
+#include <zuazo/NDI/Tracer.h>
+#include <zuazo/NDI/PerfCounters.h>
+#include <zuazo/NDI/FlightRecorder.h>
+#include <zuazo/Modules/NDI.h>
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+
+namespace Zuazo::Sources {
+
+/*
+ * NDIReceiver::Decimation
+ */
+
+NDIReceiver::Decimation::Decimation(const Graphics::Vulkan& vulkan,
+									const Graphics::Frame::Descriptor& descriptor,
+									uint32_t factor )
+	: factor(factor)
+	, users(0)
+	, framePool(vulkan, descriptor)
+	, uploadedFrame()
+{
+}
+
+
+
+/*
+ * NDIReceiver::Upload
+ */
+
+NDIReceiver::Upload::Upload(const Graphics::Vulkan& vulkan,
+							const Graphics::Frame::Descriptor& descriptor,
+							FourCC fourCC,
+							const Region& crop,
+							Deinterlacing deinterlacing,
+							bool premultiply,
+							Timebase timebase,
+							int64_t outputPeriod )
+	: vulkan(vulkan)
+	, descriptor(descriptor)
+	, fourCC(fourCC)
+	, crop(crop)
+	, framePool(vulkan, descriptor)
+	, premultiply(premultiply)
+	, copyCallback(Zuazo::NDI::getCopyFunction(fourCC, descriptor.getColorFormat(), descriptor.getColorSubsampling(), premultiply))
+	, deinterlacer(deinterlacing)
+	, timebaseConverter(timebase)
+	, uploadedFrame()
+	, uploadedFrameCount(0)
+	, uploadedCaptureCount(0)
+	, uploadedField(Field::PROGRESSIVE)
+	, decimations()
+	, analysisUsers(0)
+	, analyzer()
+	, timings{}
+	, uploadSize(Zuazo::NDI::estimateConversionCost(fourCC, descriptor.getResolution(), descriptor.getColorFormat(), descriptor.getColorSubsampling()).upload)
+{
+	timebaseConverter.setOutputPeriod(outputPeriod);
+}
+
+
+
+/*
+ * NDIReceiver
+ */
+
+NDIReceiver::NDIReceiver(const NDI::Source& source, std::string name)
+	: m_source(source)
+	, m_receiverName(std::move(name))
+	, m_cached(false)
+	, m_cacheHandle()
+	, m_mutex()
+	, m_subscriptions()
+	, m_receiver()
+	, m_frameSync(nullptr)
+	, m_bandwidth(Bandwidth::HIGHEST)
+	, m_pendingReceiver(nullptr)
+	, m_pendingFrameSync(nullptr)
+	, m_pendingBandwidth(Bandwidth::HIGHEST)
+	, m_frame()
+	, m_previousFrame()
+	, m_frameCount(0)
+	, m_captureCount(0)
+	, m_captureFormat(Field::PROGRESSIVE)
+	, m_uploads()
+	, m_traceSource(Modules::NDI::get().getTracer().getSourceId(source.getName().empty() ? source.getURL() : source.getName()))
+	, m_recorderSource(Modules::NDI::get().getFlightRecorder().getSourceId(source.getName().empty() ? source.getURL() : source.getName()))
+	, m_statisticsMutex()
+	, m_statistics{}
+	, m_sampleTime(std::chrono::steady_clock::now())
+	, m_samplerHandle()
+	, m_metrics(std::make_shared<Zuazo::NDI::Exporter::Metrics>())
+	, m_exporterHandle()
+{
+	//Try to take over a standby receiver. Otherwise it will be
+	//created when the first subscription is made
+	auto& pool = Modules::NDI::get().getRecvPool();
+	auto [standby, standbyBandwidth] = pool.acquire(m_source);
+
+	if(standby) {
+		//Give it back when nobody uses it anymore. This might be
+		//done by the sampler, if it is reading its counters
+		m_receiver = std::shared_ptr<Zuazo::NDI::Recv>(
+			new Zuazo::NDI::Recv(std::move(standby)),
+			[source = m_source] (Zuazo::NDI::Recv* recv) {
+				Modules::NDI::get().getRecvPool().release(source, std::move(*recv));
+				delete recv;
+			}
+		);
+		m_frameSync = Zuazo::NDI::FrameSync(*m_receiver);
+		m_bandwidth = standbyBandwidth;
+	} else if(pool.isPooled(m_source)) {
+		//Someone else has taken the standby receiver
+		Modules::NDI::get().getFlightRecorder().record(Zuazo::NDI::FlightRecorder::Event::POOL_EXHAUSTED, m_recorderSource);
+	}
+
+	//When connecting by name, follow the URL changes learnt by the cache
+	if(m_source.getURL().empty() && !m_source.getName().empty()) {
+		auto& cache = Modules::NDI::get().getSourceCache();
+		m_cacheHandle = cache.subscribe(
+			[this] (const std::string& name, const std::string& url) {
+				if(name == m_source.getName()) {
+					reconnect(url);
+				}
+			}
+		);
+		m_cached = true;
+	}
+
+	//Statistics are gathered from the sampler's thread
+	auto& sampler = Modules::NDI::get().getSampler();
+	m_samplerHandle = sampler.subscribe(std::bind(&NDIReceiver::sample, this));
+
+	//Metrics are updated with atomics, so that they can be exported at any time
+	auto& exporter = Modules::NDI::get().getExporter();
+	m_exporterHandle = exporter.add(m_source.getName().empty() ? m_source.getURL() : m_source.getName(), m_metrics);
+}
+
+NDIReceiver::~NDIReceiver() {
+	assert(m_subscriptions.empty());
+
+	//Waits for any ongoing sample
+	auto& sampler = Modules::NDI::get().getSampler();
+	sampler.unsubscribe(m_samplerHandle);
+
+	auto& exporter = Modules::NDI::get().getExporter();
+	exporter.remove(m_exporterHandle);
+
+	if(m_cached) {
+		auto& cache = Modules::NDI::get().getSourceCache();
+		cache.unsubscribe(m_cacheHandle);
+	}
+
+	//Return the frames before destroying their owner
+	freeFrame(m_frame);
+	freeFrame(m_previousFrame);
+
+	//Destroy the frame-syncs before their receivers
+	m_pendingFrameSync = Zuazo::NDI::FrameSync(nullptr);
+	m_pendingReceiver = Zuazo::NDI::Recv(nullptr);
+	m_frameSync = Zuazo::NDI::FrameSync(nullptr);
+	releaseReceiver();
+}
+
+
+
+NDIReceiver::Handle NDIReceiver::subscribe(bool pgmTally, bool pvwTally, Bandwidth bandwidth, bool fields) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	//New subscribers will trigger a capture on their first pull
+	const Subscription subscription = {
+		pgmTally,
+		pvwTally,
+		bandwidth,
+		fields,
+		m_captureCount
+	};
+	const auto result = m_subscriptions.insert(m_subscriptions.cend(), subscription);
+
+	updateConnection();
+	return result;
+}
+
+void NDIReceiver::unsubscribe(Handle handle) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_subscriptions.erase(handle);
+	updateConnection();
+}
+
+
+void NDIReceiver::setTally(Handle handle, bool pgmTally, bool pvwTally) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	handle->pgmTally = pgmTally;
+	handle->pvwTally = pvwTally;
+	updateConnection();
+}
+
+void NDIReceiver::setBandwidth(Handle handle, Bandwidth bandwidth) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	handle->bandwidth = bandwidth;
+	updateConnection();
+}
+
+void NDIReceiver::setFields(Handle handle, bool fields) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	handle->fields = fields;
+	updateConnection();
+}
+
+
+Zuazo::NDI::VideoFrame NDIReceiver::pull(Handle handle) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	//Only capture a new frame if this subscriber has already seen
+	//the latest one. Otherwise, someone else has already captured
+	//it during this iteration
+	if(handle->lastCapture == m_captureCount) {
+		capture();
+	}
+
+	handle->lastCapture = m_captureCount;
+	return m_frame;
+}
+
+
+std::shared_ptr<NDIReceiver::Upload> NDIReceiver::getUpload(const Graphics::Vulkan& vulkan,
+															const Graphics::Frame::Descriptor& desc,
+															FourCC fourCC,
+															const Region& crop,
+															Deinterlacing deinterlacing,
+															bool premultiply,
+															Timebase timebase,
+															int64_t outputPeriod )
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	//Uploads are kept in least-recently-used order. Try to find one with the
+	//same parameters, so that conversion is only done once and pools are 
+	//not re-allocated when the source toggles between formats
+	const auto ite = std::find_if(
+		m_uploads.cbegin(), m_uploads.cend(),
+		[&vulkan, &desc, fourCC, &crop, deinterlacing, premultiply, timebase, outputPeriod] (const std::shared_ptr<Upload>& upload) -> bool {
+			return 	&upload->vulkan == &vulkan &&
+					upload->descriptor == desc &&
+					upload->fourCC == fourCC &&
+					upload->crop == crop &&
+					upload->deinterlacer.getMode() == deinterlacing &&
+					upload->premultiply == premultiply &&
+					upload->timebaseConverter.getMode() == timebase &&
+					upload->timebaseConverter.getOutputPeriod() == outputPeriod ;
+		}
+	);
+
+	if(ite != m_uploads.cend()) {
+		//Found it. Move it to the front
+		m_uploads.splice(m_uploads.cbegin(), m_uploads, ite);
+	} else {
+		//None was found, create a new one
+		m_uploads.emplace_front(std::make_shared<Upload>(vulkan, desc, fourCC, crop, deinterlacing, premultiply, timebase, outputPeriod));
+	}
+	auto result = m_uploads.front();
+	assert(result);
+
+	//Evict the least recently used idle uploads. The ones in use 
+	//by a subscriber are kept, as they're also referenced from there
+	size_t idleCount = 0;
+	for(auto uploadIte = m_uploads.cbegin(); uploadIte != m_uploads.cend(); ) {
+		const auto isIdle = uploadIte->use_count() == 1;
+		if(isIdle && ++idleCount > MAX_IDLE_UPLOADS) {
+			uploadIte = m_uploads.erase(uploadIte);
+		} else {
+			++uploadIte;
+		}
+	}
+
+	return result;
+}
+
+Video NDIReceiver::upload(Upload& upload, Field field) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uploadFrames(upload, field);
+	return upload.uploadedFrame;
+}
+
+
+void NDIReceiver::enableDecimation(Upload& upload, uint32_t factor) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto ite = std::find_if(
+		upload.decimations.begin(), upload.decimations.end(),
+		[factor] (const Decimation& decimation) -> bool {
+			return decimation.factor == factor;
+		}
+	);
+
+	if(ite == upload.decimations.end()) {
+		//Same format, keeping the size aligned to the chroma samples
+		auto descriptor = upload.descriptor;
+		const auto resolution = descriptor.getResolution();
+		descriptor.setResolution(Resolution(
+			(resolution.x / factor) & ~1U,
+			(resolution.y / factor) & ~1U
+		));
+
+		ite = upload.decimations.emplace(upload.decimations.end(), upload.vulkan, descriptor, factor);
+
+		//Force the next upload, so that it is also computed
+		upload.uploadedFrameCount = m_frameCount - 1;
+	}
+
+	++(ite->users);
+}
+
+void NDIReceiver::disableDecimation(Upload& upload, uint32_t factor) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	//Pools are kept for the lifetime of the upload, as the
+	//decimation is likely to be enabled again
+	for(auto& decimation : upload.decimations) {
+		if(decimation.factor == factor) {
+			assert(decimation.users > 0);
+			if(--decimation.users == 0) {
+				decimation.uploadedFrame.reset();
+			}
+		}
+	}
+}
+
+Video NDIReceiver::uploadDecimated(Upload& upload, Field field, uint32_t factor) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uploadFrames(upload, field);
+
+	Video result;
+	for(const auto& decimation : upload.decimations) {
+		if(decimation.factor == factor) {
+			result = decimation.uploadedFrame;
+		}
+	}
+
+	return result;
+}
+
+
+void NDIReceiver::enableAnalysis(Upload& upload) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if(upload.analysisUsers++ == 0) {
+		//Start from scratch, as frames may have been skipped
+		upload.analyzer.reset();
+	}
+}
+
+void NDIReceiver::disableAnalysis(Upload& upload) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	assert(upload.analysisUsers > 0);
+	--upload.analysisUsers;
+}
+
+NDIReceiver::Analysis NDIReceiver::getAnalysis(const Upload& upload) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return upload.analyzer.getResult();
+}
+
+
+
+NDIReceiver::Statistics NDIReceiver::getStatistics() const {
+	//Never contends with the capture
+	std::lock_guard<std::mutex> lock(m_statisticsMutex);
+	return m_statistics;
+}
+
+
+
+std::shared_ptr<NDIReceiver> NDIReceiver::get(const NDI::Source& source, const std::string& name) {
+	static std::mutex mutex;
+	static std::unordered_map<std::string, std::weak_ptr<NDIReceiver>> registry;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//Forget the receivers which no longer exist, so that the
+	//registry does not grow with every source ever opened
+	for(auto ite = registry.begin(); ite != registry.end(); ) {
+		ite = ite->second.expired() ? registry.erase(ite) : std::next(ite);
+	}
+
+	auto& entry = registry[getKey(source)];
+
+	auto result = entry.lock();
+	if(!result) {
+		//No one is receiving this source. Create a new receiver
+		result = std::make_shared<NDIReceiver>(source, name);
+		entry = result;
+	}
+
+	assert(result);
+	return result;
+}
+
+
+
+void NDIReceiver::updateConnection() {
+	//Combine the requirements of all the subscribers
+	bool pgmTally = false;
+	bool pvwTally = false;
+	bool fields = false;
+	auto bandwidth = Bandwidth::METADATA_ONLY;
+	for(const auto& subscription : m_subscriptions) {
+		pgmTally = pgmTally || subscription.pgmTally;
+		pvwTally = pvwTally || subscription.pvwTally;
+		fields = fields || subscription.fields;
+
+		if(getBandwidthRank(subscription.bandwidth) > getBandwidthRank(bandwidth)) {
+			bandwidth = subscription.bandwidth;
+		}
+	}
+
+	if(m_subscriptions.empty()) {
+		//Nothing to do, receiver will be destroyed soon
+	} else if(!m_receiver) {
+		//First subscription. Create the receiver right away
+		m_receiver = std::make_shared<Zuazo::NDI::Recv>(createReceiver(bandwidth));
+		m_frameSync = Zuazo::NDI::FrameSync(*m_receiver);
+		m_bandwidth = bandwidth;
+	} else if(bandwidth == m_bandwidth) {
+		//Current receiver is OK. Abort any pending change
+		m_pendingFrameSync = Zuazo::NDI::FrameSync(nullptr);
+		m_pendingReceiver = Zuazo::NDI::Recv(nullptr);
+	} else if(!m_pendingReceiver || bandwidth != m_pendingBandwidth) {
+		//Bandwidth can not be changed on a live receiver. Keep the current
+		//one until a new receiver with the desired bandwidth is ready
+		m_pendingFrameSync = Zuazo::NDI::FrameSync(nullptr);
+		m_pendingReceiver = createReceiver(bandwidth);
+		m_pendingFrameSync = Zuazo::NDI::FrameSync(m_pendingReceiver);
+		m_pendingBandwidth = bandwidth;
+	}
+
+	//Interlaced frames are delivered as they are when someone deinterlaces
+	//them. Otherwise the SDK converts them to progressive
+	m_captureFormat = fields ? Field::INTERLEAVED : Field::PROGRESSIVE;
+
+	//Update the tally of all the receivers
+	if(m_receiver) {
+		m_receiver->setTally(pgmTally, pvwTally);
+	}
+	if(m_pendingReceiver) {
+		m_pendingReceiver.setTally(pgmTally, pvwTally);
+	}
+	const auto prevPgmTally = m_metrics->programTally.exchange(pgmTally, std::memory_order_relaxed);
+	const auto prevPvwTally = m_metrics->previewTally.exchange(pvwTally, std::memory_order_relaxed);
+	if(prevPgmTally != pgmTally || prevPvwTally != pvwTally) {
+		Modules::NDI::get().getFlightRecorder().record(Zuazo::NDI::FlightRecorder::Event::TALLY, m_recorderSource, pgmTally, pvwTally);
+	}
+}
+
+void NDIReceiver::uploadFrames(Upload& upload, Field field) {
+	//Only upload once per captured frame (or field). Repeated frames are
+	//not converted again, unless they are being blended into a new one
+	const auto isBlending = upload.timebaseConverter.getMode() == Timebase::BLEND;
+	const auto needsUpload = 
+		upload.uploadedFrameCount != m_frameCount || 
+		upload.uploadedField != field ||
+		(isBlending && upload.uploadedCaptureCount != m_captureCount) ;
+
+	if(needsUpload) {
+		upload.uploadedFrameCount = m_frameCount;
+		upload.uploadedCaptureCount = m_captureCount;
+		upload.uploadedField = field;
+		upload.uploadedFrame.reset();
+		for(auto& decimation : upload.decimations) {
+			decimation.uploadedFrame.reset();
+		}
+
+		//Frames not matching the upload (subscribers may not have renegotiated
+		//yet, or they may have locked their video mode) are scaled into it.
+		//The same happens with formats without a specialized copy
+		const auto region = Zuazo::NDI::getEffectiveRegion(upload.crop, m_frame.getResolution());
+		const auto isExact =
+			m_frame.getFourCC() == upload.fourCC &&
+			region.resolution == upload.descriptor.getResolution();
+		const auto isResampleable = Zuazo::NDI::canResample(
+			m_frame.getFourCC(), 
+			upload.descriptor.getColorFormat()
+		);
+		const auto premultiply = upload.premultiply && Zuazo::NDI::hasAlpha(m_frame.getFourCC());
+		const auto hasDecimations = std::any_of(
+			upload.decimations.cbegin(), upload.decimations.cend(),
+			[] (const Decimation& decimation) -> bool {
+				return decimation.users > 0;
+			}
+		);
+
+		if(m_frame.getData() && region.resolution.x && region.resolution.y && (isExact || isResampleable)) {
+			const auto t0 = std::chrono::steady_clock::now();
+			upload.uploadedFrame = upload.framePool.acquireFrame();
+			assert(upload.uploadedFrame);
+			const auto t1 = std::chrono::steady_clock::now();
+
+			//Frames are adapted to the output rate, blending the last two
+			//captured ones. Then, interlaced frames are deinterlaced, if
+			//requested. When nothing else needs the processed frame and the
+			//copy keeps the layout of the planes, the last of these steps is
+			//done straight into the staged frame
+			const auto weight = upload.timebaseConverter.process(m_frame, m_previousFrame);
+			const auto isBlended = weight < Zuazo::NDI::TimebaseConverter::FULL_WEIGHT;
+			const auto isDeinterlaced = upload.deinterlacer.isDeinterlacing(m_frame);
+			const auto isProcessedOnCopy =
+				(isBlended || isDeinterlaced) && isExact &&
+				Zuazo::NDI::isPlaneCopy(upload.copyCallback) &&
+				!hasDecimations ;
+			const auto& blended = (isBlended && (isDeinterlaced || !isProcessedOnCopy)) ?
+				upload.timebaseConverter.blend(m_frame, m_previousFrame, weight) :
+				m_frame ;
+			const auto& frame = (isDeinterlaced && !isProcessedOnCopy) ?
+				upload.deinterlacer.process(blended, m_previousFrame, field) :
+				blended ;
+
+			//Luma is analyzed while copying, when requested
+			auto* analyzer = upload.analysisUsers ? &upload.analyzer : nullptr;
+			if(analyzer) {
+				analyzer->begin(region.resolution);
+			}
+
+			//Copy the data from one frame to the other. The crop
+			//is applied while copying, so that it comes for free
+			auto& perfCounters = Modules::NDI::get().getPerfCounters();
+			const auto perfReading = perfCounters.begin();
+			if(isProcessedOnCopy && isDeinterlaced) {
+				upload.deinterlacer.process(blended, m_previousFrame, field, region, *upload.uploadedFrame, analyzer);
+			} else if(isProcessedOnCopy) {
+				Zuazo::NDI::blend(m_previousFrame, m_frame, weight, region, *upload.uploadedFrame, analyzer);
+			} else if(isExact && upload.copyCallback) {
+				upload.copyCallback(frame, region, *upload.uploadedFrame, analyzer);
+			} else {
+				Zuazo::NDI::resample(frame, region, *upload.uploadedFrame);
+				if(premultiply) {
+					Zuazo::NDI::premultiplyAlpha(*upload.uploadedFrame);
+				}
+				if(analyzer) {
+					Zuazo::NDI::analyzeLuma(frame, region, *analyzer);
+				}
+			}
+
+			if(analyzer) {
+				analyzer->end();
+			}
+
+			if(perfReading.valid) {
+				//Bytes read are proportional to the cropped area
+				size_t readSize = 0;
+				for(const auto& slice : frame.getSlicedData()) {
+					readSize += slice.size();
+				}
+				const auto frameArea = static_cast<size_t>(frame.getResolution().x) * frame.getResolution().y;
+				const auto regionArea = static_cast<size_t>(region.resolution.x) * region.resolution.y;
+				readSize = frameArea ? readSize * regionArea / frameArea : 0;
+
+				perfCounters.end(
+					{ frame.getFourCC(), upload.descriptor.getColorFormat(), upload.descriptor.getColorSubsampling() },
+					perfReading,
+					readSize + upload.uploadSize
+				);
+			}
+
+			const auto t2 = std::chrono::steady_clock::now();
+			upload.uploadedFrame->flush();
+			const auto t3 = std::chrono::steady_clock::now();
+			upload.timings = { t1 - t0, t2 - t1, t3 - t2 };
+
+			auto& tracer = Modules::NDI::get().getTracer();
+			if(tracer.isEnabled()) {
+				const auto timestamp = m_frame.getTimestamp();
+				tracer.record(Zuazo::NDI::Tracer::Event::ACQUIRE, m_traceSource, t0, t1, timestamp);
+				tracer.record(Zuazo::NDI::Tracer::Event::COPY, m_traceSource, t1, t2, timestamp);
+				tracer.record(Zuazo::NDI::Tracer::Event::FLUSH, m_traceSource, t2, t3, timestamp);
+			}
+
+			Modules::NDI::get().getFlightRecorder().record(
+				Zuazo::NDI::FlightRecorder::Event::CONVERSION,
+				m_recorderSource,
+				std::chrono::duration_cast<std::chrono::nanoseconds>(t3 - t0).count(),
+				m_frame.getTimestamp()
+			);
+
+			m_metrics->conversions.fetch_add(1, std::memory_order_relaxed);
+			m_metrics->conversionTime.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(t3 - t0).count(), std::memory_order_relaxed);
+			m_metrics->uploadedBytes.fetch_add(upload.uploadSize, std::memory_order_relaxed);
+
+			//Downscaled copies are computed from the same frame, reading it once
+			Graphics::StagedFrame* decimated[2] = { nullptr, nullptr }; //Half, quarter
+			for(auto& decimation : upload.decimations) {
+				if(decimation.users > 0) {
+					decimation.uploadedFrame = decimation.framePool.acquireFrame();
+					assert(decimation.uploadedFrame);
+					decimated[decimation.factor == 2 ? 0 : 1] = decimation.uploadedFrame.get();
+				}
+			}
+
+			if(decimated[0] || decimated[1]) {
+				Zuazo::NDI::decimate(frame, region, decimated[0], decimated[1]);
+
+				for(auto* decimatedFrame : decimated) {
+					if(decimatedFrame) {
+						if(premultiply) {
+							Zuazo::NDI::premultiplyAlpha(*decimatedFrame);
+						}
+						decimatedFrame->flush();
+					}
+				}
+			}
+		}
+	}
+}
+
+void NDIReceiver::capture() {
+	using Event = Zuazo::NDI::Tracer::Event;
+	auto& tracer = Modules::NDI::get().getTracer();
+	const auto tracing = tracer.isEnabled();
+
+	//Keep the parameters of the previous frame, in order to detect changes.
+	//It is not freed yet, as it may become the history of the new one
+	const auto prevFrame = m_frame;
+	const auto hadData = prevFrame.getData() != nullptr;
+	const auto t0 = tracing ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+	Zuazo::NDI::VideoFrame frame;
+	if(m_pendingReceiver) {
+		//Check if the pending receiver has already started delivering frames
+		m_pendingFrameSync.capture(frame, m_captureFormat);
+
+		if(frame.getData()) {
+			//Frames need to be returned to their frame-sync before destroying it
+			freeFrame(m_frame);
+			freeFrame(m_previousFrame);
+			switchToPending();
+		} else {
+			m_frameSync.capture(frame, m_captureFormat);
+		}
+	} else if(m_frameSync) {
+		m_frameSync.capture(frame, m_captureFormat);
+	}
+
+	const auto formatChanged =
+		prevFrame.getResolution() != frame.getResolution() ||
+		prevFrame.getFourCC() != frame.getFourCC() ||
+		prevFrame.getFrameRate() != frame.getFrameRate() ||
+		prevFrame.getFormat() != frame.getFormat() ;
+
+	//Frame-syncs repeat the last frame when no new one has arrived
+	const auto hasData = frame.getData() != nullptr;
+	const auto isRepeated = 
+		hasData && hadData &&
+		frame.getTimestamp() == prevFrame.getTimestamp() &&
+		frame.getTimecode() == prevFrame.getTimecode() ;
+
+	//Repeated frames are returned right away. Otherwise the last
+	//frame becomes the history of the new one
+	if(isRepeated) {
+		freeFrame(m_frame);
+	} else {
+		freeFrame(m_previousFrame);
+		m_previousFrame = m_frame;
+	}
+	m_frame = frame;
+
+	using RecorderEvent = Zuazo::NDI::FlightRecorder::Event;
+	auto& recorder = Modules::NDI::get().getFlightRecorder();
+	if(hasData) {
+		m_metrics->capturedFrames.fetch_add(1, std::memory_order_relaxed);
+		if(isRepeated) {
+			m_metrics->duplicatedFrames.fetch_add(1, std::memory_order_relaxed);
+			recorder.record(RecorderEvent::REPEAT, m_recorderSource, m_frame.getTimestamp());
+		} else {
+			recorder.record(RecorderEvent::CAPTURE, m_recorderSource, m_frame.getTimestamp(), m_frame.getTimecode());
+		}
+	}
+	if(formatChanged) {
+		m_metrics->formatChanges.fetch_add(1, std::memory_order_relaxed);
+		recorder.record(
+			RecorderEvent::FORMAT_CHANGE,
+			m_recorderSource,
+			(static_cast<int64_t>(m_frame.getResolution().x) << 32) | m_frame.getResolution().y,
+			(static_cast<int64_t>(m_frame.getFourCC()) << 32) | static_cast<uint32_t>(m_frame.getFormat())
+		);
+	}
+
+	if(tracing) {
+		const auto t1 = std::chrono::steady_clock::now();
+		tracer.record(Event::CAPTURE, m_traceSource, t0, t1, m_frame.getTimestamp());
+
+		if(formatChanged) {
+			tracer.record(Event::FORMAT_CHANGE, m_traceSource, t1, m_frame.getTimestamp());
+		}
+	}
+
+	//Repeated frames keep the count, so that they are not converted again
+	++m_captureCount;
+	if(formatChanged || hasData != hadData || (hasData && !isRepeated)) {
+		++m_frameCount;
+	}
+}
+
+void NDIReceiver::freeFrame(Zuazo::NDI::VideoFrame& frame) {
+	if(frame.getData()) {
+		auto& tracer = Modules::NDI::get().getTracer();
+		const auto tracing = tracer.isEnabled();
+		const auto t0 = tracing ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+		m_frameSync.free(frame);
+		frame.setData(nullptr);
+
+		if(tracing) {
+			tracer.record(Zuazo::NDI::Tracer::Event::FREE, m_traceSource, t0, std::chrono::steady_clock::now(), frame.getTimestamp());
+		}
+	}
+}
+
+void NDIReceiver::switchToPending() {
+	assert(m_pendingReceiver);
+
+	//Release the current receiver
+	m_frameSync = Zuazo::NDI::FrameSync(nullptr);
+	releaseReceiver();
+
+	//Replace it with the pending one
+	m_receiver = std::make_shared<Zuazo::NDI::Recv>(std::move(m_pendingReceiver));
+	m_frameSync = std::move(m_pendingFrameSync);
+	m_bandwidth = m_pendingBandwidth;
+
+	assert(m_receiver);
+	assert(!m_pendingReceiver);
+}
+
+void NDIReceiver::releaseReceiver() {
+	assert(!m_frameSync);
+
+	//Standby receivers are given back to the pool by their deleter
+	m_receiver.reset();
+}
+
+void NDIReceiver::sample() {
+	//Never make the capture wait. If it is busy, the 
+	//counters will be read on the next period
+	std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+	if(!lock.owns_lock()) {
+		return;
+	}
+
+	//Only share the receiver, so that the capture is not blocked by
+	//the SDK calls. It is kept alive by the reference
+	const auto receiver = m_receiver;
+	lock.unlock();
+
+	Zuazo::NDI::Recv::Performance total = {};
+	Zuazo::NDI::Recv::Performance dropped = {};
+	Zuazo::NDI::Recv::Queue queue = {};
+	int32_t connections = 0;
+	if(receiver) {
+		receiver->getPerformance(&total, &dropped);
+		queue = receiver->getQueue();
+		connections = receiver->getConnectionCount();
+	}
+
+	const auto now = std::chrono::steady_clock::now();
+	const auto elapsed = std::chrono::duration<double>(now - m_sampleTime).count();
+
+	std::lock_guard<std::mutex> statisticsLock(m_statisticsMutex);
+
+	auto& recorder = Modules::NDI::get().getFlightRecorder();
+	if(connections != m_statistics.connections) {
+		recorder.record(Zuazo::NDI::FlightRecorder::Event::CONNECTIONS, m_recorderSource, connections);
+	}
+
+	//Counters restart when the receiver is replaced
+	const auto totalDelta = (total.video >= m_statistics.totalFrames) ? total.video - m_statistics.totalFrames : total.video;
+	const auto droppedDelta = (dropped.video >= m_statistics.droppedFrames) ? dropped.video - m_statistics.droppedFrames : dropped.video;
+
+	m_statistics = Statistics {
+		total.video,
+		dropped.video,
+		totalDelta,
+		droppedDelta,
+		(elapsed > 0.0) ? totalDelta / elapsed : 0.0,
+		(elapsed > 0.0) ? droppedDelta / elapsed : 0.0,
+		queue.video,
+		connections
+	};
+	m_sampleTime = now;
+
+	if(droppedDelta > 0) {
+		recorder.record(Zuazo::NDI::FlightRecorder::Event::DROP, m_recorderSource, droppedDelta, dropped.video);
+	}
+
+	m_metrics->droppedFrames.fetch_add(droppedDelta, std::memory_order_relaxed);
+	m_metrics->frameRate.store(m_statistics.frameRate, std::memory_order_relaxed);
+	m_metrics->queueDepth.store(queue.video, std::memory_order_relaxed);
+	m_metrics->connections.store(connections, std::memory_order_relaxed);
+}
+
+void NDIReceiver::reconnect(const std::string& url) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	//The source has moved. Live receivers can be redirected
+	Modules::NDI::get().getFlightRecorder().record(Zuazo::NDI::FlightRecorder::Event::RECONNECT, m_recorderSource);
+	const NDI::Source source(m_source.getName(), url);
+	if(m_receiver) {
+		m_receiver->connect(source);
+	}
+	if(m_pendingReceiver) {
+		m_pendingReceiver.connect(source);
+	}
+}
+
+
+Zuazo::NDI::Recv NDIReceiver::createReceiver(Bandwidth bandwidth) const {
+	//When connecting by name, use the last known URL, so that
+	//the connection does not need to wait for the discovery
+	auto source = m_source;
+	if(m_cached) {
+		source.setURL(Modules::NDI::get().getSourceCache().lookup(source.getName()));
+	}
+
+	return Zuazo::NDI::Recv(
+		source,
+		Zuazo::NDI::Recv::ColorFormat::BEST, //So that 16bit sources are delivered as P216/PA16, which are converted on our side
+		bandwidth,
+		true, //Fields are requested on capture
+		m_receiverName.c_str()
+	);
+}
+
+
+
+std::string NDIReceiver::getKey(const NDI::Source& source) {
+	//Sources are identified by their name. Fallback to the URL
+	return source.getName().empty() ? source.getURL() : source.getName();
+}
+
+int NDIReceiver::getBandwidthRank(Bandwidth bandwidth) noexcept {
+	//Numeric values do not follow the order of the consumed bandwidth
+	switch(bandwidth) {
+	case Bandwidth::METADATA_ONLY:	return 0;
+	case Bandwidth::AUDIO_ONLY:		return 1;
+	case Bandwidth::LOWEST:			return 2;
+	case Bandwidth::HIGHEST:		return 3;
+	default:						return -1;
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <zuazo/Sources/NDI.h>
+#include <zuazo/NDI/Recv.h>
+#include <zuazo/NDI/FrameSync.h>
+#include <zuazo/NDI/VideoFrame.h>
+#include <zuazo/NDI/Conversions.h>
+#include <zuazo/NDI/Deinterlacer.h>
+#include <zuazo/NDI/TimebaseConverter.h>
+#include <zuazo/NDI/SourceCache.h>
+#include <zuazo/NDI/Sampler.h>
+#include <zuazo/NDI/Exporter.h>
+#include <zuazo/Graphics/StagedFramePool.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace Zuazo::Sources {
+
+/*
+ * NDIReceiver is shared by all the Sources::NDI connected to the same
+ * NDI source, so that frames are only received and converted once
+ */
+class NDIReceiver {
+public:
+	using Bandwidth = Zuazo::NDI::Recv::Bandwidth;
+	using Deinterlacing = Zuazo::NDI::Deinterlacer::Mode;
+	using Timebase = Zuazo::NDI::TimebaseConverter::Mode;
+	using Field = Zuazo::NDI::VideoFrame::Format;
+	using Region = Zuazo::NDI::Region;
+	using Analysis = Zuazo::NDI::Analyzer::Result;
+	using Statistics = NDI::Statistics;
+
+	static constexpr size_t MAX_IDLE_UPLOADS = 3;
+	using copy_fn = Zuazo::NDI::CopyFunction;
+
+	struct Subscription {
+		bool											pgmTally;
+		bool											pvwTally;
+		Bandwidth										bandwidth;
+		bool											fields;
+		uint64_t										lastCapture;
+	};
+
+	using Subscriptions = std::list<Subscription>;
+	using Handle = Subscriptions::iterator;
+
+	//Only decimations by 2 and 4 are supported
+	struct Decimation {
+		Decimation(	const Graphics::Vulkan& vulkan,
+					const Graphics::Frame::Descriptor& descriptor,
+					uint32_t factor );
+
+		uint32_t										factor;
+		size_t											users;
+		Graphics::StagedFramePool						framePool;
+		std::shared_ptr<Graphics::StagedFrame>			uploadedFrame;
+	};
+
+	//Time spent on the latest uploaded frame
+	struct Timings {
+		std::chrono::steady_clock::duration				acquire;
+		std::chrono::steady_clock::duration				copy;
+		std::chrono::steady_clock::duration				flush;
+	};
+
+	struct Upload {
+		Upload(	const Graphics::Vulkan& vulkan,
+				const Graphics::Frame::Descriptor& descriptor,
+				FourCC fourCC,
+				const Region& crop,
+				Deinterlacing deinterlacing,
+				bool premultiply,
+				Timebase timebase,
+				int64_t outputPeriod );
+
+		const Graphics::Vulkan&							vulkan;
+		Graphics::Frame::Descriptor						descriptor;
+		FourCC											fourCC;
+		Region											crop;
+		Graphics::StagedFramePool						framePool;
+		bool											premultiply;
+		copy_fn											copyCallback;
+		Zuazo::NDI::Deinterlacer						deinterlacer;
+		Zuazo::NDI::TimebaseConverter					timebaseConverter;
+		std::shared_ptr<Graphics::StagedFrame>			uploadedFrame;
+		uint64_t										uploadedFrameCount;
+		uint64_t										uploadedCaptureCount;
+		Field											uploadedField;
+		std::list<Decimation>							decimations;
+		size_t											analysisUsers;
+		Zuazo::NDI::Analyzer							analyzer;
+		Timings											timings;
+		size_t											uploadSize;
+	};
+
+	NDIReceiver(const NDI::Source& source, std::string name);
+	NDIReceiver(const NDIReceiver& other) = delete;
+	~NDIReceiver();
+
+	NDIReceiver&										operator=(const NDIReceiver& other) = delete;
+
+	Handle												subscribe(bool pgmTally, bool pvwTally, Bandwidth bandwidth, bool fields);
+	void												unsubscribe(Handle handle);
+
+	void												setTally(Handle handle, bool pgmTally, bool pvwTally);
+	void												setBandwidth(Handle handle, Bandwidth bandwidth);
+	void												setFields(Handle handle, bool fields);
+
+	Zuazo::NDI::VideoFrame								pull(Handle handle);
+
+	std::shared_ptr<Upload>								getUpload(	const Graphics::Vulkan& vulkan,
+																	const Graphics::Frame::Descriptor& desc,
+																	FourCC fourCC,
+																	const Region& crop,
+																	Deinterlacing deinterlacing,
+																	bool premultiply,
+																	Timebase timebase,
+																	int64_t outputPeriod );
+	Video												upload(Upload& upload, Field field);
+
+	void												enableDecimation(Upload& upload, uint32_t factor);
+	void												disableDecimation(Upload& upload, uint32_t factor);
+	Video												uploadDecimated(Upload& upload, Field field, uint32_t factor);
+
+	void												enableAnalysis(Upload& upload);
+	void												disableAnalysis(Upload& upload);
+	Analysis											getAnalysis(const Upload& upload);
+
+	Statistics											getStatistics() const;
+
+	static std::shared_ptr<NDIReceiver>					get(const NDI::Source& source, const std::string& name);
+
+private:
+	NDI::Source											m_source;
+	std::string											m_receiverName;
+	bool												m_cached;
+	Zuazo::NDI::SourceCache::Handle						m_cacheHandle;
+
+	std::mutex											m_mutex;
+	Subscriptions										m_subscriptions;
+
+	std::shared_ptr<Zuazo::NDI::Recv>					m_receiver;	//Shared with the sampler
+	Zuazo::NDI::FrameSync								m_frameSync;
+	Bandwidth											m_bandwidth;
+
+	Zuazo::NDI::Recv									m_pendingReceiver;
+	Zuazo::NDI::FrameSync								m_pendingFrameSync;
+	Bandwidth											m_pendingBandwidth;
+
+	Zuazo::NDI::VideoFrame								m_frame;
+	Zuazo::NDI::VideoFrame								m_previousFrame; //Kept captured, as history
+	uint64_t											m_frameCount;	//Distinct frames captured
+	uint64_t											m_captureCount;
+	Field												m_captureFormat;
+
+	std::list<std::shared_ptr<Upload>>					m_uploads;
+
+	uint32_t											m_traceSource;
+	uint32_t											m_recorderSource;
+
+	mutable std::mutex									m_statisticsMutex;
+	Statistics											m_statistics;
+	std::chrono::steady_clock::time_point				m_sampleTime;
+	Zuazo::NDI::Sampler::Handle							m_samplerHandle;
+
+	Zuazo::NDI::Exporter::MetricsRef					m_metrics;
+	Zuazo::NDI::Exporter::Handle						m_exporterHandle;
+
+	void												updateConnection();
+	void												uploadFrames(Upload& upload, Field field);
+	void												capture();
+	void												freeFrame(Zuazo::NDI::VideoFrame& frame);
+	void												switchToPending();
+	void												releaseReceiver();
+	void												reconnect(const std::string& url);
+	void												sample();
+
+	Zuazo::NDI::Recv									createReceiver(Bandwidth bandwidth) const;
+
+	static std::string									getKey(const NDI::Source& source);
+	static int											getBandwidthRank(Bandwidth bandwidth) noexcept;
+
+};
+
+}
\ No newline at end of file
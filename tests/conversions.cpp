@@ -0,0 +1,299 @@
+/*
+ * This test checks the CPU conversions of NDI::Conversions, inspecting
+ * the staged frames they produce. Staged frames need a Vulkan
+ * implementation. Mesa's software rasterizer is used unless
+ * VK_ICD_FILENAMES is set
+ *
+ * Usage:
+ * zuazo-ndi-conversions-test
+ */
+
+#include <NDI/Channels.h>
+
+#include <zuazo/Instance.h>
+#include <zuazo/Video.h>
+#include <zuazo/Modules/NDI.h>
+#include <zuazo/NDI/Conversions.h>
+#include <zuazo/NDI/Deinterlacer.h>
+#include <zuazo/NDI/VideoFrame.h>
+#include <zuazo/Graphics/StagedFramePool.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace Zuazo;
+
+//Failures are thrown, so that the remaining tests still run
+static void check(bool condition, const std::string& what) {
+	if(!condition) {
+		throw std::runtime_error(what);
+	}
+}
+
+static Graphics::Frame::Descriptor getDescriptor(	const Graphics::Vulkan& vulkan,
+													Resolution resolution,
+													ColorFormat format,
+													ColorSubsampling subsampling )
+{
+	const auto isRGB = format == ColorFormat::R8G8B8A8 || format == ColorFormat::B8G8R8A8;
+	const VideoMode videoMode(
+		Utils::MustBe<Rate>(Rate(30, 1)),
+		Utils::MustBe<Resolution>(resolution),
+		Utils::MustBe<AspectRatio>(AspectRatio(1, 1)),
+		Utils::MustBe<ColorPrimaries>(ColorPrimaries::bt709),
+		Utils::MustBe<ColorModel>(isRGB ? ColorModel::rgb : ColorModel::bt709),
+		Utils::MustBe<ColorTransferFunction>(ColorTransferFunction::bt1886),
+		Utils::MustBe<ColorSubsampling>(subsampling),
+		Utils::MustBe<ColorRange>(isRGB ? ColorRange::full : ColorRange::ituNarrow),
+		Graphics::StagedFrame::getSupportedFormats(vulkan).intersect(Utils::MustBe<ColorFormat>(format))
+	);
+
+	if(!static_cast<bool>(videoMode)) {
+		throw std::runtime_error("Format is not supported by the GPU");
+	}
+
+	return videoMode.getFrameDescriptor();
+}
+
+/*
+ * I420 frame where each channel has a constant value
+ */
+struct I420Frame {
+	I420Frame(Resolution resolution, uint8_t y, uint8_t cb, uint8_t cr)
+		: data(resolution.x*resolution.y + 2*(resolution.x/2)*(resolution.y/2))
+		, frame(
+			resolution,
+			FourCC::I420,
+			Math::Rational<int>(30, 1),
+			0.0f,
+			NDI::VideoFrame::Format::PROGRESSIVE,
+			NDI::VideoFrame::SYNTHETIZE_TIMECODE,
+			nullptr,
+			static_cast<int>(resolution.x)
+		)
+	{
+		const size_t lumaSize = resolution.x*resolution.y;
+		const size_t chromaSize = (resolution.x/2)*(resolution.y/2);
+		std::fill(data.begin(), data.begin() + lumaSize, static_cast<std::byte>(y));
+		std::fill(data.begin() + lumaSize, data.begin() + lumaSize + chromaSize, static_cast<std::byte>(cb));
+		std::fill(data.begin() + lumaSize + chromaSize, data.end(), static_cast<std::byte>(cr));
+		frame.setData(data.data());
+	}
+
+	std::vector<std::byte>						data;
+	NDI::VideoFrame								frame;
+};
+
+static void checkChannel(const NDI::Channel& channel, uint8_t value, const std::string& name, int tolerance = 0) {
+	check(static_cast<bool>(channel), name + " is missing");
+	check(channel.depth == sizeof(uint8_t), name + " is not 8 bit");
+
+	for(size_t i = 0; i < channel.resolution.y; ++i) {
+		for(size_t j = 0; j < channel.resolution.x; ++j) {
+			const auto sample = std::to_integer<uint8_t>(channel.data[i*channel.stride + j*channel.step]);
+			if(std::abs(static_cast<int>(sample) - value) > tolerance) {
+				std::ostringstream os;
+				os 	<< name << " at " << j << "x" << i << " is " << static_cast<int>(sample)
+					<< ", expected " << static_cast<int>(value);
+				throw std::runtime_error(os.str());
+			}
+		}
+	}
+}
+
+static std::array<uint8_t, 3> getRGB(uint8_t y, uint8_t cb, uint8_t cr, double kr, double kb) {
+	//Narrow range YCbCr into full range RGB
+	const auto yn = (y - 16) / 219.0;
+	const auto cbn = (cb - 128) / 224.0;
+	const auto crn = (cr - 128) / 224.0;
+	const auto r = yn + 2.0*(1.0 - kr)*crn;
+	const auto b = yn + 2.0*(1.0 - kb)*cbn;
+	const auto g = (yn - kr*r - kb*b) / (1.0 - kr - kb);
+
+	const auto toByte = [] (double x) -> uint8_t {
+		return static_cast<uint8_t>(std::lround(std::clamp(x, 0.0, 1.0) * 255.0));
+	};
+	return { toByte(r), toByte(g), toByte(b) };
+}
+
+
+
+/*
+ * Tests
+ */
+
+static void testDecimateI420Into422(const Graphics::Vulkan& vulkan) {
+	//4:2:2 targets are advertised for 4:2:0 sources. Their chroma is not
+	//a half/quarter of the source's, so they must be resampled
+	constexpr uint8_t Y = 100, CB = 60, CR = 200;
+	const Resolution resolution(64, 32);
+	const I420Frame src(resolution, Y, CB, CR);
+	const NDI::Region region = { 0, 0, resolution };
+
+	Graphics::StagedFramePool halfPool(
+		vulkan,
+		getDescriptor(vulkan, Resolution(resolution.x/2, resolution.y/2), ColorFormat::G8_B8_R8, ColorSubsampling::rb422)
+	);
+	Graphics::StagedFramePool quarterPool(
+		vulkan,
+		getDescriptor(vulkan, Resolution(resolution.x/4, resolution.y/4), ColorFormat::G8_B8_R8, ColorSubsampling::rb422)
+	);
+	const auto half = halfPool.acquireFrame();
+	const auto quarter = quarterPool.acquireFrame();
+
+	NDI::decimate(src.frame, region, half.get(), quarter.get());
+
+	for(const auto& dst : { std::make_pair("half", half.get()), std::make_pair("quarter", quarter.get()) }) {
+		const auto channels = NDI::getChannels(*dst.second);
+		checkChannel(channels.channels[NDI::Channels::Y], Y, std::string(dst.first) + " Y");
+		checkChannel(channels.channels[NDI::Channels::CB], CB, std::string(dst.first) + " Cb");
+		checkChannel(channels.channels[NDI::Channels::CR], CR, std::string(dst.first) + " Cr");
+	}
+}
+
+static void testDecimateI420Into420(const Graphics::Vulkan& vulkan) {
+	//Exact decimation
+	constexpr uint8_t Y = 30, CB = 90, CR = 150;
+	const Resolution resolution(64, 32);
+	const I420Frame src(resolution, Y, CB, CR);
+	const NDI::Region region = { 0, 0, resolution };
+
+	Graphics::StagedFramePool halfPool(
+		vulkan,
+		getDescriptor(vulkan, Resolution(resolution.x/2, resolution.y/2), ColorFormat::G8_B8_R8, ColorSubsampling::rb420)
+	);
+	const auto half = halfPool.acquireFrame();
+
+	NDI::decimate(src.frame, region, half.get(), nullptr);
+
+	const auto channels = NDI::getChannels(*half);
+	checkChannel(channels.channels[NDI::Channels::Y], Y, "Y");
+	checkChannel(channels.channels[NDI::Channels::CB], CB, "Cb");
+	checkChannel(channels.channels[NDI::Channels::CR], CR, "Cr");
+}
+
+static void testBlendI420(const Graphics::Vulkan& vulkan) {
+	//Frames are blended while copied into the staged frame
+	const Resolution resolution(64, 32);
+	const I420Frame a(resolution, 40, 100, 200);
+	const I420Frame b(resolution, 200, 60, 100);
+	const NDI::Region region = { 16, 8, Resolution(32, 16) };
+
+	Graphics::StagedFramePool pool(
+		vulkan,
+		getDescriptor(vulkan, region.resolution, ColorFormat::G8_B8_R8, ColorSubsampling::rb420)
+	);
+	const auto dst = pool.acquireFrame();
+
+	check(NDI::isPlaneCopy(NDI::getCopyFunction(FourCC::I420, ColorFormat::G8_B8_R8, ColorSubsampling::rb420)), "I420 is not copied plane by plane");
+	NDI::blend(a.frame, b.frame, 1U << 14, region, *dst, nullptr); //A quarter of b
+
+	const auto channels = NDI::getChannels(*dst);
+	checkChannel(channels.channels[NDI::Channels::Y], 80, "Y", 1);
+	checkChannel(channels.channels[NDI::Channels::CB], 90, "Cb", 1);
+	checkChannel(channels.channels[NDI::Channels::CR], 175, "Cr", 1);
+}
+
+static void testDeinterlaceI420(const Graphics::Vulkan& vulkan) {
+	//Frames are deinterlaced while copied into the staged frame. Rows
+	//of the other field are interpolated from the ones of field 0
+	const Resolution resolution(64, 32);
+	I420Frame src(resolution, 40, 100, 200);
+	for(size_t i = 1; i < resolution.y; i += 2) {
+		std::fill_n(src.data.begin() + i*resolution.x, resolution.x, static_cast<std::byte>(200));
+	}
+	src.frame.setFormat(NDI::VideoFrame::Format::INTERLEAVED);
+	const NDI::Region region = { 16, 8, Resolution(32, 16) };
+
+	Graphics::StagedFramePool pool(
+		vulkan,
+		getDescriptor(vulkan, region.resolution, ColorFormat::G8_B8_R8, ColorSubsampling::rb420)
+	);
+	const auto dst = pool.acquireFrame();
+
+	const NDI::Deinterlacer deinterlacer(NDI::Deinterlacer::Mode::BOB);
+	check(deinterlacer.isDeinterlacing(src.frame), "Interleaved frame is not deinterlaced");
+	deinterlacer.process(src.frame, NDI::VideoFrame(), NDI::VideoFrame::Format::FIELD0, region, *dst, nullptr);
+
+	const auto channels = NDI::getChannels(*dst);
+	checkChannel(channels.channels[NDI::Channels::Y], 40, "Y");
+	checkChannel(channels.channels[NDI::Channels::CB], 100, "Cb");
+	checkChannel(channels.channels[NDI::Channels::CR], 200, "Cr");
+}
+
+static void testResampleUHDCrop(const Graphics::Vulkan& vulkan) {
+	//Colorimetry depends on the resolution of the frame, not on the 
+	//cropped area. A HD crop of a UHD frame is still BT.2020
+	constexpr uint8_t Y = 120, CB = 90, CR = 180;
+	const Resolution resolution(3840, 2160);
+	const I420Frame src(resolution, Y, CB, CR);
+	const NDI::Region region = { 960, 540, Resolution(1920, 1080) };
+
+	Graphics::StagedFramePool pool(
+		vulkan,
+		getDescriptor(vulkan, region.resolution, ColorFormat::R8G8B8A8, ColorSubsampling::rb444)
+	);
+	const auto dst = pool.acquireFrame();
+
+	NDI::resample(src.frame, region, *dst);
+
+	//Conversions are done in fixed point. Both matrices must be told 
+	//apart by the tolerance
+	constexpr int TOLERANCE = 2;
+	const auto bt2020 = getRGB(Y, CB, CR, 0.2627, 0.0593);
+	const auto bt709 = getRGB(Y, CB, CR, 0.2126, 0.0722);
+	check(std::abs(static_cast<int>(bt2020[0]) - bt709[0]) > 2*TOLERANCE, "Test colour does not tell BT.2020 from BT.709");
+
+	const auto channels = NDI::getChannels(*dst);
+	checkChannel(channels.channels[NDI::Channels::R], bt2020[0], "R", TOLERANCE);
+	checkChannel(channels.channels[NDI::Channels::G], bt2020[1], "G", TOLERANCE);
+	checkChannel(channels.channels[NDI::Channels::B], bt2020[2], "B", TOLERANCE);
+	checkChannel(channels.channels[NDI::Channels::A], 0xFF, "A");
+}
+
+
+
+int main() {
+	static constexpr const char* LAVAPIPE_ICD = "/usr/share/vulkan/icd.d/lvp_icd.x86_64.json";
+	setenv("VK_ICD_FILENAMES", LAVAPIPE_ICD, 0);
+
+	Instance::ApplicationInfo appInfo(
+		"NDI conversions test",
+		Version(0, 1, 0),
+		Verbosity::GEQ_WARNING,
+		{ Modules::NDI::get() }
+	);
+	Instance instance(std::move(appInfo));
+	const auto& vulkan = instance.getVulkan();
+
+	using Test = void (*)(const Graphics::Vulkan&);
+	const std::pair<const char*, Test> tests[] = {
+		{ "decimate I420 into 4:2:2", testDecimateI420Into422 },
+		{ "decimate I420 into 4:2:0", testDecimateI420Into420 },
+		{ "resample a crop of a UHD frame", testResampleUHDCrop },
+		{ "blend I420 frames while copying them", testBlendI420 },
+		{ "deinterlace an I420 frame while copying it", testDeinterlaceI420 },
+	};
+
+	int failures = 0;
+	for(const auto& test : tests) {
+		try {
+			test.second(vulkan);
+			std::cout << "PASS " << test.first << std::endl;
+		} catch(const std::exception& e) {
+			std::cout << "FAIL " << test.first << ": " << e.what() << std::endl;
+			++failures;
+		}
+	}
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
\ No newline at end of file
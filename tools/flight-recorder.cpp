@@ -0,0 +1,140 @@
+/*
+ * This tool decodes the dumps of NDI::FlightRecorder into text, one event
+ * per line. Times are given relative to the dump and as wall clock time.
+ * Dumps are written by FlightRecorder::dump() or, when ZUAZO_NDI_FLIGHT_RECORDER
+ * is set, upon SIGUSR1
+ *
+ * Usage:
+ * zuazo-ndi-flight-recorder DUMP [--source NAME] [--last SECONDS]
+ */
+
+#include <zuazo/NDI/FlightRecorder.h>
+
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+using namespace Zuazo;
+using Event = NDI::FlightRecorder::Event;
+
+static std::string getFourCCName(uint32_t fourCC) {
+	std::string result(4, ' ');
+	for(size_t i = 0; i < result.size(); ++i) {
+		result[i] = static_cast<char>((fourCC >> (8*i)) & 0xff);
+	}
+	return result;
+}
+
+static void writeArguments(std::ostream& os, const NDI::FlightRecorder::Record& record) {
+	switch(record.event) {
+	case Event::CAPTURE:
+		os << "timestamp=" << record.arg0 << " timecode=" << record.arg1;
+		break;
+	case Event::REPEAT:
+		os << "timestamp=" << record.arg0;
+		break;
+	case Event::FORMAT_CHANGE:
+		os << (static_cast<uint64_t>(record.arg0) >> 32) << "x" << (record.arg0 & 0xffffffff);
+		os << " " << getFourCCName(static_cast<uint64_t>(record.arg1) >> 32);
+		os << " format=" << (record.arg1 & 0xffffffff);
+		break;
+	case Event::CONVERSION:
+		os << "duration=" << record.arg0 / 1e3 << "us timestamp=" << record.arg1;
+		break;
+	case Event::DROP:
+		os << "dropped=" << record.arg0 << " total=" << record.arg1;
+		break;
+	case Event::TALLY:
+		os << "program=" << record.arg0 << " preview=" << record.arg1;
+		break;
+	case Event::CONNECTIONS:
+		os << "count=" << record.arg0;
+		break;
+	default:
+		break;
+	}
+}
+
+static int printUsage(const char* program) {
+	std::cerr << "Usage: " << program << " DUMP [--source NAME] [--last SECONDS]" << std::endl;
+	return 1;
+}
+
+static std::string getWallClock(int64_t time) {
+	//Local time, with microseconds
+	const std::time_t seconds = time / 1000000000;
+	std::tm tm;
+	localtime_r(&seconds, &tm);
+
+	std::ostringstream os;
+	os << std::put_time(&tm, "%F %T") << "." << std::setw(6) << std::setfill('0') << (time % 1000000000) / 1000;
+	return os.str();
+}
+
+
+
+int main(int argc, const char* argv[]) {
+	std::string path;
+	std::string source;
+	double last = -1.0;
+	for(int i = 1; i < argc; ++i) {
+		const std::string_view arg = argv[i];
+		if(arg == "--source" && i + 1 < argc) {
+			source = argv[++i];
+		} else if(arg == "--last" && i + 1 < argc) {
+			last = std::stod(argv[++i]);
+		} else if(path.empty() && arg.substr(0, 2) != "--") {
+			path = arg;
+		} else {
+			return printUsage(argv[0]);
+		}
+	}
+
+	if(path.empty()) {
+		return printUsage(argv[0]);
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	if(!file) {
+		std::cerr << "Could not open " << path << std::endl;
+		return 1;
+	}
+
+	NDI::FlightRecorder::Dump dump;
+	try {
+		dump = NDI::FlightRecorder::read(file);
+	} catch(const std::exception& e) {
+		std::cerr << path << ": " << e.what() << std::endl;
+		return 1;
+	}
+
+	std::cout << "dumped at " << getWallClock(dump.systemTime) << ", " << dump.records.size() << " events\n";
+	std::cout << std::fixed << std::setprecision(3);
+
+	for(const auto& record : dump.records) {
+		const auto& name = record.source < dump.sources.size() ? dump.sources[record.source] : std::string("?");
+		if(!source.empty() && name != source) {
+			continue;
+		}
+
+		//Relative to the dump, so that the events right before a glitch are easy to find
+		const auto age = static_cast<int64_t>(dump.steadyTime - record.time);
+		if(last >= 0.0 && age > last * 1e9) {
+			continue;
+		}
+
+		std::cout << getWallClock(dump.systemTime - age);
+		std::cout << std::setw(14) << -age / 1e6 << "ms  ";
+		std::cout << std::setw(16) << std::left << NDI::FlightRecorder::getEventName(record.event) << std::right;
+		std::cout << std::setw(24) << std::left << name << std::right << "  ";
+		writeArguments(std::cout, record);
+		std::cout << "\n";
+	}
+
+	return 0;
+}
\ No newline at end of file